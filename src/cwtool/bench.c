@@ -0,0 +1,206 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * bench.c
+ *
+ ****************************************************************************
+ *
+ * helpers for cwtool -T. disk_bench() encodes random sector data with the
+ * write routines of a format, bench_noise() distorts the resulting pulses
+ * like a real drive would do and the result is decoded again with the
+ * read routines. all random numbers come from a fixed seed, so each run
+ * decodes exactly the same pulses
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "error.h"
+#include "debug.h"
+#include "verbose.h"
+#include "global.h"
+#include "fifo.h"
+#include "stage.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define BENCH_FIXED			10000LL
+#define BENCH_NSECS			1000000000.0
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * bench_random
+ ****************************************************************************/
+static cw_u32_t
+bench_random(
+	struct bench			*bnc)
+
+	{
+	cw_u32_t			x = bnc->seed;
+
+	/* xorshift32, the same sequence on every platform */
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	bnc->seed = x;
+	return (x);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * bench_start
+ ****************************************************************************/
+cw_void_t
+bench_start(
+	struct bench			*bnc)
+
+	{
+	bnc->seed        = BENCH_SEED;
+	bnc->tracks      = 0;
+	bnc->pulses      = 0;
+	bnc->sectors     = 0;
+	bnc->sectors_bad = 0;
+	stage_reset();
+	}
+
+
+
+/****************************************************************************
+ * bench_stop
+ ****************************************************************************/
+cw_void_t
+bench_stop(
+	struct bench			*bnc)
+
+	{
+	stage_get_counters(bnc->cnt);
+	}
+
+
+
+/****************************************************************************
+ * bench_fill
+ ****************************************************************************/
+cw_void_t
+bench_fill(
+	struct bench			*bnc,
+	cw_raw8_t			*data,
+	cw_size_t			size)
+
+	{
+	cw_index_t			i;
+
+	for (i = 0; i < size; i++) data[i] = bench_random(bnc) >> 24;
+	}
+
+
+
+/****************************************************************************
+ * bench_noise
+ ****************************************************************************/
+cw_void_t
+bench_noise(
+	struct bench			*bnc,
+	struct fifo			*ffo_src,
+	struct fifo			*ffo_dst)
+
+	{
+	cw_raw8_t			*src  = fifo_get_data(ffo_src);
+	cw_raw8_t			*dst  = fifo_get_data(ffo_dst);
+	cw_count_t			size  = fifo_get_wr_ofs(ffo_src);
+	cw_count64_t			range = 2 * bnc->jitter * BENCH_FIXED / 100 + 1;
+	cw_count64_t			scale, v;
+	cw_index_t			i, j;
+
+	debug_error_condition(fifo_get_size(ffo_dst) < size);
+
+	/*
+	 * a dropout merges a pulse with the following one, the drift changes
+	 * the speed linear from -drift to +drift percent over the track and
+	 * the jitter is uniformly distributed between -jitter and +jitter
+	 * percent of each pulse
+	 */
+
+	for (i = j = 0; i < size; i++)
+		{
+		v = src[i] & GLOBAL_PULSE_LENGTH_MASK;
+		if ((i + 1 < size) && (bench_random(bnc) % BENCH_DROPOUT_SCALE < bnc->dropouts)) v += src[++i] & GLOBAL_PULSE_LENGTH_MASK;
+		scale = BENCH_FIXED + (2LL * i - size) * bnc->drift * BENCH_FIXED / 100 / size;
+		scale += (cw_count64_t) (bench_random(bnc) % range) - range / 2;
+		v = (v * scale + BENCH_FIXED / 2) / BENCH_FIXED;
+		if (v < GLOBAL_MIN_PULSE_LENGTH) v = GLOBAL_MIN_PULSE_LENGTH;
+		if (v > GLOBAL_MAX_PULSE_LENGTH) v = GLOBAL_MAX_PULSE_LENGTH;
+		dst[j++] = v;
+		}
+	fifo_set_wr_ofs(ffo_dst, j);
+	}
+
+
+
+/****************************************************************************
+ * bench_print
+ ****************************************************************************/
+cw_void_t
+bench_print(
+	struct bench			*bnc,
+	const cw_char_t			*name)
+
+	{
+	cw_count64_t			nsecs = 0;
+	cw_index_t			i;
+	double				s;
+
+	for (i = 0; i < STAGE_NR_STAGES; i++) nsecs += bnc->cnt[i].nsecs;
+	s = (nsecs > 0) ? nsecs / BENCH_NSECS : 1.0 / BENCH_NSECS;
+	printf("%-16s %5d tracks %9.1f tracks/s %7.2f Mpulses/s sectors %6d bad %6d\n",
+		name, bnc->tracks, bnc->tracks / s, bnc->pulses / s / 1000000.0,
+		bnc->sectors, bnc->sectors_bad);
+	for (i = 0; i < STAGE_NR_STAGES; i++)
+		{
+		if (bnc->cnt[i].calls == 0) continue;
+		printf("  %-14s %9lld calls %10.3f ms %5.1f%%\n",
+			stage_get_name(i), bnc->cnt[i].calls,
+			bnc->cnt[i].nsecs / 1000000.0,
+			(nsecs > 0) ? 100.0 * bnc->cnt[i].nsecs / nsecs : 0.0);
+		}
+	}
+/******************************************************** Karsten Scheibler */
@@ -0,0 +1,98 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * bench.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_BENCH_H
+#define CWTOOL_BENCH_H
+
+#include "types.h"
+#include "stage.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * jitter and drift are given in percent of the pulse length, dropouts
+ * per BENCH_DROPOUT_SCALE pulses
+ */
+
+#define BENCH_SEED			0x2545f491
+#define BENCH_DROPOUT_SCALE		10000
+#define BENCH_MAX_PERCENT		50
+
+#define BENCH_INIT(j, o, d, r)		(struct bench) { .jitter = j, .dropouts = o, .drift = d, .rounds = r }
+
+struct bench
+	{
+	cw_count_t			jitter;
+	cw_count_t			dropouts;
+	cw_count_t			drift;
+	cw_count_t			rounds;
+	cw_u32_t			seed;
+	cw_count_t			tracks;
+	cw_count64_t			pulses;
+	cw_count_t			sectors;
+	cw_count_t			sectors_bad;
+	struct stage_counter		cnt[STAGE_NR_STAGES];
+	};
+
+struct fifo;
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_void_t
+bench_start(
+	struct bench			*bnc);
+
+extern cw_void_t
+bench_stop(
+	struct bench			*bnc);
+
+extern cw_void_t
+bench_fill(
+	struct bench			*bnc,
+	cw_raw8_t			*data,
+	cw_size_t			size);
+
+extern cw_void_t
+bench_noise(
+	struct bench			*bnc,
+	struct fifo			*ffo_src,
+	struct fifo			*ffo_dst);
+
+extern cw_void_t
+bench_print(
+	struct bench			*bnc,
+	const cw_char_t			*name);
+
+
+
+#endif /* !CWTOOL_BENCH_H */
+/******************************************************** Karsten Scheibler */
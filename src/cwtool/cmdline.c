@@ -22,6 +22,7 @@
 #include "string.h"
 #include "config.h"
 #include "file.h"
+#include "bench.h"
 
 
 
@@ -35,7 +36,7 @@
 
 
 
-static struct cmdline			cmd = { .retry = 5 };
+static struct cmdline			cmd = { .retry = 5, .jobs = 1, .rounds = 1, .jitter = 5, .drift = 1 };
 
 
 
@@ -86,10 +87,15 @@ cmdline_usage(
 		"or:    %s -S [-v] [-n] [-f <file>] [-e <config>]\n"
 		"       %s    [--] <diskname> <srcfile|device>\n"
 		"or:    %s -R [-v] [-n] [-f <file>] [-e <config>] [-r <num>]\n"
-		"       %s    [-o <file>] [--] <diskname> <srcfile|device>\n"
-		"       %s    [<srcfile> ... ] <dstfile>\n"
-		"or:    %s -W [-v] [-n] [-f <file>] [-e <config>] [-s]\n"
-		"       %s    [--] <diskname> <srcfile> <dstfile|device>\n\n"
+		"       %s    [-j <num>] [-b <num>] [-o <file>] [-m <file>] [--]\n"
+		"       %s    <diskname> <srcfile|device> [<srcfile> ... ] <dstfile>\n"
+		"or:    %s -W [-v] [-n] [-f <file>] [-e <config>] [-s] [-m <file>]\n"
+		"       %s    [--] <diskname> <srcfile> <dstfile|device>\n"
+		"or:    %s -B [-v] [-n] [-f <file>] [-e <config>] [-r <num>]\n"
+		"       %s    [-j <num>] [-b <num>] [--] <diskname> <srcfile|device>\n"
+		"       %s    <dstfile> [<diskname> <srcfile|device> <dstfile> ... ]\n"
+		"or:    %s -T [-v] [-n] [-f <file>] [-e <config>] [-c <num>] [-x <num>]\n"
+		"       %s    [-y <num>] [-z <num>] [--] [<diskname> ... ]\n\n"
 		"  -V            print out version\n"
 		"  -D            dump builtin config\n"
 		"  -I            initialize configured drives\n"
@@ -97,19 +103,29 @@ cmdline_usage(
 		"  -S            print out statistics\n"
 		"  -R            read disk\n"
 		"  -W            write disk\n"
+		"  -B            read several disks at once, one thread per controller\n"
+		"  -T            benchmark decoding of generated tracks\n"
 		"  -v            be more verbose\n"
 		"  -n            do not read rc files\n"
 		"  -f <file>     read additional config file\n"
 		"  -e <config>   evaluate given string as config\n"
 		"  -r <num>      number of retries if errors occur\n"
+		"  -j <num>      number of threads decoding tracks, read ahead on devices\n"
+		"  -b <num>      retry bad tracks at the end, for at most <num> seconds\n"
 		"  -o <file>     output raw data of bad sectors to file\n"
+		"  -m <file>     write time and counters per stage and track to file\n"
+		"  -c <num>      number of distorted reads per generated track\n"
+		"  -x <num>      jitter of generated tracks in percent\n"
+		"  -y <num>      dropouts of generated tracks per 10000 pulses\n"
+		"  -z <num>      drift of generated tracks in percent\n"
 		"  -s            ignore size\n"
 		"  -h            this help\n",
 		global_version_string(), space1, space1, global_program_name(),
 		global_program_name(), global_program_name(), global_program_name(),
 		global_program_name(), global_program_name(), space2,
 		global_program_name(), space2, space2, global_program_name(),
-		space2);
+		space2, global_program_name(), space2, space2,
+		global_program_name(), space2);
 	exit(0);
 	}
 
@@ -179,6 +195,7 @@ cmdline_min_params(
 	{
 	if (cmd.mode == CMDLINE_MODE_READ)       return (3);
 	if (cmd.mode == CMDLINE_MODE_WRITE)      return (3);
+	if (cmd.mode == CMDLINE_MODE_BATCH)      return (3);
 	if (cmd.mode == CMDLINE_MODE_STATISTICS) return (2);
 	return (0);
 	}
@@ -195,6 +212,8 @@ cmdline_max_params(
 	{
 	if (cmd.mode == CMDLINE_MODE_READ)       return (GLOBAL_NR_IMAGES);
 	if (cmd.mode == CMDLINE_MODE_WRITE)      return (3);
+	if (cmd.mode == CMDLINE_MODE_BATCH)      return (3 * CMDLINE_NR_BATCHES);
+	if (cmd.mode == CMDLINE_MODE_BENCH)      return (GLOBAL_NR_IMAGES);
 	if (cmd.mode == CMDLINE_MODE_STATISTICS) return (2);
 	return (0);
 	}
@@ -234,7 +253,9 @@ cmdline_verbose_level(
 	if ((cmd.mode == CMDLINE_MODE_INITIALIZE) ||
 		(cmd.mode == CMDLINE_MODE_LIST) ||
 		(cmd.mode == CMDLINE_MODE_READ) ||
-		(cmd.mode == CMDLINE_MODE_WRITE))
+		(cmd.mode == CMDLINE_MODE_WRITE) ||
+		(cmd.mode == CMDLINE_MODE_BATCH) ||
+		(cmd.mode == CMDLINE_MODE_BENCH))
 		{
 		level = verbose_get_level(VERBOSE_CLASS_CWTOOL_ILRW);
 		if (level < VERBOSE_LEVEL_1) verbose_set_level(VERBOSE_CLASS_CWTOOL_ILRW, level + 1);
@@ -282,7 +303,24 @@ cmdline_parse(
 			{
 			if (cmd.mode == CMDLINE_MODE_DEFAULT) goto bad_option;
 			if (params >= cmdline_max_params()) error_message("too many parameters given");
-			if (params >= 1)
+			if (cmd.mode == CMDLINE_MODE_BATCH)
+				{
+				struct cmdline_batch	*bat = &cmd.bat[params / 3];
+
+				/* parameters are given as triples <diskname> <srcfile|device> <dstfile> */
+
+				if (params % 3 == 0) bat->disk_name = arg, cmd.batches++;
+				else if (params % 3 == 1) bat->src = cmdline_check_stdin("<srcfile>", arg);
+				else bat->dst = cmdline_check_stdout("<dstfile>", arg);
+				}
+			else if (cmd.mode == CMDLINE_MODE_BENCH)
+				{
+
+				/* all parameters are disk names */
+
+				cmd.file[cmd.files++] = arg;
+				}
+			else if (params >= 1)
 				{
 				if (cmd.files > 0) cmdline_check_stdin("<srcfile>", cmd.file[cmd.files - 1]);
 				cmd.file[cmd.files++] = arg;
@@ -326,6 +364,14 @@ cmdline_parse(
 			{
 			cmd.mode = CMDLINE_MODE_WRITE;
 			}
+		else if ((string_equal2(arg, "-B", "--batch")) && (args == 0))
+			{
+			cmd.mode = CMDLINE_MODE_BATCH;
+			}
+		else if ((string_equal2(arg, "-T", "--bench")) && (args == 0))
+			{
+			cmd.mode = CMDLINE_MODE_BENCH;
+			}
 		else if ((cmd.mode == CMDLINE_MODE_DEFAULT) || (cmd.mode == CMDLINE_MODE_VERSION) || (cmd.mode == CMDLINE_MODE_DUMP))
 			{
 			goto bad_option;
@@ -360,19 +406,66 @@ cmdline_parse(
 				.data = cmdline_check_arg("-e/--evaluate", "parameter", *argv++)
 				};
 			}
-		else if ((string_equal2(arg, "-r", "--retry")) && (cmd.mode == CMDLINE_MODE_READ))
+		else if ((string_equal2(arg, "-r", "--retry")) && ((cmd.mode == CMDLINE_MODE_READ) || (cmd.mode == CMDLINE_MODE_BATCH)))
 			{
 			cw_count_t	i = 0;
 
 			if (*argv != NULL) i = sscanf(*argv++, "%d", &cmd.retry);
 			if ((i != 1) || (cmd.retry < 0) || (cmd.retry > GLOBAL_NR_RETRIES)) error_message("-r/--retry expects a valid number of retries");
 			}
+		else if ((string_equal2(arg, "-j", "--jobs")) && ((cmd.mode == CMDLINE_MODE_READ) || (cmd.mode == CMDLINE_MODE_BATCH)))
+			{
+			cw_count_t	i = 0;
+
+			if (*argv != NULL) i = sscanf(*argv++, "%d", &cmd.jobs);
+			if ((i != 1) || (cmd.jobs < 1) || (cmd.jobs > GLOBAL_NR_JOBS)) error_message("-j/--jobs expects a valid number of threads");
+			}
+		else if ((string_equal2(arg, "-b", "--budget")) && ((cmd.mode == CMDLINE_MODE_READ) || (cmd.mode == CMDLINE_MODE_BATCH)))
+			{
+			cw_count_t	i = 0;
+
+			if (*argv != NULL) i = sscanf(*argv++, "%d", &cmd.budget);
+			if ((i != 1) || (cmd.budget < 0)) error_message("-b/--budget expects a valid number of seconds");
+			}
 		else if ((string_equal2(arg, "-o", "--output")) && (cmd.mode == CMDLINE_MODE_READ))
 			{
 			if (cmd.output != NULL) error_message("-o/--output already specified");
 			cmd.output = cmdline_check_stdout("-o/--output", *argv++);
 			options_set_output(CW_BOOL_TRUE);
 			}
+		else if ((string_equal2(arg, "-m", "--metrics")) && ((cmd.mode == CMDLINE_MODE_READ) || (cmd.mode == CMDLINE_MODE_WRITE)))
+			{
+			if (cmd.metrics != NULL) error_message("-m/--metrics already specified");
+			cmd.metrics = cmdline_check_stdout("-m/--metrics", *argv++);
+			}
+		else if ((string_equal2(arg, "-c", "--rounds")) && (cmd.mode == CMDLINE_MODE_BENCH))
+			{
+			cw_count_t	i = 0;
+
+			if (*argv != NULL) i = sscanf(*argv++, "%d", &cmd.rounds);
+			if ((i != 1) || (cmd.rounds < 1)) error_message("-c/--rounds expects a valid number of rounds");
+			}
+		else if ((string_equal2(arg, "-x", "--jitter")) && (cmd.mode == CMDLINE_MODE_BENCH))
+			{
+			cw_count_t	i = 0;
+
+			if (*argv != NULL) i = sscanf(*argv++, "%d", &cmd.jitter);
+			if ((i != 1) || (cmd.jitter < 0) || (cmd.jitter > BENCH_MAX_PERCENT)) error_message("-x/--jitter expects a valid jitter in percent");
+			}
+		else if ((string_equal2(arg, "-y", "--dropouts")) && (cmd.mode == CMDLINE_MODE_BENCH))
+			{
+			cw_count_t	i = 0;
+
+			if (*argv != NULL) i = sscanf(*argv++, "%d", &cmd.dropouts);
+			if ((i != 1) || (cmd.dropouts < 0) || (cmd.dropouts > BENCH_DROPOUT_SCALE)) error_message("-y/--dropouts expects a valid number of dropouts");
+			}
+		else if ((string_equal2(arg, "-z", "--drift")) && (cmd.mode == CMDLINE_MODE_BENCH))
+			{
+			cw_count_t	i = 0;
+
+			if (*argv != NULL) i = sscanf(*argv++, "%d", &cmd.drift);
+			if ((i != 1) || (cmd.drift < 0) || (cmd.drift > BENCH_MAX_PERCENT)) error_message("-z/--drift expects a valid drift in percent");
+			}
 		else if ((string_equal2(arg, "-s", "--ignore-size")) && (cmd.mode == CMDLINE_MODE_WRITE))
 			{
 			cmd.flags |= CMDLINE_FLAG_IGNORE_SIZE;
@@ -384,7 +477,11 @@ cmdline_parse(
 			}
 		}
 	if ((params < cmdline_min_params()) || (cmd.mode == CMDLINE_MODE_DEFAULT)) error_message("too few parameters given");
-	if (params >= 2) cmdline_check_stdout("<dstfile>", cmd.file[cmd.files - 1]);
+	if (cmd.mode == CMDLINE_MODE_BATCH)
+		{
+		if (params % 3 != 0) error_message("too few parameters given");
+		}
+	else if ((params >= 2) && (cmd.mode != CMDLINE_MODE_BENCH)) cmdline_check_stdout("<dstfile>", cmd.file[cmd.files - 1]);
 
 	return (CW_BOOL_OK);
 	}
@@ -430,6 +527,84 @@ cmdline_get_retry(
 
 
 
+/****************************************************************************
+ * cmdline_get_jobs
+ ****************************************************************************/
+cw_count_t
+cmdline_get_jobs(
+	cw_void_t)
+
+	{
+	return (cmd.jobs);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_get_budget
+ ****************************************************************************/
+cw_count_t
+cmdline_get_budget(
+	cw_void_t)
+
+	{
+	return (cmd.budget);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_get_rounds
+ ****************************************************************************/
+cw_count_t
+cmdline_get_rounds(
+	cw_void_t)
+
+	{
+	return (cmd.rounds);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_get_jitter
+ ****************************************************************************/
+cw_count_t
+cmdline_get_jitter(
+	cw_void_t)
+
+	{
+	return (cmd.jitter);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_get_dropouts
+ ****************************************************************************/
+cw_count_t
+cmdline_get_dropouts(
+	cw_void_t)
+
+	{
+	return (cmd.dropouts);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_get_drift
+ ****************************************************************************/
+cw_count_t
+cmdline_get_drift(
+	cw_void_t)
+
+	{
+	return (cmd.drift);
+	}
+
+
+
 /****************************************************************************
  * cmdline_get_output
  ****************************************************************************/
@@ -443,6 +618,19 @@ cmdline_get_output(
 
 
 
+/****************************************************************************
+ * cmdline_get_metrics
+ ****************************************************************************/
+cw_char_t *
+cmdline_get_metrics(
+	cw_void_t)
+
+	{
+	return (cmd.metrics);
+	}
+
+
+
 /****************************************************************************
  * cmdline_get_disk_name
  ****************************************************************************/
@@ -496,6 +684,33 @@ cmdline_get_files(
 
 
 
+/****************************************************************************
+ * cmdline_get_batch
+ ****************************************************************************/
+struct cmdline_batch *
+cmdline_get_batch(
+	cw_index_t			index)
+
+	{
+	if ((index < 0) || (index >= cmd.batches)) return (NULL);
+	return (&cmd.bat[index]);
+	}
+
+
+
+/****************************************************************************
+ * cmdline_get_batches
+ ****************************************************************************/
+cw_count_t
+cmdline_get_batches(
+	cw_void_t)
+
+	{
+	return (cmd.batches);
+	}
+
+
+
 /****************************************************************************
  * cmdline_read_config
  ****************************************************************************/
@@ -36,8 +36,11 @@
 #define CMDLINE_MODE_STATISTICS		5
 #define CMDLINE_MODE_READ		6
 #define CMDLINE_MODE_WRITE		7
+#define CMDLINE_MODE_BATCH		8
+#define CMDLINE_MODE_BENCH		9
 
 #define CMDLINE_NR_CONFIGS		128
+#define CMDLINE_NR_BATCHES		GLOBAL_NR_DRIVES
 
 #define CMDLINE_CONFIG_TYPE_FILE	1
 #define CMDLINE_CONFIG_TYPE_EVALUATE	2
@@ -48,6 +51,13 @@ struct cmdline_config
 	char				*data;
 	};
 
+struct cmdline_batch
+	{
+	cw_char_t			*disk_name;
+	cw_char_t			*src;
+	cw_char_t			*dst;
+	};
+
 #define CMDLINE_FLAG_NO_RCFILES		(1 << 0)
 #define CMDLINE_FLAG_IGNORE_SIZE	(1 << 1)
 
@@ -56,10 +66,19 @@ struct cmdline
 	cw_mode_t			mode;
 	cw_flag_t			flags;
 	cw_count_t			retry;
+	cw_count_t			jobs;
+	cw_count_t			budget;
+	cw_count_t			rounds;
+	cw_count_t			jitter;
+	cw_count_t			dropouts;
+	cw_count_t			drift;
 	cw_char_t			*disk_name;
 	cw_char_t			*file[GLOBAL_NR_IMAGES];
 	cw_count_t			files;
 	cw_char_t			*output;
+	cw_char_t			*metrics;
+	struct cmdline_batch		bat[CMDLINE_NR_BATCHES];
+	cw_count_t			batches;
 	struct cmdline_config		cfg[CMDLINE_NR_CONFIGS];
 	cw_count_t			configs;
 	};
@@ -92,10 +111,38 @@ extern cw_count_t
 cmdline_get_retry(
 	cw_void_t);
 
+extern cw_count_t
+cmdline_get_jobs(
+	cw_void_t);
+
+extern cw_count_t
+cmdline_get_budget(
+	cw_void_t);
+
+extern cw_count_t
+cmdline_get_rounds(
+	cw_void_t);
+
+extern cw_count_t
+cmdline_get_jitter(
+	cw_void_t);
+
+extern cw_count_t
+cmdline_get_dropouts(
+	cw_void_t);
+
+extern cw_count_t
+cmdline_get_drift(
+	cw_void_t);
+
 extern cw_char_t *
 cmdline_get_output(
 	cw_void_t);
 
+extern cw_char_t *
+cmdline_get_metrics(
+	cw_void_t);
+
 extern cw_char_t *
 cmdline_get_disk_name(
 	cw_void_t);
@@ -112,6 +159,14 @@ extern cw_count_t
 cmdline_get_files(
 	cw_void_t);
 
+extern struct cmdline_batch *
+cmdline_get_batch(
+	cw_index_t			index);
+
+extern cw_count_t
+cmdline_get_batches(
+	cw_void_t);
+
 extern cw_bool_t
 cmdline_read_config(
 	cw_void_t);
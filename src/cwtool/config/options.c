@@ -139,6 +139,20 @@ config_options_clock_adjust(
 
 
 
+/****************************************************************************
+ * config_options_raw_pack
+ ****************************************************************************/
+static cw_bool_t
+config_options_raw_pack(
+	struct config			*cfg)
+
+	{
+	if (! options_set_raw_pack(config_boolean(cfg, NULL, 0))) debug_error();
+	return (CW_BOOL_OK);
+	}
+
+
+
 /****************************************************************************
  * config_options_disk_track_start
  ****************************************************************************/
@@ -233,6 +247,7 @@ config_options_directive(
 		if (string_equal(token, "histogram_context"))     return (config_options_histogram_context(cfg));
 		if (string_equal(token, "always_initialize"))     return (config_options_always_initialize(cfg));
 		if (string_equal(token, "clock_adjust"))          return (config_options_clock_adjust(cfg));
+		if (string_equal(token, "raw_pack"))              return (config_options_raw_pack(cfg));
 		if (string_equal(token, "disk_track_start"))      return (config_options_disk_track_start(cfg));
 		if (string_equal(token, "disk_track_end"))        return (config_options_disk_track_end(cfg));
 		if (string_equal(token, "output_track_start"))    return (config_options_output_track_start(cfg));
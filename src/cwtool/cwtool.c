@@ -35,6 +35,7 @@
 
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -53,10 +54,13 @@
 #include "drive.h"
 #include "file.h"
 #include "string.h"
+#include "stage.h"
+#include "bench.h"
 
 
 
 static int				exit_code = 0;
+static pthread_mutex_t			info_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 
 
@@ -160,10 +164,10 @@ cwtool_info_error_details(
 
 
 /****************************************************************************
- * cwtool_info_print
+ * cwtool_info_print2
  ****************************************************************************/
 static void
-cwtool_info_print(
+cwtool_info_print2(
 	struct disk_info		*dsk_nfo,
 	int				summary)
 
@@ -209,12 +213,37 @@ cwtool_info_print(
 	if (selector == 7) string_snprintf(line, sizeof (line), "%3d tracks written (sectors: %4d)",
 		dsk_nfo->sum.tracks, dsk_nfo->sum.sectors_good);
 
-	verbose_message(CWTOOL_ILRW, 1, "%s", line);
+	/* with -B the summaries of several disks have to be told apart */
+
+	if ((summary) && (cmdline_get_mode() == CMDLINE_MODE_BATCH)) verbose_message(CWTOOL_ILRW, 1, "%s (%s)", line, dsk_nfo->path);
+	else verbose_message(CWTOOL_ILRW, 1, "%s", line);
 	if ((summary) && (dsk_nfo->sum.sectors_bad > 0)) cwtool_info_error_details(dsk_nfo);
 	}
 
 
 
+/****************************************************************************
+ * cwtool_info_print
+ ****************************************************************************/
+static void
+cwtool_info_print(
+	struct disk_info		*dsk_nfo,
+	int				summary)
+
+	{
+
+	/*
+	 * with -B several threads read disks at once, the details of a
+	 * summary must not get mixed with lines of other disks
+	 */
+
+	pthread_mutex_lock(&info_mutex);
+	cwtool_info_print2(dsk_nfo, summary);
+	pthread_mutex_unlock(&info_mutex);
+	}
+
+
+
 /****************************************************************************
  * cwtool_version
  ****************************************************************************/
@@ -304,13 +333,90 @@ cwtool_read(
 
 	{
 	struct disk			*dsk;
-	struct disk_option		dsk_opt = DISK_OPTION_INIT(cwtool_info_print, cmdline_get_retry(), DISK_OPTION_FLAG_NONE);
+	struct disk_option		dsk_opt = DISK_OPTION_INIT(cwtool_info_print, cmdline_get_retry(), cmdline_get_jobs(), cmdline_get_budget(), DISK_OPTION_FLAG_NONE);
 	cw_count_t			files = cmdline_get_files();
 
 	cmdline_read_config();
 	if (options_get_always_initialize()) drive_init_all_devices();
 	dsk = cwtool_get_disk();
+	if (cmdline_get_metrics() != NULL) stage_open(cmdline_get_metrics());
 	disk_read(dsk, &dsk_opt, cmdline_get_all_files(), files - 1, cmdline_get_file(files - 1), cmdline_get_output());
+	if (cmdline_get_metrics() != NULL) stage_close();
+	}
+
+
+
+/****************************************************************************
+ * cwtool_batch
+ ****************************************************************************/
+static void
+cwtool_batch(
+	void)
+
+	{
+	struct disk_batch		dsk_bat[CMDLINE_NR_BATCHES];
+	struct cmdline_batch		*bat;
+	struct disk_option		dsk_opt = DISK_OPTION_INIT(cwtool_info_print, cmdline_get_retry(), cmdline_get_jobs(), cmdline_get_budget(), DISK_OPTION_FLAG_NONE);
+	int				i;
+
+	cmdline_read_config();
+	if (options_get_always_initialize()) drive_init_all_devices();
+	for (i = 0; (bat = cmdline_get_batch(i)) != NULL; i++)
+		{
+		dsk_bat[i].dsk = disk_search(bat->disk_name);
+		if (dsk_bat[i].dsk == NULL) error_message("unknown disk name '%s'", bat->disk_name);
+		dsk_bat[i].path_src = bat->src;
+		dsk_bat[i].path_dst = bat->dst;
+		}
+	disk_read_batch(&dsk_opt, dsk_bat, i);
+	}
+
+
+
+/****************************************************************************
+ * cwtool_bench_disk
+ ****************************************************************************/
+static void
+cwtool_bench_disk(
+	struct disk			*dsk,
+	struct bench			*bnc)
+
+	{
+	if (disk_bench(dsk, bnc)) bench_print(bnc, disk_get_name(dsk));
+	else verbose_message(CWTOOL_ILRW, 1, "skipping disk '%s', its tracks can not be generated", disk_get_name(dsk));
+	}
+
+
+
+/****************************************************************************
+ * cwtool_bench
+ ****************************************************************************/
+static void
+cwtool_bench(
+	void)
+
+	{
+	struct bench			bnc = BENCH_INIT(cmdline_get_jitter(), cmdline_get_dropouts(), cmdline_get_drift(), cmdline_get_rounds());
+	struct disk			*dsk;
+	int				i;
+
+	cmdline_read_config();
+	setlinebuf(stdout);
+	stage_enable(CW_BOOL_TRUE);
+
+	/* without disk names all known disks are benchmarked */
+
+	if (cmdline_get_files() == 0)
+		{
+		for (i = 0; (dsk = disk_get(i)) != NULL; i++) cwtool_bench_disk(dsk, &bnc);
+		return;
+		}
+	for (i = 0; i < cmdline_get_files(); i++)
+		{
+		dsk = disk_search(cmdline_get_file(i));
+		if (dsk == NULL) error_message("unknown disk name '%s'", cmdline_get_file(i));
+		cwtool_bench_disk(dsk, &bnc);
+		}
 	}
 
 
@@ -325,12 +431,14 @@ cwtool_write(
 	{
 	struct disk			*dsk;
 	cw_flag_t			flags = (cmdline_get_flag(CMDLINE_FLAG_IGNORE_SIZE)) ? DISK_OPTION_FLAG_IGNORE_SIZE : DISK_OPTION_FLAG_NONE;
-	struct disk_option		dsk_opt = DISK_OPTION_INIT(cwtool_info_print, 0, flags);
+	struct disk_option		dsk_opt = DISK_OPTION_INIT(cwtool_info_print, 0, 1, 0, flags);
 
 	cmdline_read_config();
 	if (options_get_always_initialize()) drive_init_all_devices();
 	dsk = cwtool_get_disk();
+	if (cmdline_get_metrics() != NULL) stage_open(cmdline_get_metrics());
 	disk_write(dsk, &dsk_opt, cmdline_get_file(0), cmdline_get_file(1));
+	if (cmdline_get_metrics() != NULL) stage_close();
 	}
 
 
@@ -361,6 +469,8 @@ main(
 	else if (mode == CMDLINE_MODE_STATISTICS) cwtool_statistics();
 	else if (mode == CMDLINE_MODE_READ)       cwtool_read();
 	else if (mode == CMDLINE_MODE_WRITE)      cwtool_write();
+	else if (mode == CMDLINE_MODE_BATCH)      cwtool_batch();
+	else if (mode == CMDLINE_MODE_BENCH)      cwtool_bench();
 	else debug_error();
 
 	/* done */
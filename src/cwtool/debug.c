@@ -15,6 +15,7 @@
 
 #include "debug.h"
 #include "error.h"
+#include "global.h"
 
 
 
@@ -55,11 +56,25 @@ debug_message2(
 
 	{
 	va_list				args;
+	cw_char_t			prepend[GLOBAL_MAX_PATH_SIZE + 16] = "";
+	cw_bool_t			deferred;
+
+	/* a thread deferring its warnings also defers these messages */
+
+	if (debug_enabled) snprintf(prepend, sizeof (prepend), "%s:%d: ", file, line);
+	va_start(args, format);
+	deferred = error_defer_vprintf(prepend, format, args);
+	va_end(args);
+	if (deferred) return;
+
+	/* with -B several threads print, so a message is kept in one piece */
 
 	va_start(args, format);
+	flockfile(stderr);
 	if (debug_enabled) fprintf(stderr, "%s:%d: ", file, line);
 	vfprintf(stderr, format, args);
 	fprintf(stderr, "\n");
+	funlockfile(stderr);
 	va_end(args);
 	}
 
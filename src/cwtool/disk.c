@@ -13,6 +13,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "disk.h"
 #include "error.h"
@@ -22,10 +24,13 @@
 #include "options.h"
 #include "file.h"
 #include "fifo.h"
+#include "scratch.h"
 #include "image.h"
 #include "trackmap.h"
 #include "setvalue.h"
 #include "string.h"
+#include "stage.h"
+#include "bench.h"
 
 
 
@@ -35,6 +40,177 @@ struct disk_track_buffer
 	int				size;
 	};
 
+/*
+ * while reading from files or pipes, tracks may be decoded by several
+ * threads. the main thread reads all tries of a track from the source
+ * images and queues a struct disk_job, the worker threads decode it and
+ * the main thread writes the results in trackmap order. so the written
+ * image and the printed track infos are the same as with one thread
+ */
+
+#define DISK_JOB_STATE_FREE		0
+#define DISK_JOB_STATE_LOADED		1
+#define DISK_JOB_STATE_DECODED		2
+#define DISK_NR_JOB_INFOS		((GLOBAL_NR_RETRIES + 1) * GLOBAL_NR_IMAGES)
+#define DISK_JOB_STACK_SIZE		(8 * GLOBAL_MAX_TRACK_SIZE)
+
+struct disk_job_try
+	{
+	unsigned char			*data;
+	int				size;
+	int				flags;
+	};
+
+struct disk_job_info
+	{
+	cw_index_t			image;
+	int				try;
+	int				sectors_good;
+	int				sectors_weak;
+	int				sectors_bad;
+	};
+
+struct disk_job
+	{
+	cw_mode_t			state;
+	cw_index_t			trackmap_index;
+	cw_bool_t			write;
+	cw_bool_t			decode;
+	struct disk_job_try		try[GLOBAL_NR_IMAGES][GLOBAL_NR_RETRIES + 1];
+	cw_count_t			tries[GLOBAL_NR_IMAGES];
+	struct disk_job_info		nfo[DISK_NR_JOB_INFOS];
+	cw_count_t			infos;
+	cw_count_t			t;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS];
+	unsigned char			*data_dst;
+	struct fifo			ffo_dst;
+	struct container		*con;
+	struct error_defer		err_dfr;
+	};
+
+struct disk_pool
+	{
+	pthread_mutex_t			mutex;
+	pthread_cond_t			loaded;
+	pthread_cond_t			decoded;
+	struct disk			*dsk;
+	struct disk_option		*dsk_opt;
+	int				img_src_count;
+	struct disk_job			*job;
+	cw_count_t			jobs;
+	cw_count_t			jobs_loaded;
+	cw_count_t			jobs_taken;
+	cw_bool_t			quit;
+	};
+
+/*
+ * while reading from catweasel devices, one thread captures the tracks and
+ * the main thread decodes them. as soon as no more retries of a track are
+ * needed, the first try of the next track is requested, so the drive steps
+ * and reads while the main thread writes the track out. warnings and
+ * messages of the capture thread are deferred until the main thread takes
+ * the captured track, so they appear in the same order as without it
+ */
+
+#define DISK_CAPTURE_STATE_FREE		0
+#define DISK_CAPTURE_STATE_REQUESTED	1
+#define DISK_CAPTURE_STATE_CAPTURING	2
+#define DISK_CAPTURE_STATE_CAPTURED	3
+#define DISK_PIPE_NR_CAPTURES		3
+
+struct disk_capture
+	{
+	cw_mode_t			state;
+	cw_index_t			trackmap_index;
+	cw_index_t			image;
+	int				try;
+	cw_count_t			sequence;
+	cw_bool_t			urgent;
+	cw_bool_t			valid;
+	unsigned char			*data;
+	int				size;
+	int				flags;
+	struct error_defer		err_dfr;
+	};
+
+struct disk_pipe
+	{
+	pthread_mutex_t			mutex;
+	pthread_cond_t			requested;
+	pthread_cond_t			captured;
+	struct disk			*dsk;
+	union image			**img_src;
+	struct disk_capture		cap[DISK_PIPE_NR_CAPTURES];
+	cw_count_t			sequence;
+	cw_bool_t			quit;
+	};
+
+/*
+ * with a retry budget every track is read once first. afterwards only
+ * tracks with bad sectors are read again, alternating in descending and
+ * ascending order to keep head movements short, until the budget of
+ * seconds is spent. until all tracks are done each one keeps its decoded
+ * sectors. only DISK_DEFERRED_NR_CONTAINERS tracks with bad sectors also
+ * keep their container, so later tries of them are merged with the earlier
+ * ones. the other tracks decode each try on its own, if bad sectors are
+ * dumped they hold the container of their last read
+ *
+ * while reading from a pipe, the same struct is used to decode the tracks
+ * in the order they arrive. only the decoded track is kept until all
+ * tracks before it in trackmap order are written, its track infos are
+ * printed then. the containers are limited in the same way
+ */
+
+#define DISK_DEFERRED_NR_CONTAINERS	16
+#define DISK_DEFERRED_MSECS		1000
+
+struct disk_deferred
+	{
+	cw_bool_t			used;
+	cw_bool_t			write;
+	cw_bool_t			decode;
+	cw_bool_t			pending;
+	cw_count_t			cwtool_track;
+	cw_index_t			image;
+	int				try;
+	int				t;
+	struct disk_job_info		nfo[GLOBAL_NR_RETRIES + 1];
+	cw_count_t			infos;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS];
+	unsigned char			*data_dst;
+	struct fifo			ffo_dst;
+	struct container		*con;
+	cw_bool_t			merge;
+	};
+
+/*
+ * disk_read_batch() reads several disks at once. all disks in drives of
+ * the same controller are read one after another by one thread, because
+ * a controller can only access one drive at a time. each controller gets
+ * its own thread, so different controllers capture in parallel
+ */
+
+#define DISK_CONTROLLER_STACK_SIZE	(64 * GLOBAL_MAX_TRACK_SIZE)
+
+struct disk_controller
+	{
+	struct disk_option		*dsk_opt;
+	struct disk_batch		*bat[GLOBAL_NR_DRIVES];
+	int				batches;
+	};
+
+/*
+ * file for the raw data of bad sectors (option -o), tracks counts the
+ * tracks written to it so far
+ */
+
+struct disk_output
+	{
+	struct file			fil;
+	cw_count_t			tracks;
+	cw_bool_t			known;
+	};
+
 
 
 
@@ -282,20 +458,20 @@ static cw_void_t
 disk_dump_bad_sectors(
 	struct disk_track		*dsk_trk,
 	struct disk_sector		*dsk_sct,
-	struct file			*fil,
+	struct disk_output		*dsk_out,
 	struct container		*con,
 	cw_count_t			track,
 	cw_mode_t			clock)
 
 	{
-	static cw_count_t		t = 0;
-	static cw_bool_t		known = CW_BOOL_FALSE;
+	struct file			*fil;
 	cw_count_t			sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
 	cw_count_t			i, j;
 
 	if (track < options_get_output_track_start()) return;
 	if (track > options_get_output_track_end()) return;
-	if (fil == NULL) return;
+	if (dsk_out == NULL) return;
+	fil = &dsk_out->fil;
 	for (i = j = 0; i < sectors; i++) if (dsk_sct[i].err.errors != 0) j++;
 	if (j == 0) return;
 	file_write_string(fil, "# cwtool raw text 3\n");
@@ -307,23 +483,118 @@ disk_dump_bad_sectors(
 	for (i = 0; i < sectors; i++)
 		{
 		if (dsk_sct[i].err.errors == 0) continue;
-		t += disk_dump_bad_sector(fil, con, track, clock, dsk_sct[i].number);
+		dsk_out->tracks += disk_dump_bad_sector(fil, con, track, clock, dsk_sct[i].number);
 		}
 
-	/*
-	 * UGLY: using local static variables to count overall number of
-	 *       tracks and using IMAGE_RAW_NR_HINTS directly
-	 */
+	/* UGLY: using IMAGE_RAW_NR_HINTS directly */
 
-	if ((t >= IMAGE_RAW_NR_HINTS) && (! known))
+	if ((dsk_out->tracks >= IMAGE_RAW_NR_HINTS) && (! dsk_out->known))
 		{
 		error_warning("created bad sector output has too many tracks to be read at once");
-		known = CW_BOOL_TRUE;
+		dsk_out->known = CW_BOOL_TRUE;
 		}
 	}
 
 
 
+/****************************************************************************
+ * disk_image_read
+ ****************************************************************************/
+static int
+disk_image_read(
+	struct image_desc		*img_dsc,
+	union image			*img,
+	struct image_track		*img_trk,
+	struct fifo			*ffo,
+	struct disk_sector		*dsk_sct,
+	int				sectors,
+	int				track)
+
+	{
+	int				result;
+
+	/* images below level 1 contain one counter value per pulse */
+
+	stage_enter(IMAGE_READ);
+	result = img_dsc->track_read(img, img_trk, ffo, dsk_sct, sectors, track);
+	stage_count(IMAGE_READ, fifo_get_wr_ofs(ffo), (img_dsc->level == 0) ? fifo_get_wr_ofs(ffo) : 0);
+	stage_leave();
+	return (result);
+	}
+
+
+
+/****************************************************************************
+ * disk_image_write
+ ****************************************************************************/
+static int
+disk_image_write(
+	struct image_desc		*img_dsc,
+	union image			*img,
+	struct image_track		*img_trk,
+	struct fifo			*ffo,
+	struct disk_sector		*dsk_sct,
+	int				sectors,
+	int				track)
+
+	{
+	int				result;
+
+	stage_enter(IMAGE_WRITE);
+	stage_count(IMAGE_WRITE, fifo_get_wr_ofs(ffo), (img_dsc->level == 0) ? fifo_get_wr_ofs(ffo) : 0);
+	result = img_dsc->track_write(img, img_trk, ffo, dsk_sct, sectors, track);
+	stage_leave();
+	return (result);
+	}
+
+
+
+/****************************************************************************
+ * disk_format_read
+ ****************************************************************************/
+static void
+disk_format_read(
+	struct disk_track		*dsk_trk,
+	struct container		*con,
+	struct fifo			*ffo_src,
+	struct fifo			*ffo_dst,
+	struct disk_sector		*dsk_sct,
+	cw_count_t			cwtool_track,
+	cw_count_t			format_track,
+	cw_count_t			format_side)
+
+	{
+	stage_enter(DECODE);
+	stage_count(DECODE, fifo_get_wr_ofs(ffo_dst), fifo_get_wr_ofs(ffo_src));
+	if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+	stage_leave();
+	}
+
+
+
+/****************************************************************************
+ * disk_format_write
+ ****************************************************************************/
+static void
+disk_format_write(
+	struct disk_track		*dsk_trk,
+	struct fifo			*ffo_src,
+	struct disk_sector		*dsk_sct,
+	struct fifo			*ffo_dst,
+	unsigned char			*data,
+	cw_count_t			cwtool_track,
+	cw_count_t			format_track,
+	cw_count_t			format_side)
+
+	{
+	stage_enter(ENCODE);
+	if (! dsk_trk->fmt_dsc->track_write(&dsk_trk->fmt, ffo_src, dsk_sct, ffo_dst, data, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+	stage_count(ENCODE, fifo_get_wr_ofs(ffo_src), fifo_get_wr_ofs(ffo_dst));
+	stage_leave();
+	}
+
+
+
 /****************************************************************************
  * disk_track_statistics
  ****************************************************************************/
@@ -336,8 +607,8 @@ disk_track_statistics(
 	{
 	struct trackmap_entry		*trm_ent;
 	struct disk_track		*dsk_trk;
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE] = { };
-	struct fifo			ffo = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 	cw_count_t			cwtool_track, format_track, format_side;
 
 	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
@@ -358,7 +629,7 @@ disk_track_statistics(
 
 	/* skip this track if it is optional and we got no data */
 
-	if (! dsk->img_dsc_l0->track_read(img, &dsk_trk->img_trk, &ffo, NULL, 0, cwtool_track))
+	if (! disk_image_read(dsk->img_dsc_l0, img, &dsk_trk->img_trk, &ffo, NULL, 0, cwtool_track))
 		{
 		if (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL) goto done;
 		error_message("no data available for track %d", cwtool_track);
@@ -366,6 +637,222 @@ disk_track_statistics(
 	dsk_trk->fmt_dsc->track_statistics(&dsk_trk->fmt, &ffo, cwtool_track, format_track, format_side);
 done:
 	dsk->img_dsc_l0->track_done(img, &dsk_trk->img_trk, cwtool_track);
+	scratch_put(data);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_wanted
+ ****************************************************************************/
+static cw_bool_t
+disk_track_wanted(
+	struct disk			*dsk,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	cw_count_t			cwtool_track;
+
+	/* same checks as in disk_track_read_nongreedy() */
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+	if (dsk_trk->fmt_dsc == NULL) return (CW_BOOL_FALSE);
+	if (dsk_trk->fmt_dsc->get_sector_size(&dsk_trk->fmt, -1) == 0) return (CW_BOOL_FALSE);
+	if (cwtool_track < options_get_disk_track_start()) return (CW_BOOL_FALSE);
+	if (cwtool_track > options_get_disk_track_end()) return (CW_BOOL_FALSE);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_pipe_request
+ ****************************************************************************/
+static struct disk_capture *
+disk_pipe_request(
+	struct disk_pipe		*pip,
+	cw_index_t			trackmap_index,
+	cw_index_t			image,
+	int				try,
+	cw_bool_t			urgent)
+
+	{
+	struct disk_capture		*cap;
+	cw_index_t			i;
+
+	/* pip->mutex has to be locked by the caller */
+
+	for (i = 0; i < DISK_PIPE_NR_CAPTURES; i++)
+		{
+		cap = &pip->cap[i];
+		if ((cap->state == DISK_CAPTURE_STATE_FREE) || (cap->trackmap_index != trackmap_index) ||
+			(cap->image != image) || (cap->try != try)) continue;
+		if (urgent) cap->urgent = CW_BOOL_TRUE;
+		return (cap);
+		}
+	for (i = 0; pip->cap[i].state != DISK_CAPTURE_STATE_FREE; i++) debug_error_condition(i + 1 >= DISK_PIPE_NR_CAPTURES);
+	cap = &pip->cap[i];
+	cap->state          = DISK_CAPTURE_STATE_REQUESTED;
+	cap->trackmap_index = trackmap_index;
+	cap->image          = image;
+	cap->try            = try;
+	cap->sequence       = pip->sequence++;
+	cap->urgent         = urgent;
+	pthread_cond_signal(&pip->requested);
+	return (cap);
+	}
+
+
+
+/****************************************************************************
+ * disk_pipe_next
+ ****************************************************************************/
+static struct disk_capture *
+disk_pipe_next(
+	struct disk_pipe		*pip)
+
+	{
+	struct disk_capture		*cap, *next = NULL;
+	cw_index_t			i;
+
+	/* urgent requests first, otherwise the oldest one */
+
+	for (i = 0; i < DISK_PIPE_NR_CAPTURES; i++)
+		{
+		cap = &pip->cap[i];
+		if (cap->state != DISK_CAPTURE_STATE_REQUESTED) continue;
+		if ((next == NULL) || (cap->urgent > next->urgent) ||
+			((cap->urgent == next->urgent) && (cap->sequence < next->sequence))) next = cap;
+		}
+	return (next);
+	}
+
+
+
+/****************************************************************************
+ * disk_pipe_capture
+ ****************************************************************************/
+static void
+disk_pipe_capture(
+	struct disk_pipe		*pip,
+	struct disk_capture		*cap)
+
+	{
+	struct disk			*dsk = pip->dsk;
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct fifo			ffo = FIFO_INIT(cap->data, GLOBAL_MAX_TRACK_SIZE);
+	cw_count_t			cwtool_track;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, cap->trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+	cap->valid = disk_image_read(dsk->img_dsc_l0, pip->img_src[cap->image], &dsk_trk->img_trk, &ffo, NULL, 0, cwtool_track);
+	cap->size  = fifo_get_wr_ofs(&ffo);
+	cap->flags = fifo_get_flags(&ffo);
+	}
+
+
+
+/****************************************************************************
+ * disk_pipe_thread
+ ****************************************************************************/
+static void *
+disk_pipe_thread(
+	void				*arg)
+
+	{
+	struct disk_pipe		*pip = (struct disk_pipe *) arg;
+	struct disk_capture		*cap;
+
+	while (1)
+		{
+		pthread_mutex_lock(&pip->mutex);
+		while (((cap = disk_pipe_next(pip)) == NULL) && (! pip->quit)) pthread_cond_wait(&pip->requested, &pip->mutex);
+		if (cap == NULL)
+			{
+			pthread_mutex_unlock(&pip->mutex);
+			break;
+			}
+		cap->state = DISK_CAPTURE_STATE_CAPTURING;
+		pthread_mutex_unlock(&pip->mutex);
+		error_defer(&cap->err_dfr);
+		disk_pipe_capture(pip, cap);
+		error_defer(NULL);
+		pthread_mutex_lock(&pip->mutex);
+		cap->state = DISK_CAPTURE_STATE_CAPTURED;
+		pthread_cond_broadcast(&pip->captured);
+		pthread_mutex_unlock(&pip->mutex);
+		}
+	return (NULL);
+	}
+
+
+
+/****************************************************************************
+ * disk_pipe_get
+ ****************************************************************************/
+static int
+disk_pipe_get(
+	struct disk_pipe		*pip,
+	struct fifo			*ffo,
+	cw_index_t			trackmap_index,
+	cw_index_t			image,
+	int				try)
+
+	{
+	struct disk_capture		*cap;
+	int				valid;
+
+	pthread_mutex_lock(&pip->mutex);
+	cap = disk_pipe_request(pip, trackmap_index, image, try, CW_BOOL_TRUE);
+	while (cap->state != DISK_CAPTURE_STATE_CAPTURED) pthread_cond_wait(&pip->captured, &pip->mutex);
+	pthread_mutex_unlock(&pip->mutex);
+
+	/* warnings of the capture thread are printed now, before decoding */
+
+	error_defer_flush(&cap->err_dfr);
+	valid = cap->valid;
+	if (valid)
+		{
+		memcpy(fifo_get_data(ffo), cap->data, cap->size);
+		fifo_set_wr_ofs(ffo, cap->size);
+		fifo_set_flags(ffo, cap->flags);
+		}
+	pthread_mutex_lock(&pip->mutex);
+	cap->state = DISK_CAPTURE_STATE_FREE;
+	pthread_mutex_unlock(&pip->mutex);
+	return (valid);
+	}
+
+
+
+/****************************************************************************
+ * disk_pipe_ahead
+ ****************************************************************************/
+static void
+disk_pipe_ahead(
+	struct disk_pipe		*pip,
+	cw_index_t			trackmap_index)
+
+	{
+	cw_count_t			entries = trackmap_entries(pip->dsk->trm);
+	cw_index_t			i;
+
+	/*
+	 * called after the last try of a track is decoded. the head stays
+	 * on the track until then, so a retry needs no steps back and forth
+	 */
+
+	for (i = trackmap_index + 1; (i < entries) && (! disk_track_wanted(pip->dsk, i)); i++) ;
+	if (i == entries) return;
+	pthread_mutex_lock(&pip->mutex);
+	disk_pipe_request(pip, i, 0, 0, CW_BOOL_FALSE);
+	pthread_mutex_unlock(&pip->mutex);
 	}
 
 
@@ -418,11 +905,11 @@ disk_track_read_greedy2(
 		 * we simply ignore this track
 		 */
 
-		if (! dsk->img_dsc_l0->track_read(img_src, &dsk_trk->img_trk, ffo_src, NULL, 0, cwtool_track)) break;
-		if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+		if (! disk_image_read(dsk->img_dsc_l0, img_src, &dsk_trk->img_trk, ffo_src, NULL, 0, cwtool_track)) break;
+		disk_format_read(dsk_trk, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side);
 		disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 0);
 		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
-		dsk->img_dsc->track_write(img_dst, &dsk_trk->img_trk, ffo_dst, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
+		disk_image_write(dsk->img_dsc, img_dst, &dsk_trk->img_trk, ffo_dst, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
 		}
 	return (t);
 	}
@@ -441,205 +928,1298 @@ disk_track_read_greedy(
 	union image			**img_src,
 	int				img_src_count,
 	union image			*img_dst,
-	struct file			*fil_output,
+	struct disk_output		*fil_output,
+	struct container		*con,
 	int				trackmap_index)
 
 	{
 	struct trackmap_entry		*trm_ent;
 	struct disk_track		*dsk_trk;
 	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
-	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { };
-	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE] = { };
-	struct container		*con;
-	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
-	struct fifo			ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
+	unsigned char			*data_src = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	unsigned char			*data_dst = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_src = FIFO_INIT(data_src, GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_dst = FIFO_INIT(data_dst, GLOBAL_MAX_TRACK_SIZE);
 	int				offset  = dsk->img_dsc->offset(img_dst);
 	cw_count_t			cwtool_track;
 	int				i, t = 0;
 
-	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+
+	/*
+	 * if this track is not within the wanted range, ignore it. because
+	 * the format is greedy there is no fixed size for the data to be
+	 * written, so nothing is written to img_dst
+	 */
+
+	if (cwtool_track < options_get_disk_track_start()) goto done;
+	if (cwtool_track > options_get_disk_track_end()) goto done;
+
+	/*
+	 * skip this track if ffo_dst would contain 0 bytes, this is the case
+	 * with format fill
+	 */
+
+	if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) goto done;
+	memset(data_dst, 0, fifo_get_wr_ofs(&ffo_dst));
+	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+
+	container_reset(con);
+	for (i = 0; i < img_src_count; i++)
+		{
+		disk_info_update_path(dsk_nfo, path_src[i]);
+		t += disk_track_read_greedy2(dsk, dsk_sct, dsk_opt, dsk_nfo, img_src[i], img_dst, con, &ffo_src, &ffo_dst, trackmap_index);
+		}
+	disk_dump_bad_sectors(dsk_trk, dsk_sct, fil_output, con, cwtool_track, dsk_trk->img_trk.clock);
+	if ((t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
+	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 1);
+done:
+	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	scratch_put(data_dst);
+	scratch_put(data_src);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read_nongreedy2
+ ****************************************************************************/
+static int
+disk_track_read_nongreedy2(
+	struct disk			*dsk,
+	struct disk_sector		*dsk_sct,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	union image			**img_src,
+	struct disk_pipe		*pip,
+	cw_index_t			image,
+	struct container		*con,
+	struct fifo			*ffo_src,
+	struct fifo			*ffo_dst,
+	int				offset,
+	int				trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	cw_count_t			cwtool_track, format_track, format_side;
+	int				b, t, valid;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+	for (b = -1, t = 0; (b != 0) && (t <= dsk_opt->retry); t++)
+		{
+		fifo_reset(ffo_src);
+
+		/*
+		 * if this track is optional and we could not read
+		 * it, because the drive only supports double steps,
+		 * we simply ignore this track
+		 */
+
+		if (pip != NULL) valid = disk_pipe_get(pip, ffo_src, trackmap_index, image, t);
+		else valid = disk_image_read(dsk->img_dsc_l0, img_src[image], &dsk_trk->img_trk, ffo_src, NULL, 0, cwtool_track);
+		if (! valid) break;
+		disk_format_read(dsk_trk, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side);
+		disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 0);
+		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
+		b = dsk_nfo->sectors_bad;
+		}
+	return (t);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read_nongreedy
+ ****************************************************************************/
+static void
+disk_track_read_nongreedy(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct disk_output		*fil_output,
+	struct container		*con,
+	struct disk_pipe		*pip,
+	int				trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
+	unsigned char			*data_src = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	unsigned char			*data_dst = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_src = FIFO_INIT(data_src, GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_dst = FIFO_INIT(data_dst, GLOBAL_MAX_TRACK_SIZE);
+	int				offset  = dsk->img_dsc->offset(img_dst);
+	int				i, t = 0;
+	cw_count_t			cwtool_track, image_track;
+
+	/*
+	 * skip this track if ffo_dst would contain 0 bytes, this is the case
+	 * with format fill
+	 */
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	image_track = trackmap_entry_get_image_track(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+	if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) goto done;
+	memset(data_dst, 0, fifo_get_wr_ofs(&ffo_dst));
+	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+
+	/*
+	 * if this track is not within the wanted range, just write zeros
+	 * to img_dst and skip all reading routines. thats why
+	 * disk_sectors_init() can not be skipped
+	 */
+
+	if (cwtool_track < options_get_disk_track_start()) goto done_write;
+	if (cwtool_track > options_get_disk_track_end()) goto done_write;
+
+	container_reset(con);
+	for (i = 0; i < img_src_count; i++)
+		{
+		disk_info_update_path(dsk_nfo, path_src[i]);
+		t += disk_track_read_nongreedy2(dsk, dsk_sct, dsk_opt, dsk_nfo, img_src, pip, i, con, &ffo_src, &ffo_dst, offset, trackmap_index);
+		if ((t > 0) && (dsk_nfo->sectors_bad == 0)) break;
+		}
+	if (pip != NULL) disk_pipe_ahead(pip, trackmap_index);
+	disk_dump_bad_sectors(dsk_trk, dsk_sct, fil_output, con, cwtool_track, dsk_trk->img_trk.clock);
+	if ((t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
+	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 1);
+done_write:
+	disk_image_write(dsk->img_dsc, img_dst, &dsk_trk->img_trk, &ffo_dst, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
+done:
+	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	scratch_put(data_dst);
+	scratch_put(data_src);
+	}
+
+
+
+/****************************************************************************
+ * disk_track_read
+ ****************************************************************************/
+static void
+disk_track_read(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct disk_output		*fil_output,
+	struct container		*con,
+	struct disk_pipe		*pip,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	cw_count_t			cwtool_track;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+
+	/* skip this track if no format is defined */
+
+	if (dsk_trk->fmt_dsc == NULL) return;
+	debug_error_condition(dsk_trk->fmt_dsc->get_flags == NULL);
+	stage_track(cwtool_track);
+	if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) disk_track_read_greedy(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, con, trackmap_index);
+	else disk_track_read_nongreedy(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, con, pip, trackmap_index);
+	stage_track(STAGE_NO_TRACK);
+	}
+
+
+
+/****************************************************************************
+ * disk_job_load
+ ****************************************************************************/
+static cw_bool_t
+disk_job_load(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_job			*job,
+	union image			**img_src,
+	int				img_src_count,
+	struct fifo			*ffo,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct disk_job_try		*job_try;
+	cw_count_t			cwtool_track;
+	cw_bool_t			empty = CW_BOOL_FALSE;
+	int				i, t;
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+	job->trackmap_index = trackmap_index;
+	job->write          = CW_BOOL_FALSE;
+	job->decode         = CW_BOOL_FALSE;
+	job->infos          = 0;
+	job->t              = 0;
+	memset(job->tries, 0, sizeof (job->tries));
+	if (dsk_trk->fmt_dsc == NULL) return (empty);
+
+	/* same checks as in disk_track_read_nongreedy() */
+
+	memset(job->dsk_sct, 0, sizeof (job->dsk_sct));
+	job->ffo_dst = FIFO_INIT(job->data_dst, GLOBAL_MAX_TRACK_SIZE);
+	if (disk_sectors_init(job->dsk_sct, dsk_trk, &job->ffo_dst, 0) == 0) goto done;
+	memset(job->data_dst, 0, fifo_get_wr_ofs(&job->ffo_dst));
+	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+	job->write = CW_BOOL_TRUE;
+	if (cwtool_track < options_get_disk_track_start()) goto done;
+	if (cwtool_track > options_get_disk_track_end()) goto done;
+	job->decode = CW_BOOL_TRUE;
+	empty       = CW_BOOL_TRUE;
+
+	/*
+	 * it is not known yet how many tries will be needed, so all
+	 * available tries are read. unused tries would otherwise be skipped
+	 * later, because the track is done after this
+	 */
+
+	for (i = 0; i < img_src_count; i++)
+		{
+		for (t = 0; t <= dsk_opt->retry; t++)
+			{
+			fifo_reset(ffo);
+			if (! disk_image_read(dsk->img_dsc_l0, img_src[i], &dsk_trk->img_trk, ffo, NULL, 0, cwtool_track)) break;
+			job_try = &job->try[i][t];
+			job_try->size  = fifo_get_wr_ofs(ffo);
+			job_try->flags = fifo_get_flags(ffo);
+			job_try->data  = malloc(job_try->size * sizeof (unsigned char));
+			if (job_try->data == NULL) error_oom();
+			memcpy(job_try->data, fifo_get_data(ffo), job_try->size);
+			}
+		job->tries[i] = t;
+		if (t > 0) empty = CW_BOOL_FALSE;
+		}
+done:
+	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	return (empty);
+	}
+
+
+
+/****************************************************************************
+ * disk_job_decode
+ ****************************************************************************/
+static void
+disk_job_decode(
+	struct disk_pool		*pol,
+	struct disk_job			*job,
+	struct disk_info		*dsk_nfo,
+	struct fifo			*ffo_src)
+
+	{
+	struct disk			*dsk = pol->dsk;
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct disk_job_try		*job_try;
+	cw_count_t			cwtool_track, format_track, format_side;
+	int				b, i, t;
+
+	if (! job->decode) return;
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, job->trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+
+	/* same as disk_track_read_nongreedy2(), but with preloaded tries */
+
+	container_reset(job->con);
+	for (i = 0; i < pol->img_src_count; i++)
+		{
+		for (b = -1, t = 0; (b != 0) && (t < job->tries[i]); t++)
+			{
+			job_try = &job->try[i][t];
+			fifo_reset(ffo_src);
+			memcpy(fifo_get_data(ffo_src), job_try->data, job_try->size);
+			fifo_set_wr_ofs(ffo_src, job_try->size);
+			fifo_set_flags(ffo_src, job_try->flags);
+			disk_format_read(dsk_trk, job->con, ffo_src, &job->ffo_dst, job->dsk_sct, cwtool_track, format_track, format_side);
+			disk_info_update(dsk_nfo, dsk_trk, job->dsk_sct, cwtool_track, t, 0, 0);
+			job->nfo[job->infos++] = (struct disk_job_info)
+				{
+				.image        = i,
+				.try          = t,
+				.sectors_good = dsk_nfo->sectors_good,
+				.sectors_weak = dsk_nfo->sectors_weak,
+				.sectors_bad  = dsk_nfo->sectors_bad
+				};
+			b = dsk_nfo->sectors_bad;
+			}
+		job->t += t;
+		if ((job->t > 0) && (dsk_nfo->sectors_bad == 0)) break;
+		}
+
+	/* the raw data is not needed anymore */
+
+	for (i = 0; i < pol->img_src_count; i++)
+		{
+		for (t = 0; t < job->tries[i]; t++) free(job->try[i][t].data);
+		job->tries[i] = 0;
+		}
+	}
+
+
+
+/****************************************************************************
+ * disk_job_commit
+ ****************************************************************************/
+static void
+disk_job_commit(
+	struct disk_pool		*pol,
+	struct disk_job			*job,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			*img_dst,
+	struct disk_output		*fil_output)
+
+	{
+	struct disk			*dsk = pol->dsk;
+	struct disk_option		*dsk_opt = pol->dsk_opt;
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	cw_count_t			cwtool_track, image_track;
+	cw_index_t			i;
+
+	pthread_mutex_lock(&pol->mutex);
+	while (job->state != DISK_JOB_STATE_DECODED) pthread_cond_wait(&pol->decoded, &pol->mutex);
+	pthread_mutex_unlock(&pol->mutex);
+	error_defer_flush(&job->err_dfr);
+	if (! job->write) goto done;
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, job->trackmap_index);
+	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+	image_track  = trackmap_entry_get_image_track(dsk->trm, trm_ent);
+	dsk_trk = &dsk->trk[cwtool_track];
+	if (! job->decode) goto done_write;
+
+	/* replay the infos of all tries, as if read one after another */
+
+	for (i = 0; i < job->infos; i++)
+		{
+		disk_info_update_path(dsk_nfo, path_src[job->nfo[i].image]);
+		dsk_nfo->track        = cwtool_track;
+		dsk_nfo->try          = job->nfo[i].try;
+		dsk_nfo->sectors_good = job->nfo[i].sectors_good;
+		dsk_nfo->sectors_weak = job->nfo[i].sectors_weak;
+		dsk_nfo->sectors_bad  = job->nfo[i].sectors_bad;
+		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
+		}
+	disk_dump_bad_sectors(dsk_trk, job->dsk_sct, fil_output, job->con, cwtool_track, dsk_trk->img_trk.clock);
+	if ((job->t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
+	disk_info_update(dsk_nfo, dsk_trk, job->dsk_sct, cwtool_track, job->t, dsk->img_dsc->offset(img_dst), 1);
+done_write:
+	disk_image_write(dsk->img_dsc, img_dst, &dsk_trk->img_trk, &job->ffo_dst, job->dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
+done:
+	job->state = DISK_JOB_STATE_FREE;
+	}
+
+
+
+/****************************************************************************
+ * disk_job_thread
+ ****************************************************************************/
+static void *
+disk_job_thread(
+	void				*arg)
+
+	{
+	struct disk_pool		*pol = (struct disk_pool *) arg;
+	struct disk_job			*job;
+	struct disk_info		*dsk_nfo;
+	unsigned char			*data;
+	struct fifo			ffo;
+
+	dsk_nfo = (struct disk_info *) malloc(sizeof (struct disk_info));
+	data    = (unsigned char *) malloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	if ((dsk_nfo == NULL) || (data == NULL)) error_oom();
+	memset(data, 0, GLOBAL_MAX_TRACK_SIZE);
+	ffo = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
+	while (1)
+		{
+		pthread_mutex_lock(&pol->mutex);
+		while ((! pol->quit) && (pol->jobs_taken >= pol->jobs_loaded)) pthread_cond_wait(&pol->loaded, &pol->mutex);
+		if (pol->jobs_taken >= pol->jobs_loaded)
+			{
+			pthread_mutex_unlock(&pol->mutex);
+			break;
+			}
+		job = &pol->job[pol->jobs_taken++ % pol->jobs];
+		pthread_mutex_unlock(&pol->mutex);
+		*dsk_nfo = (struct disk_info) { };
+		disk_job_decode(pol, job, dsk_nfo, &ffo);
+		pthread_mutex_lock(&pol->mutex);
+		job->state = DISK_JOB_STATE_DECODED;
+		pthread_cond_broadcast(&pol->decoded);
+		pthread_mutex_unlock(&pol->mutex);
+		}
+	scratch_free();
+	free(data);
+	free(dsk_nfo);
+	return (NULL);
+	}
+
+
+
+/****************************************************************************
+ * disk_read_greedy
+ ****************************************************************************/
+static cw_bool_t
+disk_read_greedy(
+	struct disk			*dsk)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	cw_count_t			entries;
+	cw_index_t			i;
+
+	entries = trackmap_entries(dsk->trm);
+	for (i = 0; i < entries; i++)
+		{
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		dsk_trk = &dsk->trk[trackmap_entry_get_cwtool_track(dsk->trm, trm_ent)];
+		if (dsk_trk->fmt_dsc == NULL) continue;
+		debug_error_condition(dsk_trk->fmt_dsc->get_flags == NULL);
+		if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) return (CW_BOOL_TRUE);
+		}
+	return (CW_BOOL_FALSE);
+	}
+
+
+
+/****************************************************************************
+ * disk_read_threads_veto
+ ****************************************************************************/
+static const char *
+disk_read_threads_veto(
+	struct disk			*dsk)
+
+	{
+
+	/*
+	 * messages of the format and image code would be printed out in
+	 * a different order, so only the track infos are allowed. greedy
+	 * formats write each try directly, they are left to the serial code.
+	 * stage counters are only collected for the calling thread
+	 */
+
+	if (stage_enabled()) return ("stage counters are enabled");
+	if (verbose_get_level(VERBOSE_CLASS_GENERIC) > VERBOSE_LEVEL_NONE) return ("verbose output is enabled");
+	if (debug_get_level(DEBUG_CLASS_GENERIC) > DEBUG_LEVEL_NONE) return ("debug output is enabled");
+	if (dsk->img_dsc_l0->offline == NULL) return ("the source image type does not support it");
+	if (disk_read_greedy(dsk)) return ("raw formats are copied as they are read");
+	return (NULL);
+	}
+
+
+
+/****************************************************************************
+ * disk_read_threads_ok
+ ****************************************************************************/
+static cw_bool_t
+disk_read_threads_ok(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt)
+
+	{
+	if (dsk_opt->jobs < 2) return (CW_BOOL_FALSE);
+	return (disk_read_threads_veto(dsk) == NULL);
+	}
+
+
+
+/****************************************************************************
+ * disk_read_parallel_ok
+ ****************************************************************************/
+static cw_bool_t
+disk_read_parallel_ok(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	union image			**img_src,
+	int				img_src_count)
+
+	{
+	cw_index_t			i;
+
+	if (! disk_read_threads_ok(dsk, dsk_opt)) return (CW_BOOL_FALSE);
+	for (i = 0; i < img_src_count; i++) if (! dsk->img_dsc_l0->offline(img_src[i])) return (CW_BOOL_FALSE);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_read_pipeline_ok
+ ****************************************************************************/
+static cw_bool_t
+disk_read_pipeline_ok(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	union image			**img_src,
+	int				img_src_count)
+
+	{
+	cw_index_t			i;
+
+	/*
+	 * the capture thread is the only one accessing the sources, this is
+	 * only true for devices, files also get touched by track_done().
+	 * it needs no -j, because decoding stays in the calling thread. its
+	 * messages are deferred, so unlike disk_read_threads_veto() verbose
+	 * and debug output are no reason against it
+	 */
+
+	if (stage_enabled()) return (CW_BOOL_FALSE);
+	if (dsk->img_dsc_l0->offline == NULL) return (CW_BOOL_FALSE);
+	if (disk_read_greedy(dsk)) return (CW_BOOL_FALSE);
+	for (i = 0; i < img_src_count; i++) if (dsk->img_dsc_l0->offline(img_src[i])) return (CW_BOOL_FALSE);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_read_parallel
+ ****************************************************************************/
+static void
+disk_read_parallel(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct disk_output		*fil_output)
+
+	{
+	struct disk_pool		pol =
+		{
+		.mutex         = PTHREAD_MUTEX_INITIALIZER,
+		.loaded        = PTHREAD_COND_INITIALIZER,
+		.decoded       = PTHREAD_COND_INITIALIZER,
+		.dsk           = dsk,
+		.dsk_opt       = dsk_opt,
+		.img_src_count = img_src_count,
+		.jobs          = 2 * dsk_opt->jobs
+		};
+	pthread_t			thr[GLOBAL_NR_JOBS];
+	pthread_attr_t			attr;
+	unsigned char			*data;
+	struct fifo			ffo;
+	cw_count_t			entries, committed;
+	cw_bool_t			empty;
+	cw_index_t			i;
+
+	pol.job = (struct disk_job *) malloc(pol.jobs * sizeof (struct disk_job));
+	data    = (unsigned char *) malloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+	if ((pol.job == NULL) || (data == NULL)) error_oom();
+	for (i = 0; i < pol.jobs; i++)
+		{
+		pol.job[i].state    = DISK_JOB_STATE_FREE;
+		pol.job[i].data_dst = (unsigned char *) malloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+		pol.job[i].con      = container_init(NULL);
+		if (pol.job[i].data_dst == NULL) error_oom();
+		}
+	ffo = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
+
+	/* start worker threads */
+
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, DISK_JOB_STACK_SIZE);
+	for (i = 0; i < dsk_opt->jobs; i++) if (pthread_create(&thr[i], &attr, disk_job_thread, &pol) != 0) error_message("could not create thread");
+	pthread_attr_destroy(&attr);
+
+	/*
+	 * load tracks in trackmap order, if all jobs are in use wait for
+	 * the oldest one and write it out
+	 */
+
+	entries = trackmap_entries(dsk->trm);
+	for (i = committed = 0; i < entries; i++)
+		{
+		if (i - committed >= pol.jobs) disk_job_commit(&pol, &pol.job[committed++ % pol.jobs], dsk_nfo, path_src, img_dst, fil_output);
+		error_defer(&pol.job[i % pol.jobs].err_dfr);
+		empty = disk_job_load(dsk, dsk_opt, &pol.job[i % pol.jobs], img_src, img_src_count, &ffo, i);
+		error_defer(NULL);
+		pthread_mutex_lock(&pol.mutex);
+		pol.job[i % pol.jobs].state = DISK_JOB_STATE_LOADED;
+		pol.jobs_loaded++;
+		pthread_cond_signal(&pol.loaded);
+		pthread_mutex_unlock(&pol.mutex);
+
+		/*
+		 * a track without data may stop cwtool, so all previous
+		 * tracks have to be written before loading the next one
+		 */
+
+		if (empty) while (committed <= i) disk_job_commit(&pol, &pol.job[committed++ % pol.jobs], dsk_nfo, path_src, img_dst, fil_output);
+		}
+	while (committed < entries) disk_job_commit(&pol, &pol.job[committed++ % pol.jobs], dsk_nfo, path_src, img_dst, fil_output);
+
+	/* stop worker threads */
+
+	pthread_mutex_lock(&pol.mutex);
+	pol.quit = CW_BOOL_TRUE;
+	pthread_cond_broadcast(&pol.loaded);
+	pthread_mutex_unlock(&pol.mutex);
+	for (i = 0; i < dsk_opt->jobs; i++) pthread_join(thr[i], NULL);
+	for (i = 0; i < pol.jobs; i++)
+		{
+		free(pol.job[i].data_dst);
+		container_deinit(pol.job[i].con);
+		}
+	free(pol.job);
+	free(data);
+	}
+
+
+
+/****************************************************************************
+ * disk_read_pipeline
+ ****************************************************************************/
+static void
+disk_read_pipeline(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct disk_output		*fil_output)
+
+	{
+	struct disk_pipe		pip =
+		{
+		.mutex     = PTHREAD_MUTEX_INITIALIZER,
+		.requested = PTHREAD_COND_INITIALIZER,
+		.captured  = PTHREAD_COND_INITIALIZER,
+		.dsk       = dsk,
+		.img_src   = img_src
+		};
+	pthread_t			thr;
+	pthread_attr_t			attr;
+	struct container		con;
+	cw_count_t			entries;
+	cw_index_t			i;
+
+	for (i = 0; i < DISK_PIPE_NR_CAPTURES; i++)
+		{
+		pip.cap[i].data = (unsigned char *) malloc(GLOBAL_MAX_TRACK_SIZE * sizeof (unsigned char));
+		if (pip.cap[i].data == NULL) error_oom();
+		}
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, DISK_JOB_STACK_SIZE);
+	if (pthread_create(&thr, &attr, disk_pipe_thread, &pip) != 0) error_message("could not create thread");
+	pthread_attr_destroy(&attr);
+
+	/* decoding and writing is done as without capture thread */
+
+	container_init(&con);
+	entries = trackmap_entries(dsk->trm);
+	for (i = 0; i < entries; i++) disk_track_read(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, &con, &pip, i);
+	container_deinit(&con);
+
+	/* stop capture thread */
+
+	pthread_mutex_lock(&pip.mutex);
+	pip.quit = CW_BOOL_TRUE;
+	pthread_cond_broadcast(&pip.requested);
+	pthread_mutex_unlock(&pip.mutex);
+	pthread_join(thr, NULL);
+	for (i = 0; i < DISK_PIPE_NR_CAPTURES; i++) free(pip.cap[i].data);
+	}
+
+
+
+/****************************************************************************
+ * disk_deferred_time
+ ****************************************************************************/
+static cw_count64_t
+disk_deferred_time(
+	cw_void_t)
+
+	{
+	struct timespec			ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) error_perror_message("error while clock_gettime()");
+	return ((cw_count64_t) ts.tv_sec * DISK_DEFERRED_MSECS + ts.tv_nsec / 1000000);
+	}
+
+
+
+/****************************************************************************
+ * disk_deferred_load
+ ****************************************************************************/
+static void
+disk_deferred_load(
+	struct disk			*dsk,
+	struct disk_deferred		*dfr,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	int				size;
+
+	/* same checks as in disk_track_read() and disk_track_read_nongreedy() */
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	*dfr = (struct disk_deferred) { .cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent) };
+	dsk_trk = &dsk->trk[dfr->cwtool_track];
+	if (dsk_trk->fmt_dsc == NULL) return;
+	dfr->used = CW_BOOL_TRUE;
+	size = dsk_trk->fmt_dsc->get_sector_size(&dsk_trk->fmt, -1);
+	if (size == 0) return;
+	dfr->data_dst = (unsigned char *) malloc(size * sizeof (unsigned char));
+	if (dfr->data_dst == NULL) error_oom();
+	memset(dfr->data_dst, 0, size);
+	dfr->ffo_dst = FIFO_INIT(dfr->data_dst, size);
+	disk_sectors_init(dfr->dsk_sct, dsk_trk, &dfr->ffo_dst, 0);
+	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+	dfr->write = CW_BOOL_TRUE;
+	if (dfr->cwtool_track < options_get_disk_track_start()) return;
+	if (dfr->cwtool_track > options_get_disk_track_end()) return;
+	dfr->decode  = CW_BOOL_TRUE;
+	dfr->pending = CW_BOOL_TRUE;
+	}
+
+
+
+/****************************************************************************
+ * disk_deferred_try
+ ****************************************************************************/
+static cw_bool_t
+disk_deferred_try(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	struct disk_deferred		*dfr,
+	struct fifo			*ffo_src,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk = &dsk->trk[dfr->cwtool_track];
+	cw_count_t			format_track, format_side;
+
+	/*
+	 * does the next try of disk_track_read_nongreedy2(), returns false
+	 * if no image had data left for this track
+	 */
+
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+	for ( ; dfr->image < img_src_count; dfr->image++, dfr->try = 0)
+		{
+		if (dfr->try > dsk_opt->retry) continue;
+		disk_info_update_path(dsk_nfo, path_src[dfr->image]);
+		fifo_reset(ffo_src);
+		stage_track(dfr->cwtool_track);
+		if (! disk_image_read(dsk->img_dsc_l0, img_src[dfr->image], &dsk_trk->img_trk, ffo_src, NULL, 0, dfr->cwtool_track)) continue;
+		disk_format_read(dsk_trk, dfr->con, ffo_src, &dfr->ffo_dst, dfr->dsk_sct, dfr->cwtool_track, format_track, format_side);
+		disk_info_update(dsk_nfo, dsk_trk, dfr->dsk_sct, dfr->cwtool_track, dfr->try, 0, 0);
+		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
+		dfr->try++;
+		dfr->t++;
+		if (dsk_nfo->sectors_bad == 0) dfr->pending = CW_BOOL_FALSE;
+		else if ((dfr->try > dsk_opt->retry) && (dfr->image + 1 >= img_src_count)) dfr->pending = CW_BOOL_FALSE;
+		return (CW_BOOL_TRUE);
+		}
+	dfr->pending = CW_BOOL_FALSE;
+	return (CW_BOOL_FALSE);
+	}
+
+
+
+/****************************************************************************
+ * disk_deferred_container_get
+ ****************************************************************************/
+static struct container *
+disk_deferred_container_get(
+	struct disk_deferred		*dfr,
+	struct container		**con)
+
+	{
+	struct container		*con_last = dfr->con;
+
+	/*
+	 * a merging track decodes all tries into its own container, the
+	 * other tracks decode into the shared one. returns the container
+	 * a track holds from its previous read, if it does not merge
+	 */
+
+	if (dfr->merge) return (NULL);
+	container_reset(*con);
+	dfr->con = *con;
+	return (con_last);
+	}
+
+
+
+/****************************************************************************
+ * disk_deferred_container_put
+ ****************************************************************************/
+static void
+disk_deferred_container_put(
+	struct disk			*dsk,
+	struct disk_output		*fil_output,
+	struct disk_deferred		*dfr,
+	struct container		**con,
+	struct container		*con_last,
+	cw_count_t			*kept,
+	cw_bool_t			read)
+
+	{
+	struct disk_track		*dsk_trk = &dsk->trk[dfr->cwtool_track];
+	cw_count_t			sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+	cw_bool_t			bad;
+	cw_index_t			i;
+
+	/*
+	 * after a read a pending track starts merging, if less than
+	 * DISK_DEFERRED_NR_CONTAINERS do so. otherwise it takes the shared
+	 * container only if its bad sectors are dumped, the container of
+	 * its previous read becomes the shared one then
+	 */
+
+	for (i = 0, bad = CW_BOOL_FALSE; i < sectors; i++) if (dfr->dsk_sct[i].err.errors != 0) bad = CW_BOOL_TRUE;
+	if (dfr->merge)
+		{
+		if (dfr->pending) return;
+		(*kept)--;
+		dfr->merge = CW_BOOL_FALSE;
+		if ((fil_output != NULL) && (bad)) return;
+		container_deinit(dfr->con);
+		dfr->con = NULL;
+		return;
+		}
+	if (! read)
+		{
+		dfr->con = con_last;
+		return;
+		}
+	if ((dfr->pending) && (*kept < DISK_DEFERRED_NR_CONTAINERS))
+		{
+		dfr->merge = CW_BOOL_TRUE;
+		(*kept)++;
+		}
+	else if ((fil_output == NULL) || (! bad))
+		{
+		if (con_last != NULL) container_deinit(con_last);
+		dfr->con = NULL;
+		return;
+		}
+	*con = (con_last != NULL) ? con_last : container_init(NULL);
+	}
+
+
+
+/****************************************************************************
+ * disk_deferred_commit
+ ****************************************************************************/
+static void
+disk_deferred_commit(
+	struct disk			*dsk,
+	struct disk_info		*dsk_nfo,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct disk_output		*fil_output,
+	struct disk_deferred		*dfr,
+	cw_index_t			trackmap_index)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk = &dsk->trk[dfr->cwtool_track];
+	cw_index_t			i;
+
+	/* same as the end of disk_track_read_nongreedy() */
+
+	if (! dfr->used) return;
+	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
+	stage_track(dfr->cwtool_track);
+	if (! dfr->write) goto done;
+	if (! dfr->decode) goto done_write;
+
+	/* a track without any try dumps from an empty container */
+
+	if ((fil_output != NULL) && (dfr->con == NULL)) dfr->con = container_init(NULL);
+	disk_dump_bad_sectors(dsk_trk, dfr->dsk_sct, fil_output, dfr->con, dfr->cwtool_track, dsk_trk->img_trk.clock);
+	if ((dfr->t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", dfr->cwtool_track);
+	disk_info_update(dsk_nfo, dsk_trk, dfr->dsk_sct, dfr->cwtool_track, dfr->t, dsk->img_dsc->offset(img_dst), 1);
+done_write:
+	disk_image_write(dsk->img_dsc, img_dst, &dsk_trk->img_trk, &dfr->ffo_dst, dfr->dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), trackmap_entry_get_image_track(dsk->trm, trm_ent));
+done:
+	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, dfr->cwtool_track);
+	if (dfr->con != NULL) container_deinit(dfr->con);
+	free(dfr->data_dst);
+	}
+
+
+
+/****************************************************************************
+ * disk_deferred_compare
+ ****************************************************************************/
+static int
+disk_deferred_compare(
+	const void			*a,
+	const void			*b)
+
+	{
+	const struct disk_deferred	*dfr_a = *(const struct disk_deferred **) a;
+	const struct disk_deferred	*dfr_b = *(const struct disk_deferred **) b;
+
+	return (dfr_a->cwtool_track - dfr_b->cwtool_track);
+	}
+
+
+
+/****************************************************************************
+ * disk_read_deferred_ok
+ ****************************************************************************/
+static cw_bool_t
+disk_read_deferred_ok(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt)
+
+	{
+	if (dsk_opt->budget <= 0) return (CW_BOOL_FALSE);
+	if (disk_read_greedy(dsk))
+		{
+		verbose_message(GENERIC, 1, "greedy formats are read without retry budget");
+		return (CW_BOOL_FALSE);
+		}
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * disk_read_deferred
+ ****************************************************************************/
+static void
+disk_read_deferred(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	int				img_src_count,
+	union image			*img_dst,
+	struct disk_output		*fil_output)
+
+	{
+	struct disk_deferred		*dfr, **pending;
+	struct container		*con = container_init(NULL), *con_last;
+	unsigned char			*data_src = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_src = FIFO_INIT(data_src, GLOBAL_MAX_TRACK_SIZE);
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_count64_t			budget = (cw_count64_t) dsk_opt->budget * DISK_DEFERRED_MSECS;
+	cw_count64_t			start, left;
+	cw_count_t			pass, tracks, kept = 0;
+	cw_bool_t			read;
+	cw_index_t			i, j;
+
+	dfr     = (struct disk_deferred *) malloc(entries * sizeof (struct disk_deferred));
+	pending = (struct disk_deferred **) malloc(entries * sizeof (struct disk_deferred *));
+	if ((dfr == NULL) || (pending == NULL)) error_oom();
 
-	/*
-	 * if this track is not within the wanted range, ignore it. because
-	 * the format is greedy there is no fixed size for the data to be
-	 * written, so nothing is written to img_dst
-	 */
+	/* first pass, every track is read once */
 
-	if (cwtool_track < options_get_disk_track_start()) goto done;
-	if (cwtool_track > options_get_disk_track_end()) goto done;
+	for (i = 0; i < entries; i++)
+		{
+		disk_deferred_load(dsk, &dfr[i], i);
+		if (! dfr[i].decode) continue;
+		con_last = disk_deferred_container_get(&dfr[i], &con);
+		read = disk_deferred_try(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, &dfr[i], &ffo_src, i);
+		disk_deferred_container_put(dsk, fil_output, &dfr[i], &con, con_last, &kept, read);
+		}
 
 	/*
-	 * skip this track if ffo_dst would contain 0 bytes, this is the case
-	 * with format fill
+	 * further passes only for tracks with bad sectors. the budget is
+	 * checked before each try, the time of a try itself is not known
+	 * in advance
 	 */
 
-	if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) goto done;
-	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
-
-	con = container_init(NULL);
-	for (i = 0; i < img_src_count; i++)
+	start = disk_deferred_time();
+	for (pass = 1, left = budget; left > 0; pass++)
 		{
-		disk_info_update_path(dsk_nfo, path_src[i]);
-		t += disk_track_read_greedy2(dsk, dsk_sct, dsk_opt, dsk_nfo, img_src[i], img_dst, con, &ffo_src, &ffo_dst, trackmap_index);
+		for (i = tracks = 0; i < entries; i++) if (dfr[i].pending) pending[tracks++] = &dfr[i];
+		if (tracks == 0) break;
+		qsort(pending, tracks, sizeof (struct disk_deferred *), disk_deferred_compare);
+		verbose_message(GENERIC, 1, "retry pass %d with %d tracks, budget left %lld ms", pass, tracks, (long long) left);
+		for (i = 0; i < tracks; i++)
+			{
+			j = (pass & 1) ? tracks - 1 - i : i;
+			con_last = disk_deferred_container_get(pending[j], &con);
+			read = disk_deferred_try(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, pending[j], &ffo_src, pending[j] - dfr);
+			disk_deferred_container_put(dsk, fil_output, pending[j], &con, con_last, &kept, read);
+			left = budget - (disk_deferred_time() - start);
+			if (left <= 0) break;
+			}
 		}
-	disk_dump_bad_sectors(dsk_trk, dsk_sct, fil_output, con, cwtool_track, dsk_trk->img_trk.clock);
+
+	/* write all tracks in trackmap order */
+
+	for (i = 0; i < entries; i++) disk_deferred_commit(dsk, dsk_nfo, img_src, img_src_count, img_dst, fil_output, &dfr[i], i);
+	stage_track(STAGE_NO_TRACK);
 	container_deinit(con);
-	if ((t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
-	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 1);
-done:
-	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	scratch_put(data_src);
+	free(pending);
+	free(dfr);
 	}
 
 
 
 /****************************************************************************
- * disk_track_read_nongreedy2
+ * disk_stream_try
  ****************************************************************************/
-static int
-disk_track_read_nongreedy2(
+static void
+disk_stream_try(
 	struct disk			*dsk,
-	struct disk_sector		*dsk_sct,
 	struct disk_option		*dsk_opt,
 	struct disk_info		*dsk_nfo,
-	union image			*img_src,
-	struct container		*con,
+	struct disk_deferred		*dfr,
 	struct fifo			*ffo_src,
-	struct fifo			*ffo_dst,
-	int				offset,
-	int				trackmap_index)
+	cw_index_t			trackmap_index)
 
 	{
 	struct trackmap_entry		*trm_ent;
-	struct disk_track		*dsk_trk;
-	cw_count_t			cwtool_track, format_track, format_side;
-	int				b, t;
+	struct disk_track		*dsk_trk = &dsk->trk[dfr->cwtool_track];
+	cw_count_t			format_track, format_side;
+
+	/*
+	 * same as one try of disk_track_read_nongreedy2(), but the track
+	 * infos are only recorded
+	 */
 
 	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
 	format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
 	format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
-	for (b = -1, t = 0; (b != 0) && (t <= dsk_opt->retry); t++)
+	stage_track(dfr->cwtool_track);
+	disk_format_read(dsk_trk, dfr->con, ffo_src, &dfr->ffo_dst, dfr->dsk_sct, dfr->cwtool_track, format_track, format_side);
+	stage_track(STAGE_NO_TRACK);
+	disk_info_update(dsk_nfo, dsk_trk, dfr->dsk_sct, dfr->cwtool_track, dfr->try, 0, 0);
+	dfr->nfo[dfr->infos++] = (struct disk_job_info)
 		{
-		fifo_reset(ffo_src);
+		.try          = dfr->try,
+		.sectors_good = dsk_nfo->sectors_good,
+		.sectors_weak = dsk_nfo->sectors_weak,
+		.sectors_bad  = dsk_nfo->sectors_bad
+		};
+	dfr->try++;
+	dfr->t++;
+	if ((dsk_nfo->sectors_bad == 0) || (dfr->try > dsk_opt->retry)) dfr->pending = CW_BOOL_FALSE;
+	}
 
-		/*
-		 * if this track is optional and we could not read
-		 * it, because the drive only supports double steps,
-		 * we simply ignore this track
-		 */
 
-		if (! dsk->img_dsc_l0->track_read(img_src, &dsk_trk->img_trk, ffo_src, NULL, 0, cwtool_track)) break;
-		if (! dsk_trk->fmt_dsc->track_read(&dsk_trk->fmt, con, ffo_src, ffo_dst, dsk_sct, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
-		disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 0);
+
+/****************************************************************************
+ * disk_stream_commit
+ ****************************************************************************/
+static void
+disk_stream_commit(
+	struct disk			*dsk,
+	struct disk_option		*dsk_opt,
+	struct disk_info		*dsk_nfo,
+	char				**path_src,
+	union image			**img_src,
+	union image			*img_dst,
+	struct disk_output		*fil_output,
+	struct disk_deferred		*dfr,
+	cw_index_t			trackmap_index)
+
+	{
+	cw_index_t			i;
+
+	/* replay the infos of all tries, as if read one after another */
+
+	disk_info_update_path(dsk_nfo, path_src[0]);
+	for (i = 0; i < dfr->infos; i++)
+		{
+		dsk_nfo->track        = dfr->cwtool_track;
+		dsk_nfo->try          = dfr->nfo[i].try;
+		dsk_nfo->sectors_good = dfr->nfo[i].sectors_good;
+		dsk_nfo->sectors_weak = dfr->nfo[i].sectors_weak;
+		dsk_nfo->sectors_bad  = dfr->nfo[i].sectors_bad;
 		if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
-		b = dsk_nfo->sectors_bad;
 		}
-	return (t);
+	disk_deferred_commit(dsk, dsk_nfo, img_src, 1, img_dst, fil_output, dfr, trackmap_index);
+	stage_track(STAGE_NO_TRACK);
 	}
 
 
 
 /****************************************************************************
- * disk_track_read_nongreedy
+ * disk_read_stream_ok
+ ****************************************************************************/
+static cw_bool_t
+disk_read_stream_ok(
+	struct disk			*dsk,
+	union image			**img_src,
+	int				img_src_count)
+
+	{
+
+	/*
+	 * only one pipe as source, with several sources the tries of the
+	 * following images are only needed if the first one had bad sectors
+	 */
+
+	if (img_src_count != 1) return (CW_BOOL_FALSE);
+	if ((dsk->img_dsc_l0->streamed == NULL) || (dsk->img_dsc_l0->track_next == NULL)) return (CW_BOOL_FALSE);
+	if (! dsk->img_dsc_l0->streamed(img_src[0])) return (CW_BOOL_FALSE);
+	return (! disk_read_greedy(dsk));
+	}
+
+
+
+/****************************************************************************
+ * disk_read_stream
  ****************************************************************************/
 static void
-disk_track_read_nongreedy(
+disk_read_stream(
 	struct disk			*dsk,
 	struct disk_option		*dsk_opt,
 	struct disk_info		*dsk_nfo,
 	char				**path_src,
 	union image			**img_src,
-	int				img_src_count,
 	union image			*img_dst,
-	struct file			*fil_output,
-	int				trackmap_index)
+	struct disk_output		*fil_output)
 
 	{
-	struct trackmap_entry		*trm_ent;
-	struct disk_track		*dsk_trk;
-	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
-	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { };
-	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE] = { };
-	struct container		*con;
-	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
-	struct fifo			ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
-	int				offset  = dsk->img_dsc->offset(img_dst);
-	int				i, t = 0;
-	cw_count_t			cwtool_track, image_track;
+	struct image_track		*img_trk[GLOBAL_NR_TRACKS] = { };
+	cw_index_t			index[GLOBAL_NR_TRACKS];
+	struct disk_deferred		*dfr;
+	struct container		*con = container_init(NULL), *con_last;
+	unsigned char			*data_src = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_src = FIFO_INIT(data_src, GLOBAL_MAX_TRACK_SIZE);
+	cw_count_t			entries = trackmap_entries(dsk->trm);
+	cw_count_t			decoded = 0, decoded_max = 0, kept = 0;
+	cw_index_t			committed = 0;
+	int				i, track;
+
+	dfr = (struct disk_deferred *) malloc(entries * sizeof (struct disk_deferred));
+	if (dfr == NULL) error_oom();
+
+	/* img_trk[] tells the image which tracks are still wanted */
+
+	for (i = 0; i < entries; i++)
+		{
+		disk_deferred_load(dsk, &dfr[i], i);
+		if (! dfr[i].pending) continue;
+		img_trk[dfr[i].cwtool_track] = &dsk->trk[dfr[i].cwtool_track].img_trk;
+		index[dfr[i].cwtool_track]   = i;
+		}
 
 	/*
-	 * skip this track if ffo_dst would contain 0 bytes, this is the case
-	 * with format fill
+	 * each raw track is decoded as the next try of its track as soon as
+	 * it arrives, nothing is stored in the temporary file. a track is
+	 * done if it needs no more tries, then all done tracks up to the
+	 * next one still pending are written. this gives the same result as
+	 * sequential reading, as long as the tries of a track do not arrive
+	 * both before and after tracks preceding it in trackmap order
 	 */
 
-	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	image_track = trackmap_entry_get_image_track(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
-	if (disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0) == 0) goto done;
-	debug_error_condition(dsk_trk->fmt_dsc->track_read == NULL);
+	while (1)
+		{
+		for ( ; (committed < entries) && (! dfr[committed].pending); committed++)
+			{
+			if (dfr[committed].t > 0) decoded--;
+			disk_stream_commit(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_dst, fil_output, &dfr[committed], committed);
+			}
+		if (committed >= entries) break;
+		fifo_reset(&ffo_src);
+		if (! dsk->img_dsc_l0->track_next(img_src[0], img_trk, &ffo_src, &track)) break;
+		i = index[track];
+		if (dfr[i].t == 0) decoded++;
+		if (decoded > decoded_max) decoded_max = decoded;
+		con_last = disk_deferred_container_get(&dfr[i], &con);
+		disk_stream_try(dsk, dsk_opt, dsk_nfo, &dfr[i], &ffo_src, i);
+		disk_deferred_container_put(dsk, fil_output, &dfr[i], &con, con_last, &kept, CW_BOOL_TRUE);
+		if (! dfr[i].pending) img_trk[track] = NULL;
+		}
 
 	/*
-	 * if this track is not within the wanted range, just write zeros
-	 * to img_dst and skip all reading routines. thats why
-	 * disk_sectors_init() can not be skipped
+	 * end of data, all tracks get what they have. sequential reading
+	 * would ask the image once more for pending tracks and get nothing,
+	 * the image warns then about tracks never found
 	 */
 
-	if (cwtool_track < options_get_disk_track_start()) goto done_write;
-	if (cwtool_track > options_get_disk_track_end()) goto done_write;
-
-	con = container_init(NULL);
-	for (i = 0; i < img_src_count; i++)
+	for ( ; committed < entries; committed++)
 		{
-		disk_info_update_path(dsk_nfo, path_src[i]);
-		t += disk_track_read_nongreedy2(dsk, dsk_sct, dsk_opt, dsk_nfo, img_src[i], con, &ffo_src, &ffo_dst, offset, trackmap_index);
-		if ((t > 0) && (dsk_nfo->sectors_bad == 0)) break;
+		if (dfr[committed].pending)
+			{
+			fifo_reset(&ffo_src);
+			disk_image_read(dsk->img_dsc_l0, img_src[0], &dsk->trk[dfr[committed].cwtool_track].img_trk, &ffo_src, NULL, 0, dfr[committed].cwtool_track);
+			con_last = disk_deferred_container_get(&dfr[committed], &con);
+			dfr[committed].pending = CW_BOOL_FALSE;
+			disk_deferred_container_put(dsk, fil_output, &dfr[committed], &con, con_last, &kept, CW_BOOL_FALSE);
+			}
+		disk_stream_commit(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_dst, fil_output, &dfr[committed], committed);
 		}
-	disk_dump_bad_sectors(dsk_trk, dsk_sct, fil_output, con, cwtool_track, dsk_trk->img_trk.clock);
+	verbose_message(GENERIC, 1, "decoded tracks in order of arrival, kept at most %d decoded tracks in memory", decoded_max);
 	container_deinit(con);
-	if ((t == 0) && (! (dsk_trk->img_trk.flags & IMAGE_TRACK_FLAG_OPTIONAL))) error_message("no data available for track %d", cwtool_track);
-	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, t, offset, 1);
-done_write:
-	dsk->img_dsc->track_write(img_dst, &dsk_trk->img_trk, &ffo_dst, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
-done:
-	for (i = 0; i < img_src_count; i++) dsk->img_dsc_l0->track_done(img_src[i], &dsk_trk->img_trk, cwtool_track);
+	scratch_put(data_src);
+	free(dfr);
 	}
 
 
 
 /****************************************************************************
- * disk_track_read
+ * disk_read_jobs_check
  ****************************************************************************/
 static void
-disk_track_read(
+disk_read_jobs_check(
 	struct disk			*dsk,
 	struct disk_option		*dsk_opt,
-	struct disk_info		*dsk_nfo,
-	char				**path_src,
 	union image			**img_src,
-	int				img_src_count,
-	union image			*img_dst,
-	struct file			*fil_output,
-	cw_index_t			trackmap_index)
+	int				img_src_count)
 
 	{
-	struct trackmap_entry		*trm_ent;
-	struct disk_track		*dsk_trk;
-	cw_count_t			cwtool_track;
-
-	trm_ent = trackmap_entry_get_by_index(dsk->trm, trackmap_index);
-	cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
-	dsk_trk = &dsk->trk[cwtool_track];
+	const char			*reason;
 
-	/* skip this track if no format is defined */
+	/* tell why -j has no effect, the checks follow disk_read() */
 
-	if (dsk_trk->fmt_dsc == NULL) return;
-	debug_error_condition(dsk_trk->fmt_dsc->get_flags == NULL);
-	if (dsk_trk->fmt_dsc->get_flags(&dsk_trk->fmt) & FORMAT_FLAG_GREEDY) disk_track_read_greedy(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, trackmap_index);
-	else disk_track_read_nongreedy(dsk, dsk_opt, dsk_nfo, path_src, img_src, img_src_count, img_dst, fil_output, trackmap_index);
+	if (dsk_opt->jobs < 2) return;
+	reason = disk_read_threads_veto(dsk);
+	if (reason == NULL)
+		{
+		if (dsk_opt->budget > 0) reason = "-b is given";
+		else if (disk_read_stream_ok(dsk, img_src, img_src_count)) reason = "the only source is a pipe";
+		else if (disk_read_pipeline_ok(dsk, dsk_opt, img_src, img_src_count)) reason = "the sources are devices";
+		else if (! disk_read_parallel_ok(dsk, dsk_opt, img_src, img_src_count)) reason = "devices and image files are mixed as sources";
+		else return;
+		}
+	error_warning("-j is ignored, because %s, tracks are decoded one after another", reason);
 	}
 
 
@@ -691,6 +2271,7 @@ disk_write_data_get(
 
 	{
 	unsigned char			*data = dsk_trk_buf[0].data;
+	unsigned char			*data_tmp = scratch_get(GLOBAL_MAX_TRACK_SIZE);
 	cw_size_t			size = dsk_trk_buf[0].size;
 	cw_count_t			entries;
 	cw_index_t			i, j, ct, it;
@@ -702,8 +2283,7 @@ disk_write_data_get(
 		struct trackmap_entry	*trm_ent;
 		struct disk_track	*dsk_trk;
 		struct disk_sector	dsk_sct[GLOBAL_NR_SECTORS] = { };
-		unsigned char		data_tmp[GLOBAL_MAX_TRACK_SIZE] = { };
-		struct fifo		ffo_tmp = FIFO_INIT(data_tmp, sizeof (data_tmp));
+		struct fifo		ffo_tmp = FIFO_INIT(data_tmp, GLOBAL_MAX_TRACK_SIZE);
 
 		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
 		ct = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
@@ -712,7 +2292,10 @@ disk_write_data_get(
 		if (dsk_trk->fmt_dsc == NULL) continue;
 		disk_sectors_init(dsk_sct, dsk_trk, &ffo_tmp, 1);
 		if (fifo_get_limit(&ffo_tmp) == 0) continue;
-		dsk->img_dsc->track_read(
+		memset(data_tmp, 0, fifo_get_limit(&ffo_tmp));
+		stage_track(ct);
+		disk_image_read(
+			dsk->img_dsc,
 			img,
 			&dsk_trk->img_trk,
 			&ffo_tmp,
@@ -730,6 +2313,7 @@ disk_write_data_get(
 		memcpy(&data[j], fifo_get_data(&ffo_tmp), s);
 		j += s;
 		}
+	scratch_put(data_tmp);
 	}
 
 
@@ -751,11 +2335,11 @@ disk_track_write(
 	struct trackmap_entry		*trm_ent;
 	struct disk_track		*dsk_trk;
 	struct disk_sector		dsk_sct[GLOBAL_NR_SECTORS] = { };
-	unsigned char			data_src[GLOBAL_MAX_TRACK_SIZE] = { };
-	unsigned char			data_dst[GLOBAL_MAX_TRACK_SIZE] = { };
+	unsigned char			*data_src = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	unsigned char			*data_dst = scratch_get(GLOBAL_MAX_TRACK_SIZE);
 	unsigned char			*data = NULL;
-	struct fifo			ffo_src = FIFO_INIT(data_src, sizeof (data_src));
-	struct fifo			ffo_dst = FIFO_INIT(data_dst, sizeof (data_dst));
+	struct fifo			ffo_src = FIFO_INIT(data_src, GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_dst = FIFO_INIT(data_dst, GLOBAL_MAX_TRACK_SIZE);
 	int				offset, size;
 	cw_count_t			cwtool_track, image_track, format_track, format_side;
 
@@ -768,9 +2352,11 @@ disk_track_write(
 
 	/* skip this track if no format is defined */
 
-	if (dsk_trk->fmt_dsc == NULL) return;
+	if (dsk_trk->fmt_dsc == NULL) goto done;
 	disk_sectors_init(dsk_sct, dsk_trk, &ffo_src, 1);
+	memset(data_src, 0, fifo_get_limit(&ffo_src));
 	debug_error_condition(dsk_trk->fmt_dsc->track_write == NULL);
+	stage_track(cwtool_track);
 
 	/*
 	 * skip this track if we got 0 bytes but expected more than
@@ -798,8 +2384,8 @@ disk_track_write(
 				dsk_trk_buf[cwtool_track + 1].data,
 				dsk_trk_buf[cwtool_track + 1].size);
 			}
-		else dsk->img_dsc->track_read(img_src, &dsk_trk->img_trk, &ffo_src, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
-		if (fifo_get_wr_ofs(&ffo_src) == 0) return;
+		else disk_image_read(dsk->img_dsc, img_src, &dsk_trk->img_trk, &ffo_src, dsk_sct, dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt), image_track);
+		if (fifo_get_wr_ofs(&ffo_src) == 0) goto done;
 		}
 
 	/*
@@ -807,12 +2393,12 @@ disk_track_write(
 	 * do not write to img_dsc_l0
 	 */
 	
-	if (cwtool_track < options_get_disk_track_start()) return;
-	if (cwtool_track > options_get_disk_track_end()) return;
+	if (cwtool_track < options_get_disk_track_start()) goto done;
+	if (cwtool_track > options_get_disk_track_end()) goto done;
 
 	/* encode the data */
 
-	if (! dsk_trk->fmt_dsc->track_write(&dsk_trk->fmt, &ffo_src, dsk_sct, &ffo_dst, data, cwtool_track, format_track, format_side)) error_message("data too long on track %d", cwtool_track);
+	disk_format_write(dsk_trk, &ffo_src, dsk_sct, &ffo_dst, data, cwtool_track, format_track, format_side);
 
 	/*
 	 * if this track is optional and we could not write it,
@@ -820,9 +2406,35 @@ disk_track_write(
 	 * continue with the next track
 	 */
 
-	if (! dsk->img_dsc_l0->track_write(img_dst, &dsk_trk->img_trk, &ffo_dst, NULL, 0, cwtool_track)) return;
+	if (! disk_image_write(dsk->img_dsc_l0, img_dst, &dsk_trk->img_trk, &ffo_dst, NULL, 0, cwtool_track)) goto done;
 	disk_info_update(dsk_nfo, dsk_trk, dsk_sct, cwtool_track, 0, 0, 1);
 	if (dsk_opt->info_func != NULL) dsk_opt->info_func(dsk_nfo, 0);
+done:
+	scratch_put(data_dst);
+	scratch_put(data_src);
+	}
+
+
+
+/****************************************************************************
+ * disk_controller_thread
+ ****************************************************************************/
+static void *
+disk_controller_thread(
+	void				*arg)
+
+	{
+	struct disk_controller		*ctl = (struct disk_controller *) arg;
+	struct disk_batch		*bat;
+	cw_index_t			i;
+
+	for (i = 0; i < ctl->batches; i++)
+		{
+		bat = ctl->bat[i];
+		disk_read(bat->dsk, ctl->dsk_opt, &bat->path_src, 1, bat->path_dst, NULL);
+		}
+	scratch_free();
+	return (NULL);
 	}
 
 
@@ -1647,8 +3259,9 @@ disk_read(
 
 	struct disk_info		dsk_nfo = { };
 	union image			*img_src[GLOBAL_NR_IMAGES], img_dst;
-	struct file			fil;
-	struct file			*fil_output = NULL;
+	struct disk_output		dsk_out = { };
+	struct disk_output		*fil_output = NULL;
+	struct container		con;
 	cw_count_t			entries;
 	cw_index_t			i;
 
@@ -1673,19 +3286,35 @@ disk_read(
 
 	if (path_output != NULL)
 		{
-		file_open(&fil, path_output, FILE_MODE_CREATE, FILE_FLAG_NONE);
-		fil_output = &fil;
+		file_open(&dsk_out.fil, path_output, FILE_MODE_CREATE, FILE_FLAG_NONE);
+		fil_output = &dsk_out;
 		}
 
 	/* iterate over all tracks */
 
 	entries = trackmap_entries(dsk->trm);
-	for (i = 0; i < entries; i++) disk_track_read(dsk, dsk_opt, &dsk_nfo, path_src, img_src, path_src_count, &img_dst, fil_output, i);
+	disk_read_jobs_check(dsk, dsk_opt, img_src, path_src_count);
+	if (disk_read_deferred_ok(dsk, dsk_opt)) disk_read_deferred(dsk, dsk_opt, &dsk_nfo, path_src, img_src, path_src_count, &img_dst, fil_output);
+	else if (disk_read_stream_ok(dsk, img_src, path_src_count)) disk_read_stream(dsk, dsk_opt, &dsk_nfo, path_src, img_src, &img_dst, fil_output);
+	else if (disk_read_parallel_ok(dsk, dsk_opt, img_src, path_src_count)) disk_read_parallel(dsk, dsk_opt, &dsk_nfo, path_src, img_src, path_src_count, &img_dst, fil_output);
+	else if (disk_read_pipeline_ok(dsk, dsk_opt, img_src, path_src_count)) disk_read_pipeline(dsk, dsk_opt, &dsk_nfo, path_src, img_src, path_src_count, &img_dst, fil_output);
+	else
+		{
+
+		/*
+		 * one container is used for all tracks, so its memory only
+		 * gets allocated once
+		 */
+
+		container_init(&con);
+		for (i = 0; i < entries; i++) disk_track_read(dsk, dsk_opt, &dsk_nfo, path_src, img_src, path_src_count, &img_dst, fil_output, &con, NULL, i);
+		container_deinit(&con);
+		}
 	if (dsk_opt->info_func != NULL) dsk_opt->info_func(&dsk_nfo, 1);
 
 	/* close output file */
 
-	if (fil_output != NULL) file_close(fil_output);
+	if (fil_output != NULL) file_close(&fil_output->fil);
 
 	/* close images */
 
@@ -1703,6 +3332,76 @@ disk_read(
 
 
 
+/****************************************************************************
+ * disk_read_batch
+ ****************************************************************************/
+int
+disk_read_batch(
+	struct disk_option		*dsk_opt,
+	struct disk_batch		*bat,
+	int				batches)
+
+	{
+	struct disk_controller		ctl[GLOBAL_NR_DRIVES] = { };
+	struct disk			*dsk[GLOBAL_NR_DRIVES] = { };
+	pthread_t			thr[GLOBAL_NR_DRIVES];
+	pthread_attr_t			attr;
+	cw_index_t			c[GLOBAL_NR_DRIVES], g[GLOBAL_NR_DRIVES];
+	cw_count_t			controllers = 0;
+	cw_index_t			i, j;
+
+	debug_error_condition((batches < 1) || (batches > GLOBAL_NR_DRIVES));
+
+	/*
+	 * disks given with the same name would share one struct disk between
+	 * threads, so each further use of a name gets a copy of its own
+	 */
+
+	for (i = 0; i < batches; i++)
+		{
+		for (j = 0; (j < i) && (bat[j].dsk != bat[i].dsk); j++) ;
+		if (j == i) continue;
+		dsk[i] = (struct disk *) malloc(sizeof (struct disk));
+		if (dsk[i] == NULL) error_oom();
+		*dsk[i] = *bat[i].dsk;
+		}
+	for (i = 0; i < batches; i++) if (dsk[i] != NULL) bat[i].dsk = dsk[i];
+
+	/*
+	 * group the disks by controller, files and other paths which are
+	 * no catweasel device get a group of their own
+	 */
+
+	for (i = 0; i < batches; i++)
+		{
+		c[i] = file_controller(bat[i].path_src);
+		for (j = 0; j < i; j++) if ((c[i] != -1) && (c[i] == c[j])) break;
+		g[i] = (j < i) ? g[j] : controllers++;
+		ctl[g[i]].dsk_opt = dsk_opt;
+		ctl[g[i]].bat[ctl[g[i]].batches++] = &bat[i];
+		}
+	verbose_message(GENERIC, 1, "reading %d disks with %d threads", batches, controllers);
+
+	/* one group needs no extra thread */
+
+	if (controllers == 1) disk_controller_thread(&ctl[0]);
+	else
+		{
+		pthread_attr_init(&attr);
+		pthread_attr_setstacksize(&attr, DISK_CONTROLLER_STACK_SIZE);
+		for (i = 0; i < controllers; i++) if (pthread_create(&thr[i], &attr, disk_controller_thread, &ctl[i]) != 0) error_message("could not create thread");
+		pthread_attr_destroy(&attr);
+		for (i = 0; i < controllers; i++) pthread_join(thr[i], NULL);
+		}
+	for (i = 0; i < batches; i++) free(dsk[i]);
+
+	/* done */
+
+	return (1);
+	}
+
+
+
 /****************************************************************************
  * disk_write
  ****************************************************************************/
@@ -1752,6 +3451,7 @@ disk_write(
 		{
 		for (i = 0; i < entries; i++) disk_track_write(dsk, dsk_opt, &dsk_nfo, NULL, &img_src, &img_dst, i);
 		}
+	stage_track(STAGE_NO_TRACK);
 	if (dsk_opt->info_func != NULL) dsk_opt->info_func(&dsk_nfo, 1);
 
 	/* close images */
@@ -1763,4 +3463,117 @@ disk_write(
 
 	return (1);
 	}
+
+
+
+/****************************************************************************
+ * disk_bench
+ ****************************************************************************/
+int
+disk_bench(
+	struct disk			*dsk,
+	struct bench			*bnc)
+
+	{
+	struct trackmap_entry		*trm_ent;
+	struct disk_track		*dsk_trk;
+	struct disk_sector		*dsk_sct;
+	struct container		con;
+	unsigned char			*data_src, *data_raw, *data_l0, *data_dst;
+	struct fifo			ffo_src, ffo_raw, ffo_l0, ffo_dst;
+	unsigned char			*data, *data_img = NULL;
+	cw_count_t			cwtool_track, format_track, format_side;
+	cw_count_t			entries, sectors, size, offset;
+	cw_size_t			data_size;
+	cw_index_t			i, r, s;
+
+	/*
+	 * greedy formats have no sectors to check. formats like gcr_g64
+	 * may not be able to write random data
+	 */
+
+	if (disk_read_greedy(dsk)) return (0);
+	dsk_sct  = scratch_get(GLOBAL_NR_SECTORS * sizeof (struct disk_sector));
+	data_src = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	data_raw = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	data_l0  = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	data_dst = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	ffo_src  = FIFO_INIT(data_src, GLOBAL_MAX_TRACK_SIZE);
+	ffo_raw  = FIFO_INIT(data_raw, GLOBAL_MAX_TRACK_SIZE);
+	ffo_l0   = FIFO_INIT(data_l0, GLOBAL_MAX_TRACK_SIZE);
+	ffo_dst  = FIFO_INIT(data_dst, GLOBAL_MAX_TRACK_SIZE);
+	bench_start(bnc);
+
+	/*
+	 * formats which take additional data from the image, like the disk
+	 * id of gcr_cbm, get it from a random image
+	 */
+
+	data_size = disk_write_data_size(dsk);
+	if (data_size > 0)
+		{
+		data_img = (unsigned char *) malloc(data_size * sizeof (unsigned char));
+		if (data_img == NULL) error_oom();
+		bench_fill(bnc, data_img, data_size);
+		}
+	container_init(&con);
+	entries = trackmap_entries(dsk->trm);
+	for (i = 0; i < entries; i++)
+		{
+		trm_ent = trackmap_entry_get_by_index(dsk->trm, i);
+		cwtool_track = trackmap_entry_get_cwtool_track(dsk->trm, trm_ent);
+		format_track = trackmap_entry_get_format_track(dsk->trm, trm_ent);
+		format_side  = trackmap_entry_get_format_side(dsk->trm, trm_ent);
+		dsk_trk = &dsk->trk[cwtool_track];
+		if (dsk_trk->fmt_dsc == NULL) continue;
+
+		/* encode random sector data like disk_track_write() does */
+
+		fifo_reset(&ffo_src);
+		fifo_reset(&ffo_raw);
+		size = disk_sectors_init(dsk_sct, dsk_trk, &ffo_src, 1);
+		if (size == 0) continue;
+		bench_fill(bnc, data_src, size);
+		fifo_set_wr_ofs(&ffo_src, size);
+		data = NULL;
+		if (data_img != NULL)
+			{
+			offset = dsk_trk->fmt_dsc->get_data_offset(&dsk_trk->fmt);
+			if (offset + dsk_trk->fmt_dsc->get_data_size(&dsk_trk->fmt) <= data_size) data = &data_img[offset];
+			}
+		if (! dsk_trk->fmt_dsc->track_write(&dsk_trk->fmt, &ffo_src, dsk_sct, &ffo_raw, data, cwtool_track, format_track, format_side)) break;
+
+		/* each round decodes a differently distorted copy as next try */
+
+		container_reset(&con);
+		sectors = dsk_trk->fmt_dsc->get_sectors(&dsk_trk->fmt);
+		for (r = 0; r < bnc->rounds; r++)
+			{
+			fifo_reset(&ffo_l0);
+			bench_noise(bnc, &ffo_raw, &ffo_l0);
+			fifo_reset(&ffo_dst);
+			disk_sectors_init(dsk_sct, dsk_trk, &ffo_dst, 0);
+			bnc->tracks++;
+			bnc->pulses += fifo_get_wr_ofs(&ffo_l0);
+			disk_format_read(dsk_trk, &con, &ffo_l0, &ffo_dst, dsk_sct, cwtool_track, format_track, format_side);
+
+			/* a sector is bad if it is not read back unchanged */
+
+			for (s = 0; s < sectors; s++)
+				{
+				bnc->sectors++;
+				if ((dsk_sct[s].err.errors > 0) || (memcmp(dsk_sct[s].data, &data_src[dsk_sct[s].offset], dsk_sct[s].size) != 0)) bnc->sectors_bad++;
+				}
+			}
+		}
+	container_deinit(&con);
+	free(data_img);
+	scratch_put(data_dst);
+	scratch_put(data_l0);
+	scratch_put(data_raw);
+	scratch_put(data_src);
+	scratch_put(dsk_sct);
+	bench_stop(bnc);
+	return (((i == entries) && (bnc->tracks > 0)) ? 1 : 0);
+	}
 /******************************************************** Karsten Scheibler */
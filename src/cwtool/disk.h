@@ -33,6 +33,7 @@ struct disk_track
 #define DISK_INIT(r)			(struct disk) { .revision = r }
 
 struct trackmap;
+struct bench;
 
 #define DISK_FLAG_TRACKMAP_SET		(1 << 0)
 
@@ -104,7 +105,7 @@ struct disk_info
 	struct disk_sector_info		sct_nfo[GLOBAL_NR_TRACKS][GLOBAL_NR_SECTORS];
 	};
 
-#define DISK_OPTION_INIT(i, r, f)	(struct disk_option) { .info_func = i, .retry = r, .flags = f }
+#define DISK_OPTION_INIT(i, r, j, b, f)	(struct disk_option) { .info_func = i, .retry = r, .jobs = j, .budget = b, .flags = f }
 #define DISK_OPTION_FLAG_NONE		0
 #define DISK_OPTION_FLAG_IGNORE_SIZE	(1 << 0)
 
@@ -112,9 +113,18 @@ struct disk_option
 	{
 	void				(*info_func)(struct disk_info *, int);
 	int				retry;
+	int				jobs;
+	int				budget;
 	int				flags;
 	};
 
+struct disk_batch
+	{
+	struct disk			*dsk;
+	char				*path_src;
+	char				*path_dst;
+	};
+
 extern struct disk			*disk_get(int);
 extern struct disk			*disk_search(const char *);
 extern struct disk_track		*disk_init_track_default(struct disk *);
@@ -158,7 +168,9 @@ extern int				disk_sector_read(struct disk_sector *, struct disk_error *, unsign
 extern int				disk_sector_write(unsigned char *, struct disk_sector *);
 extern int				disk_statistics(struct disk *, char *);
 extern int				disk_read(struct disk *, struct disk_option *, char **, int, char *, char *);
+extern int				disk_read_batch(struct disk_option *, struct disk_batch *, int);
 extern int				disk_write(struct disk *, struct disk_option *, char *, char *);
+extern int				disk_bench(struct disk *, struct bench *);
 
 #define disk_set_indexed_read(t, v)	disk_set_image_track_flag(t, v, IMAGE_TRACK_FLAG_INDEXED_READ)
 #define disk_set_indexed_write(t, v)	disk_set_image_track_flag(t, v, IMAGE_TRACK_FLAG_INDEXED_WRITE)
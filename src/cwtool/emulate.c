@@ -0,0 +1,806 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * emulate.c
+ *
+ ****************************************************************************
+ *
+ * userspace emulation of a catweasel device. it answers the same ioctls as
+ * the kernel driver, but takes the flux data from a raw image, which is
+ * completely loaded into memory on first open. of each raw track one disk
+ * rotation is kept, successive reads of a track cycle through all rotations
+ * found for it in the image
+ *
+ * the timing of a real drive is modelled and really waited for, so the
+ * wall clock time of cwtool -R and -W is the same as with real hardware:
+ * - the disk spins with 300 or 360 rpm, the rotation time is taken from
+ *   the index pulses of the image
+ * - stepping takes step_time per track and settle_time afterwards
+ * - a read lasts for the whole timeout like on the catweasel, with
+ *   CW_TRACKINFO_MODE_INDEX_WAIT it starts at the next index pulse
+ * - a write lasts as long as the written data and replaces the track in
+ *   memory, the image file itself is not changed
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "emulate.h"
+#include "error.h"
+#include "debug.h"
+#include "verbose.h"
+#include "global.h"
+#include "string.h"
+#include "fifo.h"
+#include "scratch.h"
+#include "image.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * one pulse length tick at CW_TRACKINFO_CLOCK_14MHZ is 141 ns, so the
+ * counter runs with half of the selected clock
+ */
+
+#define EMULATE_NSECS			1000000000LL
+#define EMULATE_MSECS			1000000LL
+#define EMULATE_CLOCK			7080500LL
+#define EMULATE_SLACK			8
+#define EMULATE_INDEX_LENGTH		(2 * EMULATE_MSECS)
+#define EMULATE_RPM_LOW			300
+#define EMULATE_RPM_HIGH		360
+
+static struct emulate			*emulate_device[EMULATE_NR_DEVICES];
+static pthread_mutex_t			emulate_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * emulate_time
+ ****************************************************************************/
+static cw_count64_t
+emulate_time(
+	cw_void_t)
+
+	{
+	struct timespec			ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) error_perror_message("error while clock_gettime()");
+	return ((cw_count64_t) ts.tv_sec * EMULATE_NSECS + ts.tv_nsec);
+	}
+
+
+
+/****************************************************************************
+ * emulate_sleep
+ ****************************************************************************/
+static cw_void_t
+emulate_sleep(
+	cw_count64_t			nsecs)
+
+	{
+	struct timespec			ts;
+
+	if (nsecs <= 0) return;
+	ts.tv_sec  = nsecs / EMULATE_NSECS;
+	ts.tv_nsec = nsecs % EMULATE_NSECS;
+	while (nanosleep(&ts, &ts) == -1) if (errno != EINTR) error_perror_message("error while nanosleep()");
+	}
+
+
+
+/****************************************************************************
+ * emulate_ticks
+ ****************************************************************************/
+static cw_count64_t
+emulate_ticks(
+	cw_count64_t			nsecs,
+	cw_snum_t			clock)
+
+	{
+	return (nsecs * (EMULATE_CLOCK << clock) / EMULATE_NSECS);
+	}
+
+
+
+/****************************************************************************
+ * emulate_nsecs
+ ****************************************************************************/
+static cw_count64_t
+emulate_nsecs(
+	cw_count64_t			ticks,
+	cw_snum_t			clock)
+
+	{
+	return (ticks * EMULATE_NSECS / (EMULATE_CLOCK << clock));
+	}
+
+
+
+/****************************************************************************
+ * emulate_scale
+ ****************************************************************************/
+static cw_raw8_t
+emulate_scale(
+	cw_raw8_t			data,
+	cw_snum_t			clock_src,
+	cw_snum_t			clock_dst)
+
+	{
+	cw_count_t			d = data & GLOBAL_PULSE_LENGTH_MASK;
+
+	/*
+	 * a pulse length of 0 would be taken as end of data, so it is never
+	 * returned
+	 */
+
+	if (clock_dst > clock_src) d <<= clock_dst - clock_src;
+	if (clock_dst < clock_src) d >>= clock_src - clock_dst;
+	if (d > GLOBAL_MAX_PULSE_LENGTH) d = GLOBAL_MAX_PULSE_LENGTH;
+	if (d < 1) d = 1;
+	return (d | (data & GLOBAL_PULSE_INDEX_MASK));
+	}
+
+
+
+/****************************************************************************
+ * emulate_sum
+ ****************************************************************************/
+static cw_count64_t
+emulate_sum(
+	cw_raw8_t			*data,
+	cw_size_t			size)
+
+	{
+	cw_count64_t			ticks;
+	cw_index_t			i;
+
+	for (i = 0, ticks = 0; i < size; i++) ticks += data[i] & GLOBAL_PULSE_LENGTH_MASK;
+	return (ticks);
+	}
+
+
+
+/****************************************************************************
+ * emulate_index_edge
+ ****************************************************************************/
+static cw_index_t
+emulate_index_edge(
+	cw_raw8_t			*data,
+	cw_size_t			size,
+	cw_index_t			i)
+
+	{
+	for ( ; i < size; i++)
+		{
+		if (! (data[i] & GLOBAL_PULSE_INDEX_MASK)) continue;
+		if ((i == 0) || (! (data[i - 1] & GLOBAL_PULSE_INDEX_MASK))) return (i);
+		}
+	return (-1);
+	}
+
+
+
+/****************************************************************************
+ * emulate_index_mark
+ ****************************************************************************/
+static cw_void_t
+emulate_index_mark(
+	struct emulate_rotation		*rot,
+	cw_snum_t			clock)
+
+	{
+	cw_count64_t			index = emulate_ticks(EMULATE_INDEX_LENGTH, clock);
+	cw_count64_t			ticks;
+	cw_index_t			i;
+
+	/* the index pulse starts with the first pulse of a rotation */
+
+	for (i = 0, ticks = 0; i < rot->size; i++)
+		{
+		rot->data[i] &= GLOBAL_PULSE_LENGTH_MASK;
+		if (ticks < index) rot->data[i] |= GLOBAL_PULSE_INDEX_MASK;
+		ticks += rot->data[i] & GLOBAL_PULSE_LENGTH_MASK;
+		}
+	rot->ticks = ticks;
+	}
+
+
+
+/****************************************************************************
+ * emulate_rotation_ticks
+ ****************************************************************************/
+static cw_count64_t
+emulate_rotation_ticks(
+	cw_raw8_t			*data,
+	cw_size_t			size)
+
+	{
+	cw_index_t			i, j;
+
+	/* ticks between the first two index pulses or 0 if there are none */
+
+	i = emulate_index_edge(data, size, 0);
+	if (i == -1) return (0);
+	j = emulate_index_edge(data, size, i + 1);
+	if (j == -1) return (0);
+	return (emulate_sum(&data[i], j - i));
+	}
+
+
+
+/****************************************************************************
+ * emulate_rotation_extract
+ ****************************************************************************/
+static cw_void_t
+emulate_rotation_extract(
+	struct emulate			*emu,
+	struct emulate_rotation		*rot,
+	cw_snum_t			clock,
+	cw_flag_t			flags)
+
+	{
+	cw_count64_t			limit = emulate_ticks(emu->rotation, clock);
+	cw_count64_t			ticks;
+	cw_index_t			i, j;
+
+	/*
+	 * with stored index pulses take everything from the first index
+	 * pulse up to the second one, otherwise assume the data starts at
+	 * the index. images written by cwtool -W are a bit longer than one
+	 * rotation, they are taken completely, because the end overlaps the
+	 * start on a real disk. longer reads are cut after one rotation
+	 */
+
+	if (flags & IMAGE_RAW_HEADER_FLAG_INDEX_STORED)
+		{
+		i = emulate_index_edge(rot->data, rot->size, 0);
+		j = (i == -1) ? -1 : emulate_index_edge(rot->data, rot->size, i + 1);
+		if (j != -1)
+			{
+			memmove(rot->data, &rot->data[i], j - i);
+			rot->size  = j - i;
+			rot->ticks = emulate_sum(rot->data, rot->size);
+			return;
+			}
+		}
+	if (emulate_sum(rot->data, rot->size) > limit + limit / EMULATE_SLACK)
+		{
+		for (i = 0, ticks = 0; (i < rot->size) && (ticks < limit); i++) ticks += rot->data[i] & GLOBAL_PULSE_LENGTH_MASK;
+		rot->size = i;
+		}
+	emulate_index_mark(rot, clock);
+	}
+
+
+
+/****************************************************************************
+ * emulate_load
+ ****************************************************************************/
+static cw_void_t
+emulate_load(
+	struct emulate			*emu,
+	const cw_char_t			*path)
+
+	{
+	static cw_flag_t		flags[GLOBAL_NR_TRACKS][EMULATE_NR_ROTATIONS];
+	struct image_raw_header		hdr;
+	struct emulate_track		*trk;
+	struct emulate_rotation		*rot;
+	union image			*img;
+	cw_raw8_t			*data = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
+	cw_count64_t			ticks = 0;
+	cw_count_t			rpm = EMULATE_RPM_LOW;
+	cw_size_t			size;
+	cw_index_t			i, t;
+
+	/*
+	 * the image is read with the raw image code, so all its variants
+	 * (data, text and packed) are accepted. only the first rotations
+	 * with the same clock are kept
+	 */
+
+	img = (union image *) malloc(sizeof (union image));
+	if (img == NULL) error_oom();
+	image_raw_desc.open(img, (char *) path, IMAGE_MODE_READ, IMAGE_FLAG_NONE);
+	while ((size = image_raw_read_stored(img, &hdr, &ffo)) > 0)
+		{
+		trk = &emu->trk[hdr.track];
+		if (trk->rotations == 0) trk->clock = hdr.clock;
+		if ((trk->rotations >= EMULATE_NR_ROTATIONS) || (trk->clock != hdr.clock)) continue;
+		rot = &trk->rot[trk->rotations];
+		*rot = (struct emulate_rotation) { .data = malloc(size * sizeof (cw_raw8_t)), .size = size };
+		if (rot->data == NULL) error_oom();
+		memcpy(rot->data, data, size);
+		flags[hdr.track][trk->rotations++] = hdr.flags;
+
+		/* the rotation time is taken from the first track with two index pulses */
+
+		if ((ticks == 0) && (hdr.flags & IMAGE_RAW_HEADER_FLAG_INDEX_STORED))
+			{
+			ticks = emulate_rotation_ticks(rot->data, rot->size);
+			if (ticks > 0) ticks = emulate_nsecs(ticks, hdr.clock);
+			}
+		}
+	image_raw_desc.close(img);
+	free(img);
+	scratch_put(data);
+
+	/*
+	 * only 300 and 360 rpm drives exist, so take the one which is
+	 * nearer to the measured rotation time
+	 */
+
+	if ((ticks > 0) && (60 * EMULATE_NSECS / ticks > (EMULATE_RPM_LOW + EMULATE_RPM_HIGH) / 2)) rpm = EMULATE_RPM_HIGH;
+	emu->rotation = 60 * EMULATE_NSECS / rpm;
+	emu->fli.rpm  = rpm;
+	for (t = 0; t < GLOBAL_NR_TRACKS; t++)
+		{
+		trk = &emu->trk[t];
+		for (i = 0; i < trk->rotations; i++) emulate_rotation_extract(emu, &trk->rot[i], trk->clock, flags[t][i]);
+		}
+	verbose_message(GENERIC, 1, "emulating %d rpm drive with tracks from '%s'", rpm, path);
+	}
+
+
+
+/****************************************************************************
+ * emulate_check
+ ****************************************************************************/
+static cw_bool_t
+emulate_check(
+	struct emulate			*emu,
+	struct cw_trackinfo		*tri,
+	cw_bool_t			write)
+
+	{
+	struct cw_floppyinfo		*fli = &emu->fli;
+
+	/* same checks as in the kernel driver */
+
+	if (tri->version != CW_STRUCT_VERSION) return (CW_BOOL_FALSE);
+	if ((tri->track_seek >= fli->nr_tracks) || (tri->track >= fli->nr_tracks) ||
+		(tri->side >= fli->nr_sides) || (tri->clock >= fli->nr_clocks) ||
+		(tri->mode >= fli->nr_modes) || (tri->timeout < CW_MIN_TIMEOUT) ||
+		(tri->timeout > CW_MAX_TIMEOUT)) return (CW_BOOL_FALSE);
+	if ((write) && ((tri->size > fli->max_size - CW_WRITE_OVERHEAD) ||
+		(tri->mode == CW_TRACKINFO_MODE_INDEX_STORE))) return (CW_BOOL_FALSE);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * emulate_step
+ ****************************************************************************/
+static struct emulate_track *
+emulate_step(
+	struct emulate			*emu,
+	struct cw_trackinfo		*tri)
+
+	{
+	cw_count_t			steps, track;
+
+	/* move head over track_seek to track */
+
+	steps  = (emu->head > tri->track_seek) ? emu->head - tri->track_seek : tri->track_seek - emu->head;
+	steps += (tri->track_seek > tri->track) ? tri->track_seek - tri->track : tri->track - tri->track_seek;
+	emu->head = tri->track;
+	if (steps > 0) emulate_sleep((steps * emu->fli.step_time + emu->fli.settle_time) * EMULATE_MSECS);
+
+	/* a double stepping drive only sees every second track of the image */
+
+	track = tri->track;
+	if (emu->fli.flags & CW_FLOPPYINFO_FLAG_DOUBLE_STEP) track *= 2;
+	track = 2 * track + tri->side;
+	if (track >= GLOBAL_NR_TRACKS) return (NULL);
+	return (&emu->trk[track]);
+	}
+
+
+
+/****************************************************************************
+ * emulate_wait
+ ****************************************************************************/
+static cw_count64_t
+emulate_wait(
+	struct emulate			*emu,
+	struct cw_trackinfo		*tri,
+	cw_count64_t			*angle)
+
+	{
+	cw_count64_t			wait = 0;
+
+	/* returns the time until the operation starts */
+
+	*angle = (emulate_time() - emu->start) % emu->rotation;
+	if ((tri->mode == CW_TRACKINFO_MODE_INDEX_WAIT) && (*angle > 0))
+		{
+		wait   = emu->rotation - *angle;
+		*angle = 0;
+		}
+	return (wait);
+	}
+
+
+
+/****************************************************************************
+ * emulate_read
+ ****************************************************************************/
+static cw_int_t
+emulate_read(
+	struct emulate			*emu,
+	struct cw_trackinfo		*tri)
+
+	{
+	struct emulate_track		*trk;
+	struct emulate_rotation		*rot;
+	cw_count64_t			duration = tri->timeout * EMULATE_MSECS;
+	cw_count64_t			angle, wait, pos, limit, ticks;
+	cw_raw8_t			mask = GLOBAL_PULSE_LENGTH_MASK;
+	cw_index_t			i;
+	cw_size_t			size = 0;
+
+	if (! emulate_check(emu, tri, CW_BOOL_FALSE)) return (-1);
+	trk  = emulate_step(emu, tri);
+	wait = emulate_wait(emu, tri, &angle);
+	if ((trk == NULL) || (trk->rotations == 0) || (wait >= duration)) goto done;
+
+	/*
+	 * the catweasel reads until the timeout expires, starting at the
+	 * current position of the disk. the index pulse is only stored with
+	 * CW_TRACKINFO_MODE_INDEX_STORE
+	 */
+
+	rot = &trk->rot[trk->next++ % trk->rotations];
+	if (rot->ticks == 0) goto done;
+	if (tri->mode == CW_TRACKINFO_MODE_INDEX_STORE) mask |= GLOBAL_PULSE_INDEX_MASK;
+	pos   = angle * rot->ticks / emu->rotation;
+	limit = (duration - wait) * rot->ticks / emu->rotation;
+	for (i = 0, ticks = 0; (i < rot->size) && (ticks + (rot->data[i] & GLOBAL_PULSE_LENGTH_MASK) <= pos); i++) ticks += rot->data[i] & GLOBAL_PULSE_LENGTH_MASK;
+	for (ticks = 0; (ticks < limit) && (size < tri->size); size++)
+		{
+		if (i >= rot->size) i = 0;
+		tri->data[size] = emulate_scale(rot->data[i] & mask, trk->clock, tri->clock);
+		ticks += rot->data[i++] & GLOBAL_PULSE_LENGTH_MASK;
+		}
+done:
+	debug_message(GENERIC, 2, "emulated read of track %d side %d, wait = %lld ns, size = %d", tri->track, tri->side, wait, size);
+	emulate_sleep(duration);
+	return (size);
+	}
+
+
+
+/****************************************************************************
+ * emulate_append
+ ****************************************************************************/
+static cw_size_t
+emulate_append(
+	cw_raw8_t			*dst,
+	cw_size_t			size,
+	cw_raw8_t			*src,
+	cw_size_t			src_size,
+	cw_count64_t			from,
+	cw_count64_t			to)
+
+	{
+	cw_count64_t			ticks;
+	cw_index_t			i;
+
+	/* append all pulses of src starting within [from, to) */
+
+	for (i = 0, ticks = 0; (i < src_size) && (ticks < to); i++)
+		{
+		if (ticks >= from) dst[size++] = src[i];
+		ticks += src[i] & GLOBAL_PULSE_LENGTH_MASK;
+		}
+	return (size);
+	}
+
+
+
+/****************************************************************************
+ * emulate_write
+ ****************************************************************************/
+static cw_int_t
+emulate_write(
+	struct emulate			*emu,
+	struct cw_trackinfo		*tri)
+
+	{
+	struct emulate_track		*trk;
+	struct emulate_rotation		rot = { }, old = { };
+	cw_count64_t			duration = tri->timeout * EMULATE_MSECS;
+	cw_count64_t			angle, wait, limit, length, ticks;
+	cw_raw8_t			*written;
+	cw_snum_t			clock = tri->clock;
+	cw_index_t			i;
+	cw_size_t			size;
+
+	if (! emulate_check(emu, tri, CW_BOOL_TRUE)) return (-1);
+	trk  = emulate_step(emu, tri);
+	wait = emulate_wait(emu, tri, &angle);
+	if (wait >= duration)
+		{
+		emulate_sleep(duration);
+		return (tri->size - 1);
+		}
+
+	/* the write is aborted if it does not finish within the timeout */
+
+	limit = emulate_ticks(duration - wait, clock);
+	for (i = 0, ticks = 0; (i < tri->size) && (ticks < limit); i++) ticks += tri->data[i] & GLOBAL_PULSE_LENGTH_MASK;
+	size = i;
+	emulate_sleep(wait + emulate_nsecs(ticks, clock));
+	if (trk == NULL) goto done;
+
+	/*
+	 * old track data is converted to the clock of the written data and
+	 * padded to a full rotation, then the written data replaces the
+	 * part of the rotation it was written to
+	 */
+
+	limit  = emulate_ticks(emu->rotation, clock);
+	length = (ticks < limit) ? ticks : limit;
+	angle  = emulate_ticks(angle, clock);
+	if (trk->rotations > 0) old.size = trk->rot[0].size;
+	old.data = malloc((old.size + limit / GLOBAL_MAX_PULSE_LENGTH + 2) * sizeof (cw_raw8_t));
+	rot.data = malloc((old.size + limit / GLOBAL_MAX_PULSE_LENGTH + size + 2) * sizeof (cw_raw8_t));
+	written  = malloc((size + 1) * sizeof (cw_raw8_t));
+	if ((old.data == NULL) || (rot.data == NULL) || (written == NULL)) error_oom();
+	for (i = 0; i < old.size; i++) old.data[i] = emulate_scale(trk->rot[0].data[i] & GLOBAL_PULSE_LENGTH_MASK, trk->clock, clock);
+	for (ticks = emulate_sum(old.data, old.size); ticks < limit; ticks += GLOBAL_MAX_PULSE_LENGTH) old.data[old.size++] = GLOBAL_MAX_PULSE_LENGTH;
+	for (i = 0; i < size; i++) written[i] = emulate_scale(tri->data[i] & GLOBAL_PULSE_LENGTH_MASK, clock, clock);
+	if (angle + length <= limit)
+		{
+		rot.size = emulate_append(rot.data, rot.size, old.data, old.size, 0, angle);
+		rot.size = emulate_append(rot.data, rot.size, written, size, 0, length);
+		rot.size = emulate_append(rot.data, rot.size, old.data, old.size, angle + length, limit);
+		}
+	else
+		{
+		rot.size = emulate_append(rot.data, rot.size, written, size, limit - angle, length);
+		rot.size = emulate_append(rot.data, rot.size, old.data, old.size, angle + length - limit, angle);
+		rot.size = emulate_append(rot.data, rot.size, written, size, 0, limit - angle);
+		}
+	emulate_index_mark(&rot, clock);
+	for (i = 0; i < trk->rotations; i++) free(trk->rot[i].data);
+	*trk = (struct emulate_track)
+		{
+		.rot       = { rot },
+		.rotations = 1,
+		.clock     = clock
+		};
+	free(written);
+	free(old.data);
+done:
+	debug_message(GENERIC, 2, "emulated write of track %d side %d, wait = %lld ns, size = %d", tri->track, tri->side, wait, size);
+
+	/* like the kernel driver signal an aborted write with one byte less */
+
+	return ((size < tri->size) ? tri->size - 1 : tri->size);
+	}
+
+
+
+/****************************************************************************
+ * emulate_set_parameters
+ ****************************************************************************/
+static cw_int_t
+emulate_set_parameters(
+	struct emulate			*emu,
+	struct cw_floppyinfo		*fli)
+
+	{
+
+	/* same checks as in the kernel driver */
+
+	if ((fli->version != CW_STRUCT_VERSION) ||
+		(fli->settle_time < CW_MIN_SETTLE_TIME) || (fli->settle_time > CW_MAX_SETTLE_TIME) ||
+		(fli->step_time < CW_MIN_STEP_TIME) || (fli->step_time > CW_MAX_STEP_TIME) ||
+		(fli->wpulse_length < CW_MIN_WPULSE_LENGTH) || (fli->wpulse_length > CW_MAX_WPULSE_LENGTH) ||
+		(fli->nr_tracks < 1) || (fli->nr_tracks > CW_NR_TRACKS) ||
+		(fli->nr_sides < 1) || (fli->nr_sides > CW_NR_SIDES) ||
+		(fli->nr_clocks != emu->fli.nr_clocks) ||
+		(fli->nr_modes != emu->fli.nr_modes) ||
+		(fli->max_size != emu->fli.max_size) ||
+		((fli->rpm != 0) && (fli->rpm < CW_MIN_RPM)) || (fli->rpm > CW_MAX_RPM) ||
+		(fli->flags > CW_FLOPPYINFO_FLAG_ALL)) return (-1);
+	emu->fli.settle_time   = fli->settle_time;
+	emu->fli.step_time     = fli->step_time;
+	emu->fli.wpulse_length = fli->wpulse_length;
+	emu->fli.nr_tracks     = fli->nr_tracks;
+	emu->fli.nr_sides      = fli->nr_sides;
+	emu->fli.flags         = fli->flags;
+
+	/* a given rpm value changes the rotation time of the emulated drive */
+
+	if (fli->rpm != 0)
+		{
+		emu->fli.rpm  = fli->rpm;
+		emu->rotation = 60 * EMULATE_NSECS / fli->rpm;
+		}
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * emulate_search
+ ****************************************************************************/
+static cw_index_t
+emulate_search(
+	const cw_char_t			*path)
+
+	{
+	struct emulate			*emu;
+	cw_index_t			i;
+
+	/*
+	 * like a real device the emulated one keeps its parameters and
+	 * written tracks until cwtool exits, so it is opened only once.
+	 * emulate_mutex has to be held by the caller
+	 */
+
+	debug_error_condition(! emulate_path(path));
+	for (i = 0; i < EMULATE_NR_DEVICES; i++)
+		{
+		if (emulate_device[i] == NULL) break;
+		if (string_equal(emulate_device[i]->path, path)) return (i);
+		}
+	if (i >= EMULATE_NR_DEVICES) error_message("too many emulated devices");
+	emu = malloc(sizeof (struct emulate));
+	if (emu == NULL) error_oom();
+	*emu = (struct emulate) { };
+	string_copy(emu->path, GLOBAL_MAX_PATH_SIZE, path);
+	emu->fli = (struct cw_floppyinfo)
+		{
+		.version       = CW_STRUCT_VERSION,
+		.settle_time   = CW_DEFAULT_SETTLE_TIME,
+		.step_time     = CW_DEFAULT_STEP_TIME,
+		.wpulse_length = CW_DEFAULT_WPULSE_LENGTH,
+		.nr_tracks     = CW_NR_TRACKS,
+		.nr_sides      = CW_NR_SIDES,
+		.nr_clocks     = CW_NR_CLOCKS,
+		.nr_modes      = CW_NR_MODES,
+		.max_size      = CW_MAX_TRACK_SIZE
+		};
+	emulate_load(emu, &path[strlen(EMULATE_PREFIX)]);
+	emu->start = emulate_time();
+	emulate_device[i] = emu;
+	return (i);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * emulate_path
+ ****************************************************************************/
+cw_bool_t
+emulate_path(
+	const cw_char_t			*path)
+
+	{
+	if (path == NULL) return (CW_BOOL_FALSE);
+	return ((strncmp(path, EMULATE_PREFIX, strlen(EMULATE_PREFIX)) == 0) ? CW_BOOL_TRUE : CW_BOOL_FALSE);
+	}
+
+
+
+/****************************************************************************
+ * emulate_open
+ ****************************************************************************/
+struct emulate *
+emulate_open(
+	const cw_char_t			*path)
+
+	{
+	struct emulate			*emu;
+
+	pthread_mutex_lock(&emulate_mutex);
+	emu = emulate_device[emulate_search(path)];
+	pthread_mutex_unlock(&emulate_mutex);
+	return (emu);
+	}
+
+
+
+/****************************************************************************
+ * emulate_controller
+ ****************************************************************************/
+cw_index_t
+emulate_controller(
+	const cw_char_t			*path)
+
+	{
+	cw_index_t			i;
+
+	/*
+	 * emulated devices are put onto controllers in the order they are
+	 * opened, two per controller like cwXraw0 and cwXraw1
+	 */
+
+	pthread_mutex_lock(&emulate_mutex);
+	i = emulate_search(path);
+	pthread_mutex_unlock(&emulate_mutex);
+	return (i / CW_NR_FLOPPIES_PER_CONTROLLER);
+	}
+
+
+
+/****************************************************************************
+ * emulate_ioctl
+ ****************************************************************************/
+cw_int_t
+emulate_ioctl(
+	struct emulate			*emu,
+	cw_mode_t			cmd,
+	cw_ptr_t			arg)
+
+	{
+	struct cw_floppyinfo		*fli = (struct cw_floppyinfo *) arg;
+	cw_int_t			result = -1;
+
+	/* errors are returned like ioctl() does */
+
+	if (cmd == CW_IOC_GFLPARM)
+		{
+		if (fli->version != CW_STRUCT_VERSION) goto done;
+		*fli = emu->fli;
+		result = 0;
+		}
+	else if (cmd == CW_IOC_SFLPARM) result = emulate_set_parameters(emu, fli);
+	else if (cmd == CW_IOC_READ) result = emulate_read(emu, (struct cw_trackinfo *) arg);
+	else if (cmd == CW_IOC_WRITE) result = emulate_write(emu, (struct cw_trackinfo *) arg);
+	else
+		{
+		errno = ENOTTY;
+		return (-1);
+		}
+done:
+	if (result == -1) errno = EINVAL;
+	return (result);
+	}
+/******************************************************** Karsten Scheibler */
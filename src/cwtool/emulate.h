@@ -0,0 +1,98 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * emulate.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_EMULATE_H
+#define CWTOOL_EMULATE_H
+
+#include "types.h"
+#include "global.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * a path like "emulate:disk.raw" selects an emulated catweasel device,
+ * which answers the ioctls with the tracks of the given raw image
+ */
+
+#define EMULATE_PREFIX			"emulate:"
+#define EMULATE_NR_DEVICES		GLOBAL_NR_DRIVES
+#define EMULATE_NR_ROTATIONS		8
+
+struct emulate_rotation
+	{
+	cw_raw8_t			*data;
+	cw_size_t			size;
+	cw_count64_t			ticks;
+	};
+
+struct emulate_track
+	{
+	struct emulate_rotation		rot[EMULATE_NR_ROTATIONS];
+	cw_count_t			rotations;
+	cw_index_t			next;
+	cw_snum_t			clock;
+	};
+
+struct emulate
+	{
+	cw_char_t			path[GLOBAL_MAX_PATH_SIZE];
+	struct cw_floppyinfo		fli;
+	struct emulate_track		trk[GLOBAL_NR_TRACKS];
+	cw_count_t			head;
+	cw_count64_t			start;
+	cw_count64_t			rotation;
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_bool_t
+emulate_path(
+	const cw_char_t			*path);
+
+extern struct emulate *
+emulate_open(
+	const cw_char_t			*path);
+
+extern cw_index_t
+emulate_controller(
+	const cw_char_t			*path);
+
+extern cw_int_t
+emulate_ioctl(
+	struct emulate			*emu,
+	cw_mode_t			cmd,
+	cw_ptr_t			arg);
+
+
+
+#endif /* !CWTOOL_EMULATE_H */
+/******************************************************** Karsten Scheibler */
@@ -22,6 +22,20 @@
 
 
 
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+static __thread struct error_defer	*error_deferred;
+
+
+
+
 /****************************************************************************
  *
  * global functions
@@ -62,6 +76,30 @@ error_message2(
 	va_start(args, format);
 	if (prepend == NULL) prepend = empty;
 	if (append == NULL) append = empty;
+	if ((error_deferred != NULL) && (flags == ERROR_FLAG_NONE) && (format != NULL))
+		{
+		struct error_defer	*err_dfr = error_deferred;
+		cw_size_t		size = err_dfr->size;
+		cw_size_t		limit = ERROR_DEFER_SIZE;
+
+		size += snprintf(&err_dfr->text[size], limit - size, "%s: %s", global_program_name(), prepend);
+		if (size < limit) size += vsnprintf(&err_dfr->text[size], limit - size, format, args);
+		if (size < limit) size += snprintf(&err_dfr->text[size], limit - size, "%s\n", append);
+		if (size < limit)
+			{
+			err_dfr->size = size;
+			va_end(args);
+			return;
+			}
+
+		/* message does not fit, so print out everything now */
+
+		va_end(args);
+		va_start(args, format);
+		error_defer_flush(err_dfr);
+		}
+	flockfile(stderr);
+	if (error_deferred != NULL) error_defer_flush(error_deferred);
 	if (format != NULL)
 		{
 		fprintf(stderr, "%s: %s", global_program_name(), prepend);
@@ -70,11 +108,84 @@ error_message2(
 		}
 	va_end(args);
 	if (flags & ERROR_FLAG_PERROR) fprintf(stderr, "%s: %s\n", global_program_name(), strerror(errno));
+	funlockfile(stderr);
 	if (flags & ERROR_FLAG_EXIT) error_exit();
 	}
 
 
 
+/****************************************************************************
+ * error_defer
+ ****************************************************************************/
+cw_void_t
+error_defer(
+	struct error_defer		*err_dfr)
+
+	{
+
+	/*
+	 * collect warnings of the calling thread in err_dfr instead of
+	 * printing them, until error_defer(NULL) is called. so they can be
+	 * printed out later with error_defer_flush() at the right place
+	 */
+
+	if (err_dfr != NULL) err_dfr->size = 0;
+	error_deferred = err_dfr;
+	}
+
+
+
+/****************************************************************************
+ * error_defer_flush
+ ****************************************************************************/
+cw_void_t
+error_defer_flush(
+	struct error_defer		*err_dfr)
+
+	{
+	if (err_dfr->size > 0) fwrite(err_dfr->text, 1, err_dfr->size, stderr);
+	err_dfr->size = 0;
+	}
+
+
+
+/****************************************************************************
+ * error_defer_vprintf
+ ****************************************************************************/
+cw_bool_t
+error_defer_vprintf(
+	const cw_char_t			*prepend,
+	const cw_char_t			*format,
+	va_list				args)
+
+	{
+	struct error_defer		*err_dfr = error_deferred;
+	cw_size_t			size, limit = ERROR_DEFER_SIZE;
+
+	/*
+	 * verbose and debug messages go to the same buffer as warnings, so
+	 * they stay in order. returns CW_BOOL_FALSE if the caller has to
+	 * print the message itself
+	 */
+
+	if (err_dfr == NULL) return (CW_BOOL_FALSE);
+	size = err_dfr->size;
+	size += snprintf(&err_dfr->text[size], limit - size, "%s", prepend);
+	if (size < limit) size += vsnprintf(&err_dfr->text[size], limit - size, format, args);
+	if (size < limit) size += snprintf(&err_dfr->text[size], limit - size, "\n");
+	if (size < limit)
+		{
+		err_dfr->size = size;
+		return (CW_BOOL_TRUE);
+		}
+	flockfile(stderr);
+	error_defer_flush(err_dfr);
+	funlockfile(stderr);
+	return (CW_BOOL_FALSE);
+	}
+
+
+
 /****************************************************************************
  * error_oom
  ****************************************************************************/
@@ -13,11 +13,33 @@
 #ifndef CWTOOL_ERROR_H
 #define CWTOOL_ERROR_H
 
+#include <stdarg.h>
+
 #include "types.h"
 
 
 
 
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define ERROR_DEFER_SIZE		0x1000
+
+struct error_defer
+	{
+	cw_char_t			text[ERROR_DEFER_SIZE];
+	cw_size_t			size;
+	};
+
+
+
+
 /****************************************************************************
  *
  * global functions
@@ -43,6 +65,20 @@ error_message2(
 	const cw_char_t			*format,
 	...);
 
+extern cw_void_t
+error_defer(
+	struct error_defer		*err_dfr);
+
+extern cw_void_t
+error_defer_flush(
+	struct error_defer		*err_dfr);
+
+extern cw_bool_t
+error_defer_vprintf(
+	const cw_char_t			*prepend,
+	const cw_char_t			*format,
+	va_list				args);
+
 extern cw_void_t
 error_oom(
 	cw_void_t);
@@ -22,6 +22,29 @@
 
 
 
+/****************************************************************************
+ * fifo_cache_fill
+ ****************************************************************************/
+static void
+fifo_cache_fill(
+	struct fifo			*ffo,
+	int				ofs)
+
+	{
+	int				i, size = ffo->size - ofs;
+
+	if (size > 8) size = 8;
+	for (ffo->cache = 0, i = 0; i < 8; i++)
+		{
+		ffo->cache <<= 8;
+		if (i < size) ffo->cache |= ffo->data[ofs + i];
+		}
+	ffo->cache_ofs  = ofs;
+	ffo->cache_size = size;
+	}
+
+
+
 /****************************************************************************
  * fifo_reset
  ****************************************************************************/
@@ -86,6 +109,13 @@ fifo_get_data(
 	struct fifo			*ffo)
 
 	{
+
+	/*
+	 * caller may modify the data behind our back, so do not trust the
+	 * cache anymore
+	 */
+
+	ffo->cache_size = 0;
 	return (ffo->data);
 	}
 
@@ -102,6 +132,7 @@ fifo_set_wr_ofs(
 	{
 	debug_error_condition((wr_ofs < 0) || (wr_ofs > ffo->limit));
 	debug_error_condition(ffo->wr_bitofs & 7);
+	ffo->cache_size = 0;
 	ffo->wr_ofs    = wr_ofs;
 	ffo->wr_bitofs = 8 * wr_ofs;
 	return (0);
@@ -235,8 +266,35 @@ fifo_read_bits(
 	{
 	int				avail = 0, shift = ffo->rd_bitofs & 7;
 	int				mask = (1 << bits) - 1;
+	int				end = ffo->rd_bitofs + bits;
+	int				pos, rest;
 
 	debug_error_condition(bits > 16);
+
+	/*
+	 * fast path: take the bits out of the 64 bit cache, the cache gets
+	 * refilled with 8 bytes at once if needed. reg is set up exactly as
+	 * the byte wise code below would do it, so fifo_last_bit_read(),
+	 * fifo_read_count() and fifo_set_rd_bitofs() keep working as before
+	 */
+
+	if ((bits > 0) && (end < ffo->wr_bitofs) && (ffo->rd_ofs == (ffo->rd_bitofs + 7) / 8))
+		{
+		pos = ffo->rd_bitofs - 8 * ffo->cache_ofs;
+		if ((pos < 0) || (end > 8 * (ffo->cache_ofs + ffo->cache_size)))
+			{
+			fifo_cache_fill(ffo, ffo->rd_bitofs / 8);
+			pos = shift;
+			}
+		rest = (8 - (end & 7)) & 7;
+		ffo->reg       = (int) ((ffo->cache << pos) >> (64 - bits - rest)) << (8 - rest);
+		ffo->rd_bitofs = end;
+		ffo->rd_ofs    = (end + 7) / 8;
+		return ((ffo->reg >> 8) & mask);
+		}
+
+	/* slow path near the end of data, may leave a partial read */
+
 	if (shift > 0) avail = 8 - shift;
 	while (avail < bits)
 		{
@@ -255,6 +313,37 @@ fifo_read_bits(
 
 
 
+/****************************************************************************
+ * fifo_peek_bits64
+ ****************************************************************************/
+cw_u64_t
+fifo_peek_bits64(
+	struct fifo			*ffo,
+	int				bitofs)
+
+	{
+	cw_u64_t			val;
+	int				i, ofs = bitofs / 8, shift = bitofs & 7;
+
+	/*
+	 * returns 64 bits starting at bitofs msb first without changing the
+	 * read position, bits beyond wr_ofs are 0. this allows callers to
+	 * decode whole groups of bits, afterwards they have to set the read
+	 * position themselves
+	 */
+
+	debug_error_condition(bitofs < 0);
+	if (ofs + 8 < ffo->wr_ofs)
+		{
+		for (val = 0, i = 0; i < 8; i++) val = (val << 8) | ffo->data[ofs + i];
+		return ((val << shift) | (ffo->data[ofs + 8] >> (8 - shift)));
+		}
+	for (val = 0, i = 0; i < 8; i++) val = (val << 8) | ((ofs + i < ffo->wr_ofs) ? ffo->data[ofs + i] : 0);
+	return (val << shift);
+	}
+
+
+
 /****************************************************************************
  * fifo_write_bits
  ****************************************************************************/
@@ -270,6 +359,7 @@ fifo_write_bits(
 
 	debug_error_condition(bits > 16);
 	debug_error_condition((val < 0) || (val >= (1 << bits)));
+	ffo->cache_size = 0;
 	ffo->reg = (ffo->reg << bits) | val;
 	while (avail > 7)
 		{
@@ -310,6 +400,68 @@ fifo_read_count(
 
 
 
+/****************************************************************************
+ * fifo_write_counts
+ ****************************************************************************/
+int
+fifo_write_counts(
+	struct fifo			*ffo,
+	unsigned char			*counts,
+	int				size)
+
+	{
+	cw_u64_t			acc;
+	int				b, c, i, n;
+	int				wr_ofs = ffo->wr_bitofs / 8;
+
+	/*
+	 * same as calling fifo_write_count() for each element of counts[],
+	 * but bits are collected in a 64 bit accumulator and only complete
+	 * bytes are stored. the pending bits of a partially written byte
+	 * are kept in reg like fifo_write_bits() does, so fifo_write_flush()
+	 * and fifo_last_bit_written() work as usual. if the fifo gets full
+	 * all complete bytes up to limit are stored and -1 is returned
+	 */
+
+	if (size <= 0) return (0);
+	ffo->cache_size = 0;
+	b   = ffo->wr_bitofs & 7;
+	acc = ffo->reg & ((1 << b) - 1);
+	for (i = 0; i < size; i++)
+		{
+		for (c = counts[i] + 1; c > 0; c -= n)
+			{
+			n = (c > 56) ? 56 : c;
+			if (b + n > 64)
+				{
+				for ( ; b > 7; b -= 8)
+					{
+					if (wr_ofs >= ffo->limit) goto full;
+					ffo->data[wr_ofs++] = acc >> (b - 8);
+					}
+				}
+			acc = (acc << n) | ((c == n) ? 1 : 0);
+			b += n;
+			}
+		}
+	for ( ; b > 7; b -= 8)
+		{
+		if (wr_ofs >= ffo->limit) goto full;
+		ffo->data[wr_ofs++] = acc >> (b - 8);
+		}
+	ffo->wr_bitofs = 8 * wr_ofs + b;
+	ffo->wr_ofs    = (ffo->wr_bitofs + 7) / 8;
+	ffo->reg       = acc & 0xffff;
+	return (0);
+full:
+	ffo->wr_ofs    = wr_ofs;
+	ffo->wr_bitofs = 8 * wr_ofs;
+	ffo->reg       = 0;
+	return (-1);
+	}
+
+
+
 /****************************************************************************
  * fifo_read_byte
  ****************************************************************************/
@@ -337,6 +489,7 @@ fifo_write_byte(
 	{
 	if (ffo->wr_ofs >= ffo->limit) return (-1);
 	debug_error_condition((ffo->wr_bitofs & 7) != 0);
+	ffo->cache_size = 0;
 	ffo->wr_bitofs += 8;
 	ffo->data[ffo->wr_ofs++] = byte;
 	return (0);
@@ -386,6 +539,7 @@ fifo_write_block(
 	debug_error_condition(data == NULL);
 	debug_error_condition((ffo->wr_bitofs & 7) != 0);
 	if (ffo->wr_ofs + size > ffo->limit) result = -1, size = ffo->limit - ffo->wr_ofs;
+	ffo->cache_size = 0;
 	memcpy(&ffo->data[ffo->wr_ofs], data, size);
 	ffo->wr_ofs += size;
 	ffo->wr_bitofs += 8 * size;
@@ -413,6 +567,7 @@ fifo_copy_block(
 	debug_error_condition((ffo_dst->wr_bitofs & 7) != 0);
 	if (ffo_src->rd_ofs + size > ffo_src->wr_ofs) result = -1, size = ffo_src->wr_ofs - ffo_src->rd_ofs;
 	if (ffo_dst->wr_ofs + size > ffo_dst->limit) result = -1, size = ffo_dst->limit - ffo_dst->wr_ofs;
+	ffo_dst->cache_size = 0;
 	memcpy(&ffo_dst->data[ffo_dst->wr_ofs], &ffo_src->data[ffo_src->rd_ofs], size);
 	ffo_src->rd_ofs += size;
 	ffo_src->rd_bitofs += 8 * size;
@@ -457,6 +612,7 @@ fifo_write_flush(
 	struct fifo			*ffo)
 
 	{
+	ffo->cache_size = 0;
 	if (ffo->wr_bitofs & 7) ffo->data[ffo->wr_ofs - 1] = ffo->reg << (8 - (ffo->wr_bitofs & 7));
 	ffo->reg = 0;
 	return (0);
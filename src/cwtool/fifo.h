@@ -35,6 +35,12 @@
 #define FIFO_FLAG_INDEX_STORED		(1 << 1)
 #define FIFO_FLAG_INDEX_ALIGNED		(1 << 2)
 
+/*
+ * cache holds up to 8 bytes of data starting at byte cache_ofs, the first
+ * byte in the most significant bits. cache_size == 0 means the cache is
+ * invalid, so FIFO_INIT() and fifo_reset() need no special handling
+ */
+
 struct fifo
 	{
 	unsigned char			*data;
@@ -47,6 +53,9 @@ struct fifo
 	int				reg;
 	int				flags;
 	int				speed;
+	cw_u64_t			cache;
+	int				cache_ofs;
+	int				cache_size;
 	};
 
 
@@ -76,8 +85,10 @@ extern int				fifo_get_rd_bitofs(struct fifo *);
 extern int				fifo_last_bit_read(struct fifo *);
 extern int				fifo_last_bit_written(struct fifo *);
 extern int				fifo_read_bits(struct fifo *, int);
+extern cw_u64_t				fifo_peek_bits64(struct fifo *, int);
 extern int				fifo_write_bits(struct fifo *, int, int);
 extern int				fifo_read_count(struct fifo *);
+extern int				fifo_write_counts(struct fifo *, unsigned char *, int);
 extern int				fifo_read_byte(struct fifo *);
 extern int				fifo_write_byte(struct fifo *, int);
 extern int				fifo_read_block(struct fifo *, unsigned char *, int);
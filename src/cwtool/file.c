@@ -15,8 +15,11 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
@@ -28,6 +31,7 @@
 #include "global.h"
 #include "options.h"
 #include "string.h"
+#include "emulate.h"
 
 
 
@@ -58,7 +62,7 @@ file_tmp(
 	if (path == NULL) error_oom();
 	if (tmp_dir == NULL) tmp_dir = "/tmp";
 	if (gettimeofday(&tv, NULL) == -1) error_perror_message("error while gettimeofday()");
-	len = snprintf(path, size, "%s/%s-%010d-%010ld-%06d-%05d", tmp_dir, global_program_name(), count++, tv.tv_sec, tv.tv_usec, getpid());
+	len = snprintf(path, size, "%s/%s-%010d-%010ld-%06d-%05d", tmp_dir, global_program_name(), __sync_fetch_and_add(&count, 1), tv.tv_sec, tv.tv_usec, getpid());
 	if ((len == -1) || (len >= size)) error_message("path for tmp file too long");
 	return (path);
 	}
@@ -113,6 +117,18 @@ file_open(
 		.mode = mode
 		};
 
+	/*
+	 * emulated devices have no fd, they are handled completely in
+	 * emulate.c
+	 */
+
+	if ((mode != FILE_MODE_TMP) && (emulate_path(path)))
+		{
+		verbose_message(GENERIC, 2, "opening emulated device '%s'", path);
+		fil->emu = emulate_open(path);
+		return (CW_BOOL_OK);
+		}
+
 	/*
 	 * check if we really have to open a file or just take the fds of
 	 * stdin and stdout
@@ -188,13 +204,48 @@ file_close(
 	struct file			*fil)
 
 	{
-	if (close(fil->fd) == -1) error_perror_message("error while closing '%s'", fil->path);
+	if (fil->map != NULL) munmap(fil->map, fil->map_size);
+	if ((fil->emu == NULL) && (close(fil->fd) == -1)) error_perror_message("error while closing '%s'", fil->path);
 	if (fil->allocated) free(fil->path);
 	*fil = (struct file) { .fd = -1 };
 	}
 
 
 
+/****************************************************************************
+ * file_map
+ ****************************************************************************/
+cw_bool_t
+file_map(
+	struct file			*fil)
+
+	{
+	struct stat			st;
+	cw_count_t			ofs;
+	void				*map;
+
+	/*
+	 * only regular files opened for reading are mapped, pipes, stdin
+	 * and devices are read as before. the current file offset is
+	 * taken over, so mapping is possible at any time
+	 */
+
+	if ((fil->mode != FILE_MODE_READ) || (fil->map != NULL)) return (CW_BOOL_FAIL);
+	if (fstat(fil->fd, &st) == -1) return (CW_BOOL_FAIL);
+	if ((! S_ISREG(st.st_mode)) || (st.st_size <= 0) || (st.st_size > 0x7fffffff)) return (CW_BOOL_FAIL);
+	ofs = lseek(fil->fd, 0, SEEK_CUR);
+	if (ofs == -1) return (CW_BOOL_FAIL);
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fil->fd, 0);
+	if (map == MAP_FAILED) return (CW_BOOL_FAIL);
+	fil->map      = (cw_raw8_t *) map;
+	fil->map_size = st.st_size;
+	fil->map_ofs  = ofs;
+	verbose_message(GENERIC, 2, "mapped '%s' with %d bytes into memory", fil->path, fil->map_size);
+	return (CW_BOOL_OK);
+	}
+
+
+
 /****************************************************************************
  * file_get_path
  ****************************************************************************/
@@ -259,7 +310,8 @@ file_ioctl2(
 
 	while (1)
 		{
-		result = ioctl(fil->fd, cmd, arg);
+		if (fil->emu != NULL) result = emulate_ioctl(fil->emu, cmd, arg);
+		else result = ioctl(fil->fd, cmd, arg);
 		if (result != -1) break;
 		if (file_try_again(errno)) continue;
 		if (flags & FILE_FLAG_RETURN) break;
@@ -270,6 +322,30 @@ file_ioctl2(
 
 
 
+/****************************************************************************
+ * file_controller
+ ****************************************************************************/
+cw_index_t
+file_controller(
+	const cw_char_t			*path)
+
+	{
+	struct stat			st;
+
+	/*
+	 * returns the catweasel controller a device belongs to, the driver
+	 * encodes it in the minor number. -1 is returned for anything else,
+	 * errors are left to file_open()
+	 */
+
+	if (emulate_path(path)) return (emulate_controller(path));
+	if ((path == NULL) || (stat(path, &st) == -1)) return (-1);
+	if (! S_ISCHR(st.st_mode)) return (-1);
+	return ((minor(st.st_rdev) >> FILE_CONTROLLER_SHIFT) % CW_NR_CONTROLLERS);
+	}
+
+
+
 /****************************************************************************
  * file_seek
  ****************************************************************************/
@@ -288,6 +364,11 @@ file_seek(
 	 * occur in combination with lseek()
 	 */
 
+	if (fil->map != NULL)
+		{
+		if (ofs >= 0) fil->map_ofs = ofs;
+		return (fil->map_ofs);
+		}
 	if (ofs < 0) ofs = 0, whence = SEEK_CUR;
 	while (1)
 		{
@@ -316,6 +397,14 @@ file_read(
 	cw_count_t			ofs = 0;
 
 	debug_error_condition(! file_is_readable(fil));
+	if (fil->map != NULL)
+		{
+		if (fil->map_ofs >= fil->map_size) return (0);
+		if (size > fil->map_size - fil->map_ofs) size = fil->map_size - fil->map_ofs;
+		memcpy(data, &fil->map[fil->map_ofs], size);
+		fil->map_ofs += size;
+		return (size);
+		}
 	while ((result > 0) && (size > 0))
 		{
 		result = read(fil->fd, data, size);
@@ -349,6 +438,94 @@ file_read_strict(
 
 
 
+/****************************************************************************
+ * file_read_map
+ ****************************************************************************/
+cw_raw8_t *
+file_read_map(
+	struct file			*fil,
+	cw_size_t			size)
+
+	{
+	cw_raw8_t			*data;
+
+	/*
+	 * like file_read_strict(), but returns a pointer into the mapping
+	 * instead of copying the data. returns NULL if the file is not
+	 * mapped, the caller then has to use file_read_strict()
+	 */
+
+	if (fil->map == NULL) return (NULL);
+	if ((fil->map_ofs >= fil->map_size) || (size > fil->map_size - fil->map_ofs)) error_message("file '%s' truncated", fil->path);
+	data = &fil->map[fil->map_ofs];
+	fil->map_ofs += size;
+	return (data);
+	}
+
+
+
+/****************************************************************************
+ * file_pread
+ ****************************************************************************/
+cw_count_t
+file_pread(
+	struct file			*fil,
+	cw_void_t			*data,
+	cw_size_t			size,
+	cw_count_t			ofs)
+
+	{
+	cw_int_t			result = 1;
+	cw_count_t			done = 0;
+
+	/*
+	 * read at the given file offset, the current file offset is not
+	 * changed. only usable with regular files or if file is mapped
+	 */
+
+	debug_error_condition(! file_is_readable(fil));
+	if (fil->map != NULL)
+		{
+		if (ofs >= fil->map_size) return (0);
+		if (size > fil->map_size - ofs) size = fil->map_size - ofs;
+		memcpy(data, &fil->map[ofs], size);
+		return (size);
+		}
+	while ((result > 0) && (size > 0))
+		{
+		result = pread(fil->fd, data, size, ofs);
+		if (result == -1)
+			{
+			if (file_try_again(errno)) continue;
+			error_perror_message("error while reading from '%s'", fil->path);
+			}
+		data += result;
+		size -= result;
+		ofs  += result;
+		done += result;
+		}
+	return (done);
+	}
+
+
+
+/****************************************************************************
+ * file_pread_strict
+ ****************************************************************************/
+cw_count_t
+file_pread_strict(
+	struct file			*fil,
+	cw_void_t			*data,
+	cw_size_t			size,
+	cw_count_t			ofs)
+
+	{
+	if (file_pread(fil, data, size, ofs) != size) error_message("file '%s' truncated", fil->path);
+	return (size);
+	}
+
+
+
 /****************************************************************************
  * file_write
  ****************************************************************************/
@@ -35,12 +35,28 @@
 #define FILE_FLAG_NONE			0
 #define FILE_FLAG_RETURN		(1 << 0)
 
+/* same as get_controller() in the driver */
+
+#define FILE_CONTROLLER_SHIFT		6
+
+/*
+ * if map != NULL the whole file is mapped into memory, reading and seeking
+ * is then done on the mapping with map_ofs as current file offset. if
+ * emu != NULL the file is an emulated catweasel device without fd
+ */
+
+struct emulate;
+
 struct file
 	{
 	cw_char_t			*path;
 	cw_int_t			fd;
 	cw_mode_t			mode;
 	cw_bool_t			allocated;
+	cw_raw8_t			*map;
+	cw_size_t			map_size;
+	cw_count_t			map_ofs;
+	struct emulate			*emu;
 	};
 
 
@@ -66,6 +82,10 @@ extern cw_void_t
 file_close(
 	struct file			*fil);
 
+extern cw_bool_t
+file_map(
+	struct file			*fil);
+
 extern const cw_char_t *
 file_get_path(
 	struct file			*fil);
@@ -85,6 +105,10 @@ file_ioctl2(
 	cw_ptr_t			arg,
 	cw_flag_t			flags);
 
+extern cw_index_t
+file_controller(
+	const cw_char_t			*path);
+
 extern cw_count_t
 file_seek(
 	struct file			*fil,
@@ -103,6 +127,25 @@ file_read_strict(
 	cw_void_t			*data,
 	cw_size_t			size);
 
+extern cw_raw8_t *
+file_read_map(
+	struct file			*fil,
+	cw_size_t			size);
+
+extern cw_count_t
+file_pread(
+	struct file			*fil,
+	cw_void_t			*data,
+	cw_size_t			size,
+	cw_count_t			ofs);
+
+extern cw_count_t
+file_pread_strict(
+	struct file			*fil,
+	cw_void_t			*data,
+	cw_size_t			size,
+	cw_count_t			ofs);
+
 extern cw_count_t
 file_write(
 	struct file			*fil,
@@ -19,10 +19,15 @@
 #include "../global.h"
 #include "../options.h"
 #include "../fifo.h"
+#include "../stage.h"
 #include "bounds.h"
 
 
 
+#define BITSTREAM_BLOCK_SIZE		1024
+
+
+
 
 /****************************************************************************
  *
@@ -81,6 +86,35 @@ bitstream_read_lookup2(
 
 
 
+/****************************************************************************
+ * bitstream_read_block
+ ****************************************************************************/
+static int
+bitstream_read_block(
+	struct fifo			*ffo_l0,
+	int				*lookup,
+	unsigned char			*data,
+	int				size)
+
+	{
+	int				i;
+
+	/*
+	 * read up to size raw counter values and convert them in place to
+	 * counts suitable for fifo_write_counts()
+	 */
+
+	i = fifo_get_wr_ofs(ffo_l0) - fifo_get_rd_ofs(ffo_l0);
+	if (size > i) size = i;
+	if (size <= 0) return (0);
+	fifo_read_block(ffo_l0, data, size);
+	for (i = 0; i < size; i++) data[i] = lookup[data[i] & GLOBAL_PULSE_LENGTH_MASK];
+	return (size);
+	}
+
+
+
+
 /****************************************************************************
  *
  * global functions
@@ -171,10 +205,14 @@ bitstream_read(
 	int				bnd_size)
 
 	{
+	unsigned char			data[BITSTREAM_BLOCK_SIZE];
 	int				i, lookup[GLOBAL_NR_PULSE_LENGTHS];
+	int				rd_ofs = fifo_get_rd_ofs(ffo_l0);
+	int				wr_bitofs = fifo_get_wr_bitofs(ffo_l1);
 
 	/* create lookup table */
 
+	stage_enter(BITSTREAM);
 	bitstream_read_lookup(bnd, bnd_size, lookup);
 
 	/* convert raw counter values to raw bits */
@@ -182,12 +220,14 @@ bitstream_read(
 	debug_message(GENERIC, 3, "bitstream_read ffo_l0->wr_ofs = %d, ffo_l1->limit = %d", fifo_get_wr_ofs(ffo_l0), fifo_get_limit(ffo_l1));
 	while (1)
 		{
-		i = bitstream_read_counter(ffo_l0, lookup);
-		if (i == -1) break;
-		if (fifo_write_count(ffo_l1, i) == -1) debug_error();
+		i = bitstream_read_block(ffo_l0, lookup, data, BITSTREAM_BLOCK_SIZE);
+		if (i == 0) break;
+		if (fifo_write_counts(ffo_l1, data, i) == -1) debug_error();
 		}
 	fifo_write_flush(ffo_l1);
 	debug_message(GENERIC, 3, "bitstream_read ffo_l0->wr_ofs = %d, ffo_l1->wr_bitofs = %d", fifo_get_wr_ofs(ffo_l0), fifo_get_wr_bitofs(ffo_l1));
+	stage_count(BITSTREAM, (fifo_get_wr_bitofs(ffo_l1) - wr_bitofs) / 8, fifo_get_rd_ofs(ffo_l0) - rd_ofs);
+	stage_leave();
 	return (0);
 	}
 
@@ -206,34 +246,44 @@ bitstream_read_map(
 	int				bst_map_size)
 
 	{
-	int				b, e, i, j, s;
+	unsigned char			data[BITSTREAM_BLOCK_SIZE];
+	int				e, i, j, k, n, s;
 	int				lookup[GLOBAL_NR_PULSE_LENGTHS];
 	int				error[GLOBAL_NR_PULSE_LENGTHS];
+	int				wr_bitofs = (ffo_l1 != NULL) ? fifo_get_wr_bitofs(ffo_l1) : 0;
 
 	/* create lookup table */
 
+	stage_enter(BITSTREAM);
 	bitstream_read_lookup2(bnd, bnd_size, lookup, error);
 
 	/* convert raw counter values to raw bits */
 
 	debug_message(GENERIC, 3, "bitstream_read_map ffo_l0->wr_ofs = %d", fifo_get_wr_ofs(ffo_l0));
 	if (ffo_l1 != NULL) debug_message(GENERIC, 3, "bitstream_read_map ffo_l1->limit = %d", fifo_get_limit(ffo_l1));
-	for (j = 0, s = 0; j < bst_map_size; j++)
+	for (j = 0, s = 0; j < bst_map_size; j += n)
 		{
-		b = fifo_read_byte(ffo_l0);
-		if (b == -1) break;
-		e = error[b & GLOBAL_PULSE_LENGTH_MASK];
-		i = lookup[b & GLOBAL_PULSE_LENGTH_MASK];
-		s += i + 1;
-		bst_map[j] = (struct bitstream_map)
+		n = fifo_get_wr_ofs(ffo_l0) - fifo_get_rd_ofs(ffo_l0);
+		if (n > bst_map_size - j) n = bst_map_size - j;
+		if (n > BITSTREAM_BLOCK_SIZE) n = BITSTREAM_BLOCK_SIZE;
+		if (n <= 0) break;
+		fifo_read_block(ffo_l0, data, n);
+		for (k = 0; k < n; k++)
 			{
-			.length     = i + 1,
-			.length_sum = s,
-			.error      = e
-			};
+			e = error[data[k] & GLOBAL_PULSE_LENGTH_MASK];
+			i = lookup[data[k] & GLOBAL_PULSE_LENGTH_MASK];
+			s += i + 1;
+			bst_map[j + k] = (struct bitstream_map)
+				{
+				.length     = i + 1,
+				.length_sum = s,
+				.error      = e
+				};
+			data[k] = i;
+			}
 		if (ffo_l1 != NULL)
 			{
-			if (fifo_write_count(ffo_l1, i) == -1) debug_error();
+			if (fifo_write_counts(ffo_l1, data, n) == -1) debug_error();
 			}
 		}
 	debug_message(GENERIC, 3, "bitstream_read_map ffo_l0->wr_ofs = %d", fifo_get_wr_ofs(ffo_l0));
@@ -241,7 +291,10 @@ bitstream_read_map(
 		{
 		fifo_write_flush(ffo_l1);
 		debug_message(GENERIC, 3, "bitstream_read_map ffo_l1->wr_bitofs = %d", fifo_get_wr_bitofs(ffo_l1));
+		wr_bitofs = fifo_get_wr_bitofs(ffo_l1) - wr_bitofs;
 		}
+	stage_count(BITSTREAM, wr_bitofs / 8, j);
+	stage_leave();
 	return (j);
 	}
 
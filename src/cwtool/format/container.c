@@ -24,6 +24,100 @@
 
 
 
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * container_alloc
+ ****************************************************************************/
+static cw_void_t *
+container_alloc(
+	struct container		*con,
+	cw_size_t			size)
+
+	{
+	struct container_block		*blk, **prev;
+	cw_void_t			*ptr;
+
+	/* keep everything 8 byte aligned, struct container_lookup needs 4 */
+
+	size = (size + 7) & ~7;
+
+	/*
+	 * take the first block with enough space left starting at the
+	 * current one, if there is none append a new block
+	 */
+
+	for (blk = con->blk_current; blk != NULL; blk = blk->next)
+		{
+		if (blk->size - blk->used >= size) break;
+		}
+	if (blk == NULL)
+		{
+		for (prev = &con->blk; *prev != NULL; prev = &(*prev)->next) ;
+		blk = malloc(sizeof (struct container_block));
+		if (blk == NULL) error_oom();
+		*blk = (struct container_block) { .size = (size > CONTAINER_BLOCK_SIZE) ? size : CONTAINER_BLOCK_SIZE };
+		blk->data = malloc(blk->size * sizeof (cw_raw8_t));
+		if (blk->data == NULL) error_oom();
+		*prev = blk;
+		}
+	con->blk_current = blk;
+	ptr = &blk->data[blk->used];
+	blk->used += size;
+	return (ptr);
+	}
+
+
+
+/****************************************************************************
+ * container_grow_entries
+ ****************************************************************************/
+static cw_void_t
+container_grow_entries(
+	struct container		*con)
+
+	{
+	cw_count_t			limit = con->entries_limit;
+
+	error_condition(limit >= CONTAINER_NR_ENTRIES);
+	limit = (limit == 0) ? CONTAINER_INIT_ENTRIES : 2 * limit;
+	if (limit > CONTAINER_NR_ENTRIES) limit = CONTAINER_NR_ENTRIES;
+	con->ent = realloc(con->ent, limit * sizeof (struct container_entry));
+	if (con->ent == NULL) error_oom();
+	memset(&con->ent[con->entries_limit], 0, (limit - con->entries_limit) * sizeof (struct container_entry));
+	con->entries_limit = limit;
+	}
+
+
+
+/****************************************************************************
+ * container_grow_ranges
+ ****************************************************************************/
+static cw_void_t
+container_grow_ranges(
+	struct container_entry		*ent)
+
+	{
+	cw_count_t			limit = ent->range_limit;
+
+	error_condition(limit >= CONTAINER_NR_RANGES);
+	limit = (limit == 0) ? CONTAINER_INIT_RANGES : 2 * limit;
+	if (limit > CONTAINER_NR_RANGES) limit = CONTAINER_NR_RANGES;
+	ent->rng_sec = realloc(ent->rng_sec, limit * sizeof (struct range_sector));
+	if (ent->rng_sec == NULL) error_oom();
+	ent->range_limit = limit;
+	}
+
+
+
+
 /****************************************************************************
  *
  * global functions
@@ -63,15 +157,21 @@ container_deinit(
 	struct container		*con)
 
 	{
+	struct container_block		*blk, *next;
 	cw_flag_t			flags = con->flags;
 	cw_index_t			i;
 
 	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
-	for (i = 0; i < con->entries; i++)
+	for (i = 0; i < con->entries_limit; i++)
 		{
-		if (con->data[i]  != NULL) free(con->data[i]);
-		if (con->error[i] != NULL) free(con->error[i]);
-		if (con->lkp[i]   != NULL) free(con->lkp[i]);
+		if (con->ent[i].rng_sec != NULL) free(con->ent[i].rng_sec);
+		}
+	if (con->ent != NULL) free(con->ent);
+	for (blk = con->blk; blk != NULL; blk = next)
+		{
+		next = blk->next;
+		free(blk->data);
+		free(blk);
 		}
 	con->flags = CONTAINER_FLAG_NONE;
 	if (flags & CONTAINER_FLAG_MALLOC) free(con);
@@ -79,6 +179,28 @@ container_deinit(
 
 
 
+/****************************************************************************
+ * container_reset
+ ****************************************************************************/
+cw_void_t
+container_reset(
+	struct container		*con)
+
+	{
+	struct container_block		*blk;
+	cw_index_t			i;
+
+	/* drop all entries, but keep the allocated memory for reuse */
+
+	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
+	for (i = 0; i < con->entries; i++) con->ent[i].range_entries = 0;
+	for (blk = con->blk; blk != NULL; blk = blk->next) blk->used = 0;
+	con->blk_current = con->blk;
+	con->entries     = 0;
+	}
+
+
+
 /****************************************************************************
  * container_store_data_and_error
  ****************************************************************************/
@@ -90,20 +212,24 @@ container_store_data_and_error(
 	cw_size_t			size)
 
 	{
+	struct container_entry		*ent;
 	cw_index_t			i = con->entries;
 
 	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
 	error_condition(i >= CONTAINER_NR_ENTRIES);
-	con->data[i]  = malloc(size * sizeof (cw_raw8_t));
-	con->error[i] = malloc(size * sizeof (cw_raw8_t));
-	con->lkp[i]   = malloc(size * sizeof (struct container_lookup));
-	con->size[i]  = size;
-	con->limit[i] = size;
+	if (i >= con->entries_limit) container_grow_entries(con);
+	ent = &con->ent[i];
+	ent->data          = container_alloc(con, size * sizeof (cw_raw8_t));
+	ent->error         = container_alloc(con, size * sizeof (cw_raw8_t));
+	ent->lkp           = container_alloc(con, size * sizeof (struct container_lookup));
+	ent->votes         = NULL;
+	ent->size          = size;
+	ent->limit         = size;
+	ent->range_entries = 0;
 	con->entries++;
-	if ((con->data[i] == NULL) || (con->error[i] == NULL) || (con->lkp[i] == NULL)) error_oom();
-	if (data  != NULL) memcpy(con->data[i],  data,  size);
-	if (error != NULL) memcpy(con->error[i], error, size);
-	memset(con->lkp[i], 0, size * sizeof (struct container_lookup));
+	if (data  != NULL) memcpy(ent->data,  data,  size);
+	if (error != NULL) memcpy(ent->error, error, size);
+	memset(ent->lkp, 0, size * sizeof (struct container_lookup));
 	return(i);
 	}
 
@@ -134,7 +260,7 @@ container_get_data(
 	{
 	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
 	error_condition((index < 0) || (index >= con->entries));
-	return (con->data[index]);
+	return (con->ent[index].data);
 	}
 
 
@@ -150,7 +276,31 @@ container_get_error(
 	{
 	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
 	error_condition((index < 0) || (index >= con->entries));
-	return (con->error[index]);
+	return (con->ent[index].error);
+	}
+
+
+
+/****************************************************************************
+ * container_get_votes
+ ****************************************************************************/
+cw_raw8_t *
+container_get_votes(
+	struct container		*con,
+	cw_index_t			index)
+
+	{
+	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
+	error_condition((index < 0) || (index >= con->entries));
+
+	/* only needed for merged entries, so allocate on first use */
+
+	if (con->ent[index].votes == NULL)
+		{
+		con->ent[index].votes = container_alloc(con, con->ent[index].size * sizeof (cw_raw8_t));
+		memset(con->ent[index].votes, 0, con->ent[index].size);
+		}
+	return (con->ent[index].votes);
 	}
 
 
@@ -166,7 +316,7 @@ container_get_lookup(
 	{
 	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
 	error_condition((index < 0) || (index >= con->entries));
-	return (con->lkp[index]);
+	return (con->ent[index].lkp);
 	}
 
 
@@ -182,7 +332,7 @@ container_get_size(
 	{
 	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
 	error_condition((index < 0) || (index >= con->entries));
-	return (con->size[index]);
+	return (con->ent[index].size);
 	}
 
 
@@ -199,8 +349,8 @@ container_set_limit(
 	{
 	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
 	error_condition((index < 0) || (index >= con->entries));
-	error_condition((limit < 0) || (limit > con->size[index]));
-	con->limit[index] = limit;
+	error_condition((limit < 0) || (limit > con->ent[index].size));
+	con->ent[index].limit = limit;
 	}
 
 
@@ -216,7 +366,7 @@ container_get_limit(
 	{
 	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
 	error_condition((index < 0) || (index >= con->entries));
-	return (con->limit[index]);
+	return (con->ent[index].limit);
 	}
 
 
@@ -238,8 +388,8 @@ container_lookup_position(
 	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
 	error_condition((index < 0) || (index >= con->entries));
 	l = 0;
-	h = con->limit[index];
-	con_lkp = con->lkp[index];
+	h = con->ent[index].limit;
+	con_lkp = con->ent[index].lkp;
 	do
 		{
 		m = (l + h) / 2;
@@ -263,14 +413,17 @@ container_store_range_sector(
 	struct range_sector		*rng_sec)
 
 	{
+	struct container_entry		*ent;
 	cw_index_t			i;
 
 	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
 	error_condition((index < 0) || (index >= con->entries));
-	i = con->range_entries[index];
+	ent = &con->ent[index];
+	i = ent->range_entries;
 	error_condition(i >= CONTAINER_NR_RANGES);
-	con->rng_sec[index][i] = *rng_sec;
-	con->range_entries[index]++;
+	if (i >= ent->range_limit) container_grow_ranges(ent);
+	ent->rng_sec[i] = *rng_sec;
+	ent->range_entries++;
 	return (i);
 	}
 
@@ -300,7 +453,8 @@ container_get_range_entries(
 
 	{
 	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
-	return (con->range_entries[index]);
+	error_condition((index < 0) || (index >= con->entries));
+	return (con->ent[index].range_entries);
 	}
 
 
@@ -317,7 +471,7 @@ container_get_range_sector(
 	{
 	error_condition(! (con->flags & CONTAINER_FLAG_INITIALIZED));
 	error_condition((index < 0) || (index >= con->entries));
-	error_condition((range_index < 0) || (range_index >= con->range_entries[index]));
-	return (&con->rng_sec[index][range_index]);
+	error_condition((range_index < 0) || (range_index >= con->ent[index].range_entries));
+	return (&con->ent[index].rng_sec[range_index]);
 	}
 /******************************************************** Karsten Scheibler */
@@ -36,6 +36,9 @@
 
 #define CONTAINER_NR_ENTRIES		(GLOBAL_NR_RETRIES + 1) * (GLOBAL_NR_IMAGES - 1)
 #define CONTAINER_NR_RANGES		(4 * GLOBAL_NR_SECTORS)
+#define CONTAINER_INIT_ENTRIES		16
+#define CONTAINER_INIT_RANGES		32
+#define CONTAINER_BLOCK_SIZE		(8 * GLOBAL_MAX_TRACK_SIZE)
 
 struct container_lookup
 	{
@@ -43,26 +46,49 @@ struct container_lookup
 	cw_count_t			length_sum:24;
 	};
 
+/*
+ * data, error, votes and lookup of all entries are taken from a list of
+ * blocks, container_reset() only rewinds them, so the memory is reused
+ * for the next track
+ */
+
+struct container_block
+	{
+	struct container_block		*next;
+	cw_raw8_t			*data;
+	cw_size_t			size;
+	cw_size_t			used;
+	};
+
+struct container_entry
+	{
+	cw_raw8_t			*data;
+	cw_raw8_t			*error;
+	cw_raw8_t			*votes;
+	struct container_lookup		*lkp;
+	cw_size_t			size;
+	cw_size_t			limit;
+	struct range_sector		*rng_sec;
+	cw_count_t			range_entries;
+	cw_count_t			range_limit;
+	};
+
 #define CONTAINER_FLAG_NONE		0
 #define CONTAINER_FLAG_INITIALIZED	(1 << 0)
 #define CONTAINER_FLAG_MALLOC		(1 << 1)
 
 struct container
 	{
-	cw_raw8_t			*data[CONTAINER_NR_ENTRIES];
-	cw_raw8_t			*error[CONTAINER_NR_ENTRIES];
-	struct container_lookup		*lkp[CONTAINER_NR_ENTRIES];
-	cw_size_t			size[CONTAINER_NR_ENTRIES];
-	cw_size_t			limit[CONTAINER_NR_ENTRIES];
+	struct container_entry		*ent;
 	cw_count_t			entries;
-	struct range_sector		rng_sec[CONTAINER_NR_ENTRIES][CONTAINER_NR_RANGES];
-	cw_count_t			range_entries[CONTAINER_NR_ENTRIES];
+	cw_count_t			entries_limit;
+	struct container_block		*blk;
+	struct container_block		*blk_current;
 	cw_flag_t			flags;
 	};
 
 
 
-
 /****************************************************************************
  *
  * global functions
@@ -80,6 +106,10 @@ extern cw_void_t
 container_deinit(
 	struct container		*con);
 
+extern cw_void_t
+container_reset(
+	struct container		*con);
+
 extern cw_index_t
 container_store_data_and_error(
 	struct container		*con,
@@ -101,6 +131,11 @@ container_get_error(
 	struct container		*con,
 	cw_index_t			index);
 
+extern cw_raw8_t *
+container_get_votes(
+	struct container		*con,
+	cw_index_t			index);
+
 extern struct container_lookup *
 container_get_lookup(
 	struct container		*con,
@@ -4,6 +4,15 @@
  * format/crc16.c
  *
  ****************************************************************************
+ *
+ * crc-ccitt as used by the nec765 and tbe formats. format_crc16() takes the
+ * crc of the preceding bytes as initval and returns the crc with the given
+ * bytes appended, so a crc may be extended piece by piece. the bytes are
+ * processed with slicing-by-8 tables, which are calculated and checked
+ * against the nibble wise reference implementation on first use. if this
+ * self test fails, the reference implementation is used instead
+ *
+ ****************************************************************************
  ****************************************************************************/
 
 
@@ -11,6 +20,7 @@
 
 
 #include <stdio.h>
+#include <pthread.h>
 
 #include "crc16.h"
 #include "../error.h"
@@ -21,11 +31,41 @@
 
 
 
+
 /****************************************************************************
- * format_crc16
+ *
+ * data structures and defines
+ *
  ****************************************************************************/
-int
-format_crc16(
+
+
+
+
+#define CRC16_POLYNOMIAL		0x1021
+#define CRC16_SLICES			8
+#define CRC16_TEST_SIZE			0x100
+
+static unsigned short			crc16_table[CRC16_SLICES][0x100];
+static pthread_once_t			crc16_once = PTHREAD_ONCE_INIT;
+static int				(*crc16_func)(int, const unsigned char *, int);
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * crc16_nibble
+ ****************************************************************************/
+static int
+crc16_nibble(
 	int				initval,
 	const unsigned char		*data,
 	int				size)
@@ -44,10 +84,103 @@ format_crc16(
 		{
 		byte    = *data++;
 		table   = lookup[((byte >> 4) ^ (initval >> 12)) & 0x0f];
-		initval = (initval << 4) ^ table;
+		initval = ((initval << 4) ^ table) & 0xffff;
 		table   = lookup[(byte ^ (initval >> 12)) & 0x0f];
-		initval = (initval << 4) ^ table;
+		initval = ((initval << 4) ^ table) & 0xffff;
 		}
 	return (initval & 0xffff);
 	}
+
+
+
+/****************************************************************************
+ * crc16_slice8
+ ****************************************************************************/
+static int
+crc16_slice8(
+	int				initval,
+	const unsigned char		*data,
+	int				size)
+
+	{
+	unsigned short			(*t)[0x100] = crc16_table;
+	unsigned int			crc = initval & 0xffff;
+
+	/*
+	 * crc16_table[k][i] is the crc of byte i followed by k zero bytes,
+	 * so 8 bytes need 8 independent lookups instead of 16 dependent ones
+	 */
+
+	for ( ; size >= CRC16_SLICES; size -= CRC16_SLICES, data += CRC16_SLICES) crc =
+		t[7][data[0] ^ (crc >> 8)] ^ t[6][data[1] ^ (crc & 0xff)] ^
+		t[5][data[2]] ^ t[4][data[3]] ^ t[3][data[4]] ^
+		t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+	while (size-- > 0) crc = ((crc << 8) & 0xff00) ^ t[0][*data++ ^ (crc >> 8)];
+	return (crc & 0xffff);
+	}
+
+
+
+/****************************************************************************
+ * crc16_init
+ ****************************************************************************/
+static void
+crc16_init(
+	void)
+
+	{
+	unsigned char			data[CRC16_TEST_SIZE];
+	unsigned int			seed;
+	int				crc, i, j, errors = 0;
+
+	for (i = 0; i < 0x100; i++)
+		{
+		for (crc = i << 8, j = 0; j < 8; j++) crc = (crc << 1) ^ ((crc & 0x8000) ? CRC16_POLYNOMIAL : 0);
+		crc16_table[0][i] = crc;
+		}
+	for (i = 1; i < CRC16_SLICES; i++) for (j = 0; j < 0x100; j++) crc16_table[i][j] = (crc16_table[i - 1][j] << 8) ^ crc16_table[0][crc16_table[i - 1][j] >> 8];
+
+	/*
+	 * self test, the tables have to give exactly the same results as the
+	 * reference implementation for all sizes and alignments
+	 */
+
+	for (seed = 0x1d0f, i = 0; i < CRC16_TEST_SIZE; i++) seed = seed * 0x41c64e6d + 0x3039, data[i] = seed >> 16;
+	for (i = 0; i < CRC16_SLICES; i++) for (j = 0; i + j <= CRC16_TEST_SIZE; j++)
+		{
+		crc = ((i * CRC16_TEST_SIZE + j) * 0x9e37) & 0xffff;
+		if (crc16_slice8(crc, &data[i], j) != crc16_nibble(crc, &data[i], j)) errors++;
+		}
+	if (crc16_slice8(0xffff, (const unsigned char *) "123456789", 9) != 0x29b1) errors++;
+	crc16_func = crc16_slice8;
+	if (errors == 0) return;
+	verbose_message(GENERIC, 1, "crc16 self test failed %d times, using nibble wise lookups", errors);
+	crc16_func = crc16_nibble;
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * format_crc16
+ ****************************************************************************/
+int
+format_crc16(
+	int				initval,
+	const unsigned char		*data,
+	int				size)
+
+	{
+	pthread_once(&crc16_once, crc16_init);
+	return (crc16_func(initval, data, size));
+	}
 /******************************************************** Karsten Scheibler */
@@ -20,6 +20,7 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
 #include "fm.h"
 #include "range.h"
@@ -326,12 +327,13 @@ fm_nec765_read_track2(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_l1 = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 
 	if (fmt->fm_nec.rd.flags & FLAG_RD_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->fm_nec.rw.bnd, 2);
 	bitstream_read(ffo_l0, &ffo_l1, fmt->fm_nec.rw.bnd, 2);
 	while (fm_nec765_read_sector(&ffo_l1, &fmt->fm_nec, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	scratch_put(data);
 	}
 
 
@@ -0,0 +1,392 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * format/gcr.c
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+
+#include "gcr.h"
+#include "../error.h"
+#include "../debug.h"
+#include "../verbose.h"
+#include "../global.h"
+#include "../disk.h"
+#include "../fifo.h"
+
+
+
+/****************************************************************************
+ * gcr_decode_table
+ ****************************************************************************/
+const int				gcr_decode_table[0x400] =
+	{
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x088, 0x080, 0x081, 0x1ff, 0x08c, 0x084, 0x085,
+	0x1ff, 0x1ff, 0x082, 0x083, 0x1ff, 0x08f, 0x086, 0x087,
+	0x1ff, 0x089, 0x08a, 0x08b, 0x1ff, 0x08d, 0x08e, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x008, 0x000, 0x001, 0x1ff, 0x00c, 0x004, 0x005,
+	0x1ff, 0x1ff, 0x002, 0x003, 0x1ff, 0x00f, 0x006, 0x007,
+	0x1ff, 0x009, 0x00a, 0x00b, 0x1ff, 0x00d, 0x00e, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x018, 0x010, 0x011, 0x1ff, 0x01c, 0x014, 0x015,
+	0x1ff, 0x1ff, 0x012, 0x013, 0x1ff, 0x01f, 0x016, 0x017,
+	0x1ff, 0x019, 0x01a, 0x01b, 0x1ff, 0x01d, 0x01e, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x0c8, 0x0c0, 0x0c1, 0x1ff, 0x0cc, 0x0c4, 0x0c5,
+	0x1ff, 0x1ff, 0x0c2, 0x0c3, 0x1ff, 0x0cf, 0x0c6, 0x0c7,
+	0x1ff, 0x0c9, 0x0ca, 0x0cb, 0x1ff, 0x0cd, 0x0ce, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x048, 0x040, 0x041, 0x1ff, 0x04c, 0x044, 0x045,
+	0x1ff, 0x1ff, 0x042, 0x043, 0x1ff, 0x04f, 0x046, 0x047,
+	0x1ff, 0x049, 0x04a, 0x04b, 0x1ff, 0x04d, 0x04e, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x058, 0x050, 0x051, 0x1ff, 0x05c, 0x054, 0x055,
+	0x1ff, 0x1ff, 0x052, 0x053, 0x1ff, 0x05f, 0x056, 0x057,
+	0x1ff, 0x059, 0x05a, 0x05b, 0x1ff, 0x05d, 0x05e, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x028, 0x020, 0x021, 0x1ff, 0x02c, 0x024, 0x025,
+	0x1ff, 0x1ff, 0x022, 0x023, 0x1ff, 0x02f, 0x026, 0x027,
+	0x1ff, 0x029, 0x02a, 0x02b, 0x1ff, 0x02d, 0x02e, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x038, 0x030, 0x031, 0x1ff, 0x03c, 0x034, 0x035,
+	0x1ff, 0x1ff, 0x032, 0x033, 0x1ff, 0x03f, 0x036, 0x037,
+	0x1ff, 0x039, 0x03a, 0x03b, 0x1ff, 0x03d, 0x03e, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x0f8, 0x0f0, 0x0f1, 0x1ff, 0x0fc, 0x0f4, 0x0f5,
+	0x1ff, 0x1ff, 0x0f2, 0x0f3, 0x1ff, 0x0ff, 0x0f6, 0x0f7,
+	0x1ff, 0x0f9, 0x0fa, 0x0fb, 0x1ff, 0x0fd, 0x0fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x068, 0x060, 0x061, 0x1ff, 0x06c, 0x064, 0x065,
+	0x1ff, 0x1ff, 0x062, 0x063, 0x1ff, 0x06f, 0x066, 0x067,
+	0x1ff, 0x069, 0x06a, 0x06b, 0x1ff, 0x06d, 0x06e, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x078, 0x070, 0x071, 0x1ff, 0x07c, 0x074, 0x075,
+	0x1ff, 0x1ff, 0x072, 0x073, 0x1ff, 0x07f, 0x076, 0x077,
+	0x1ff, 0x079, 0x07a, 0x07b, 0x1ff, 0x07d, 0x07e, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x098, 0x090, 0x091, 0x1ff, 0x09c, 0x094, 0x095,
+	0x1ff, 0x1ff, 0x092, 0x093, 0x1ff, 0x09f, 0x096, 0x097,
+	0x1ff, 0x099, 0x09a, 0x09b, 0x1ff, 0x09d, 0x09e, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x0a8, 0x0a0, 0x0a1, 0x1ff, 0x0ac, 0x0a4, 0x0a5,
+	0x1ff, 0x1ff, 0x0a2, 0x0a3, 0x1ff, 0x0af, 0x0a6, 0x0a7,
+	0x1ff, 0x0a9, 0x0aa, 0x0ab, 0x1ff, 0x0ad, 0x0ae, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x0b8, 0x0b0, 0x0b1, 0x1ff, 0x0bc, 0x0b4, 0x0b5,
+	0x1ff, 0x1ff, 0x0b2, 0x0b3, 0x1ff, 0x0bf, 0x0b6, 0x0b7,
+	0x1ff, 0x0b9, 0x0ba, 0x0bb, 0x1ff, 0x0bd, 0x0be, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x0d8, 0x0d0, 0x0d1, 0x1ff, 0x0dc, 0x0d4, 0x0d5,
+	0x1ff, 0x1ff, 0x0d2, 0x0d3, 0x1ff, 0x0df, 0x0d6, 0x0d7,
+	0x1ff, 0x0d9, 0x0da, 0x0db, 0x1ff, 0x0dd, 0x0de, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x0e8, 0x0e0, 0x0e1, 0x1ff, 0x0ec, 0x0e4, 0x0e5,
+	0x1ff, 0x1ff, 0x0e2, 0x0e3, 0x1ff, 0x0ef, 0x0e6, 0x0e7,
+	0x1ff, 0x0e9, 0x0ea, 0x0eb, 0x1ff, 0x0ed, 0x0ee, 0x1ff,
+	0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff, 0x1ff,
+	0x1ff, 0x1f8, 0x1f0, 0x1f1, 0x1ff, 0x1fc, 0x1f4, 0x1f5,
+	0x1ff, 0x1ff, 0x1f2, 0x1f3, 0x1ff, 0x1ff, 0x1f6, 0x1f7,
+	0x1ff, 0x1f9, 0x1fa, 0x1fb, 0x1ff, 0x1fd, 0x1fe, 0x1ff
+	};
+
+
+
+/****************************************************************************
+ * gcr_nibble_decode_table
+ ****************************************************************************/
+static const unsigned char		gcr_nibble_decode_table[0x100 - 0x96] =
+	{
+	0x00, 0x01, 0xff, 0xff, 0x02, 0x03, 0xff, 0x04,
+	0x05, 0x06, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0x07, 0x08, 0xff, 0xff, 0xff, 0x09, 0x0a, 0x0b,
+	0x0c, 0x0d, 0xff, 0xff, 0x0e, 0x0f, 0x10, 0x11,
+	0x12, 0x13, 0xff, 0x14, 0x15, 0x16, 0x17, 0x18,
+	0x19, 0x1a, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0x1b, 0xff, 0x1c,
+	0x1d, 0x1e, 0xff, 0xff, 0xff, 0x1f, 0xff, 0xff,
+	0x20, 0x21, 0xff, 0x22, 0x23, 0x24, 0x25, 0x26,
+	0x27, 0x28, 0xff, 0xff, 0xff, 0xff, 0xff, 0x29,
+	0x2a, 0x2b, 0xff, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+	0x31, 0x32, 0xff, 0xff, 0x33, 0x34, 0x35, 0x36,
+	0x37, 0x38, 0xff, 0x39, 0x3a, 0x3b, 0x3c, 0x3d,
+	0x3e, 0x3f
+	};
+
+
+
+/****************************************************************************
+ * gcr_skip_nibble_bit
+ ****************************************************************************/
+static void
+gcr_skip_nibble_bit(
+	int				bitofs,
+	int				ofs,
+	void				(*error_func)(void *, int),
+	void				*error_data)
+
+	{
+	verbose_message(GENERIC, 3, "need to read additional bit around bit offset %d (byte %d), because msb is 0", bitofs, ofs);
+	if (error_func != NULL) error_func(error_data, bitofs);
+	}
+
+
+
+/****************************************************************************
+ * gcr_decode_nibble
+ ****************************************************************************/
+static int
+gcr_decode_nibble(
+	struct disk_error		*dsk_err,
+	int				val,
+	int				bitofs,
+	int				ofs,
+	void				(*error_func)(void *, int),
+	void				*error_data)
+
+	{
+	int				j = 0xff;
+
+	if (val >= 0x96) j = gcr_nibble_decode_table[val - 0x96];
+	if (j == 0xff)
+		{
+		verbose_message(GENERIC, 3, "data decode error around bit offset %d (byte %d), got 0x%02x(0x%02x)", bitofs, ofs, val, j);
+		if (error_func != NULL) error_func(error_data, bitofs);
+		disk_error_add(dsk_err, DISK_ERROR_FLAG_ENCODING, 1);
+		}
+	return (j);
+	}
+
+
+
+/****************************************************************************
+ * gcr_decode_group
+ ****************************************************************************/
+int
+gcr_decode_group(
+	cw_u64_t			group,
+	unsigned char			*data,
+	int				size)
+
+	{
+	int				bad, i, val;
+
+	/*
+	 * decodes size (at most GCR_GROUP_BYTES) bytes from the upper bits
+	 * of group, bit i of the result is set if byte i contains an
+	 * invalid gcr code
+	 */
+
+	debug_error_condition((size < 0) || (size > GCR_GROUP_BYTES));
+	for (bad = i = 0; i < size; i++, group <<= 10)
+		{
+		val     = gcr_decode_table[group >> 54];
+		data[i] = val;
+		bad    |= (val >> 8) << i;
+		}
+	return (bad);
+	}
+
+
+
+/****************************************************************************
+ * gcr_read_bytes
+ ****************************************************************************/
+int
+gcr_read_bytes(
+	struct fifo			*ffo_l1,
+	struct disk_error		*dsk_err,
+	unsigned char			*data,
+	int				size)
+
+	{
+	int				bitofs = fifo_get_rd_bitofs(ffo_l1);
+	cw_u64_t			group;
+	int				bad, b, i = 0, j, n1, n2;
+
+	/*
+	 * decode GCR_GROUP_BYTES at once, near the end of data the byte
+	 * wise reads below decide how much can be read and where the fifo
+	 * stops
+	 */
+
+	if ((size > 0) && (bitofs + 10 * size < fifo_get_wr_bitofs(ffo_l1)))
+		{
+		for ( ; i < size; i += b)
+			{
+			b     = (size - i < GCR_GROUP_BYTES) ? size - i : GCR_GROUP_BYTES;
+			group = fifo_peek_bits64(ffo_l1, bitofs + 10 * i);
+			bad   = gcr_decode_group(group, &data[i], b);
+			for (j = 0; bad != 0; j++, bad >>= 1)
+				{
+				if ((bad & 1) == 0) continue;
+				n1 = (group >> (59 - 10 * j)) & 0x1f;
+				n2 = (group >> (54 - 10 * j)) & 0x1f;
+				verbose_message(GENERIC, 3, "gcr decode error around bit offset %d (byte %d), got nybbles 0x%02x 0x%02x", bitofs + 10 * (i + j), i + j, n1, n2);
+				disk_error_add(dsk_err, DISK_ERROR_FLAG_ENCODING, 1);
+				}
+			}
+
+		/*
+		 * read the last 5 bits again through the fifo, this leaves it
+		 * in exactly the same state as the byte wise reads would do
+		 */
+
+		fifo_set_rd_bitofs(ffo_l1, bitofs + 10 * size - 5);
+		fifo_read_bits(ffo_l1, 5);
+		}
+	for ( ; i < size; i++)
+		{
+		n1 = fifo_read_bits(ffo_l1, 5);
+		if (n1 == -1) return (-1);
+		n2 = fifo_read_bits(ffo_l1, 5);
+		if (n2 == -1) return (-1);
+		if (gcr_decode_table[(n1 << 5) | n2] & 0x100)
+			{
+			verbose_message(GENERIC, 3, "gcr decode error around bit offset %d (byte %d), got nybbles 0x%02x 0x%02x", fifo_get_rd_bitofs(ffo_l1) - 10, i, n1, n2);
+			disk_error_add(dsk_err, DISK_ERROR_FLAG_ENCODING, 1);
+			}
+		data[i] = gcr_decode_table[(n1 << 5) | n2];
+		}
+	verbose_message(GENERIC, 2, "read %d bytes at bit offset %d", i, bitofs);
+	return (0);
+	}
+
+
+
+/****************************************************************************
+ * gcr_read_nibbles
+ ****************************************************************************/
+int
+gcr_read_nibbles(
+	struct fifo			*ffo_l1,
+	struct disk_error		*dsk_err,
+	unsigned char			*data,
+	int				size,
+	void				(*error_func)(void *, int),
+	void				*error_data)
+
+	{
+	int				bitofs = fifo_get_rd_bitofs(ffo_l1);
+	int				limit  = fifo_get_wr_bitofs(ffo_l1) - 64;
+	int				b, i, r, pos, wpos, last = 8;
+	cw_u64_t			word, val;
+
+	/*
+	 * decodes 6-and-2 nibbles, a nibble starts with the first 1 bit,
+	 * leading 0 bits are skipped. the nibbles are taken out of a 64 bit
+	 * word as long as enough data is left and the 0 bits before a
+	 * nibble fit into a word. error_func is called with the bit offset
+	 * of each skipped bit and each decode error, if it is not NULL
+	 */
+
+	for (i = 0, pos = wpos = bitofs, word = fifo_peek_bits64(ffo_l1, pos); (i < size) && (pos < limit); i++)
+		{
+		if (pos - wpos > 56) word = fifo_peek_bits64(ffo_l1, wpos = pos);
+		val = word << (pos - wpos);
+		if ((val >> 63) == 0)
+			{
+			word = val = fifo_peek_bits64(ffo_l1, wpos = pos);
+			for (b = 0; (b < 56) && ((val >> 63) == 0); b++) val <<= 1;
+			if (b == 56) break;
+			for (last = 1; b > 0; b--) gcr_skip_nibble_bit(pos++, i, error_func, error_data);
+			}
+		else last = 8;
+		data[i] = gcr_decode_nibble(dsk_err, val >> 56, pos, i, error_func, error_data);
+		pos += 8;
+		}
+
+	/*
+	 * read the last bits again through the fifo, this leaves it in
+	 * exactly the same state as the bit wise reads would do. long runs
+	 * of 0 bits and the end of data are handled bit wise
+	 */
+
+	if (pos > bitofs)
+		{
+		fifo_set_rd_bitofs(ffo_l1, pos - last);
+		fifo_read_bits(ffo_l1, last);
+		}
+	for ( ; i < size; i++)
+		{
+		r = fifo_read_bits(ffo_l1, 8);
+		if (r == -1) return (-1);
+		for ( ; r < 0x80; r = ((r << 1) | b) & 0xff)
+			{
+			gcr_skip_nibble_bit(fifo_get_rd_bitofs(ffo_l1) - 8, i, error_func, error_data);
+			b = fifo_read_bits(ffo_l1, 1);
+			if (b == -1) return (-1);
+			}
+		data[i] = gcr_decode_nibble(dsk_err, r, fifo_get_rd_bitofs(ffo_l1) - 8, i, error_func, error_data);
+		}
+	verbose_message(GENERIC, 2, "read %d data bytes at bit offset %d", i, bitofs);
+	return (0);
+	}
+/******************************************************** Karsten Scheibler */
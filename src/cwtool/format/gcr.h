@@ -13,9 +13,27 @@
 #ifndef CWTOOL_FORMAT_GCR_H
 #define CWTOOL_FORMAT_GCR_H
 
+#include "types.h"
 #include "../import.h"
 #include "../export.h"
 
+/*
+ * gcr_read_bytes() decodes commodore style gcr, gcr_read_nibbles() apple
+ * 6-and-2 nibbles. a group of GCR_GROUP_BYTES bytes is 40 bits of commodore style gcr, each
+ * nybble is encoded in 5 bits. gcr_decode_table maps 10 bits to the
+ * decoded byte, 0x100 is set if one of the nybbles is invalid
+ */
+
+#define GCR_GROUP_BYTES			4
+
+struct fifo;
+struct disk_error;
+
+extern const int			gcr_decode_table[];
+extern int				gcr_decode_group(cw_u64_t, unsigned char *, int);
+extern int				gcr_read_bytes(struct fifo *, struct disk_error *, unsigned char *, int);
+extern int				gcr_read_nibbles(struct fifo *, struct disk_error *, unsigned char *, int, void (*)(void *, int), void *);
+
 #define gcr_read_u16_le(data)		import_u16_le(data)
 #define gcr_write_u16_le(data, val)	export_u16_le(data, val)
 
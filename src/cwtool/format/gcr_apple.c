@@ -29,8 +29,11 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
+#include "gcr.h"
 #include "range.h"
+#include "sync.h"
 #include "bitstream.h"
 #include "container.h"
 #include "match_simple.h"
@@ -60,22 +63,9 @@ gcr_read_sync(
 	int				val)
 
 	{
-	int				i, bits;
-	int				reg = fifo_read_bits(ffo_l1, 15);
-
-	if (reg == -1) return (-1);
-	bits = fifo_read_bits(ffo_l1, 8);
-	if (bits == -1) return (-1);
-	bits = reg = (reg << 8) | bits;
-	while (1)
-		{
-		bits = fifo_read_bits(ffo_l1, 8);
-		if (bits == -1) return (-1);
-		bits = reg = (reg << 8) | bits;
-		for (i = 0; i < 8; i++, bits >>= 1) if ((bits & 0xffffff) == val) goto found;
-		}
-found:
-	fifo_set_rd_bitofs(ffo_l1, fifo_get_rd_bitofs(ffo_l1) - i);
+	struct sync			syn = SYNC_INIT(24, 8, val, val);
+
+	if (sync_read(ffo_l1, &syn) == -1) return (-1);
 	verbose_message(GENERIC, 2, "got sync at bit offset %d with value 0x%06x", fifo_get_rd_bitofs(ffo_l1) - 24, val);
 	range_set_start(rng, fifo_get_rd_bitofs(ffo_l1) - 24);
 	return (1);
@@ -210,48 +200,7 @@ gcr_read_data_bytes(
 	int				size)
 
 	{
-	const static unsigned char	decode[0x100 - 0x96] =
-		{
-		0x00, 0x01, 0xff, 0xff, 0x02, 0x03, 0xff, 0x04,
-		0x05, 0x06, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-		0x07, 0x08, 0xff, 0xff, 0xff, 0x09, 0x0a, 0x0b,
-		0x0c, 0x0d, 0xff, 0xff, 0x0e, 0x0f, 0x10, 0x11,
-		0x12, 0x13, 0xff, 0x14, 0x15, 0x16, 0x17, 0x18,
-		0x19, 0x1a, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-		0xff, 0xff, 0xff, 0xff, 0xff, 0x1b, 0xff, 0x1c,
-		0x1d, 0x1e, 0xff, 0xff, 0xff, 0x1f, 0xff, 0xff,
-		0x20, 0x21, 0xff, 0x22, 0x23, 0x24, 0x25, 0x26,
-		0x27, 0x28, 0xff, 0xff, 0xff, 0xff, 0xff, 0x29,
-		0x2a, 0x2b, 0xff, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
-		0x31, 0x32, 0xff, 0xff, 0x33, 0x34, 0x35, 0x36,
-		0x37, 0x38, 0xff, 0x39, 0x3a, 0x3b, 0x3c, 0x3d,
-		0x3e, 0x3f
-		};
-	int				b, i, j, r;
-	int				bitofs = fifo_get_rd_bitofs(ffo_l1);
-
-	for (i = 0; i < size; i++)
-		{
-		r = fifo_read_bits(ffo_l1, 8);
-		if (r == -1) return (-1);
-		while (r < 0x80)
-			{
-			verbose_message(GENERIC, 3, "need to read additional bit around bit offset %d (byte %d), because msb is 0", fifo_get_rd_bitofs(ffo_l1) - 8, i);
-			b = fifo_read_bits(ffo_l1, 1);
-			if (b == -1) return (-1);
-			r = ((r << 1) | b) & 0xff;
-			}
-		if (r < 0x96) j = 0xff;
-		else j = decode[r - 0x96];
-		if (j == 0xff)
-			{
-			verbose_message(GENERIC, 3, "data decode error around bit offset %d (byte %d), got 0x%02x(0x%02x)", fifo_get_rd_bitofs(ffo_l1) - 8, i, r, j);
-			disk_error_add(dsk_err, DISK_ERROR_FLAG_ENCODING, 1);
-			}
-		data[i] = j;
-		}
-	verbose_message(GENERIC, 2, "read %d data bytes at bit offset %d", i, bitofs);
-	return (0);
+	return (gcr_read_nibbles(ffo_l1, dsk_err, data, size, NULL, NULL));
 	}
 
 
@@ -803,12 +752,13 @@ gcr_apple_read_track2(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_l1 = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 
 	if (fmt->gcr_apl.rd.flags & FLAG_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->gcr_apl.rw.bnd, 3);
 	bitstream_read(ffo_l0, &ffo_l1, fmt->gcr_apl.rw.bnd, 3);
 	while (gcr_apple_read_sector(&ffo_l1, &fmt->gcr_apl, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	scratch_put(data);
 	}
 
 
@@ -20,12 +20,15 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
+#include "gcr.h"
 #include "container.h"
 #include "bitstream.h"
 #include "postcomp_simple.h"
 #include "histogram.h"
 #include "setvalue.h"
+#include "sync.h"
 
 
 
@@ -48,29 +51,9 @@ gcr_read_sync(
 	int				size)
 
 	{
-	int				i, j, reg;
+	int				i = sync_read_ones(ffo_l1, size);
 
-	for (i = 0; ; )
-		{
-		reg = fifo_read_bits(ffo_l1, 16);
-		if (reg == -1) return (-1);
-		i += 16;
-		if (reg == 0xffff) continue;
-		for (i -= 16, j = 16; j > 0; i++, j--, reg <<= 1)
-			{
-			if (reg & 0x8000) continue;
-
-			/*
-			 * the check above with 0xffff guarants that, this
-			 * check is executed at least once
-			 */
-
-			if (i >= size) goto found;
-			i = -1;
-			}
-		}
-found:
-	fifo_set_rd_bitofs(ffo_l1, fifo_get_rd_bitofs(ffo_l1) - j);
+	if (i == -1) return (-1);
 	verbose_message(GENERIC, 2, "got sync at bit offset %d with %d bits", fifo_get_rd_bitofs(ffo_l1) - i, i);
 	return (i);
 	}
@@ -170,15 +153,22 @@ gcr_g64_get_pattern(
 	struct fifo			*ffo)
 
 	{
-	unsigned int			pattern;
-	int				val;
-
-	val = fifo_read_bits(ffo, 16);
-	if (val == -1) return (0);
-	pattern = val << 16;
-	val = fifo_read_bits(ffo, 16);
-	if (val == -1) return (0);
-	return (pattern | val);
+	unsigned char			header[GCR_GROUP_BYTES];
+	int				bitofs = fifo_get_rd_bitofs(ffo);
+	cw_u64_t			group;
+
+	/*
+	 * the raw header id was just read, together with the following 32
+	 * bits it forms the gcr group with header id, checksum, sector and
+	 * track. the pattern are the raw bits after the header id
+	 */
+
+	if ((bitofs < 8) || (bitofs + 32 >= fifo_get_wr_bitofs(ffo))) return (0);
+	group = fifo_peek_bits64(ffo, bitofs - 8);
+	if (gcr_decode_group(group, header, GCR_GROUP_BYTES) == 0) verbose_message(GENERIC, 3, "found header of sector %d on track %d", header[2], header[3]);
+	fifo_set_rd_bitofs(ffo, bitofs + 16);
+	fifo_read_bits(ffo, 16);
+	return ((group >> 24) & 0xffffffff);
 	}
 
 
@@ -286,11 +276,11 @@ gcr_g64_align_track(
 	struct gcr_g64			*gcr_g64)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_tmp = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data;
+	struct fifo			ffo_tmp;
 	int				size[MAX_SYNCS];
 	int				end[MAX_SYNCS];
-	int				i, j, l, s;
+	int				i, j, l, s, r = -1;
 
 	/* check if track is already aligned */
 
@@ -309,20 +299,24 @@ gcr_g64_align_track(
 	/* align syncs so that bytes after it start on byte boundaries */
 
 	verbose_message(GENERIC, 3, "starting track alignment");
+	data    = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	ffo_tmp = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 	fifo_copy_block(ffo, &ffo_tmp, fifo_get_wr_ofs(ffo));
 	fifo_reset(ffo);
 	for (i = 1, j = 0; i < s; i++)
 		{
 		l = gcr_g64_align_bits(ffo, j + end[i - 1]);
-		if (l == -1) return (-1);
+		if (l == -1) goto done;
 		j += l;
 		l = (end[i] - size[i]) - (end[i - 1] - size[i - 1]);
 		verbose_message(GENERIC, 3, "copying %d bits", l);
 		fifo_copy_bitblock(&ffo_tmp, ffo, l);
 		}
-	if (gcr_g64_align_bits(ffo, fifo_get_wr_bitofs(ffo)) == -1) return (-1);
-
-	return (0);
+	if (gcr_g64_align_bits(ffo, fifo_get_wr_bitofs(ffo)) == -1) goto done;
+	r = 0;
+done:
+	scratch_put(data);
+	return (r);
 	}
 
 
@@ -364,11 +358,12 @@ gcr_g64_read_track(
 
 	{
 	int				length[4]   = { 6250, 6667, 7143, 7692 };
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1_tmp  = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data       = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_l1_tmp  = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 	int				pad_length2 = fmt->gcr_g64.rd.pad_length2;
 	int				limit       = fifo_get_limit(ffo_l1) - fmt->gcr_g64.rd.pad_length1 - pad_length2;
 	int				speed       = fmt->gcr_g64.rd.speed;
+	int				r           = 0;
 
 	/*
 	 * to ensure that we have no more than two consecutive zeros,
@@ -378,9 +373,9 @@ gcr_g64_read_track(
 	debug_error_condition((speed < 0) || (speed > 3));
 	if (fmt->gcr_g64.rd.flags & FLAG_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->gcr_g64.rw.bnd[speed], 3);
 	bitstream_read(ffo_l0, &ffo_l1_tmp, fmt->gcr_g64.rw.bnd[speed], 3);
-	if (gcr_write_fill(ffo_l1, fmt->gcr_g64.rd.pad_value1, fmt->gcr_g64.rd.pad_length1) == -1) return (0);
-	if (fmt->gcr_g64.rd.flags & FLAG_STRIP_TRACK) if (gcr_g64_strip_track(&ffo_l1_tmp, &fmt->gcr_g64, ffo_l1, limit) == -1) return (0);
-	if (fmt->gcr_g64.rd.flags & FLAG_ALIGN_TRACK) if (gcr_g64_align_track(ffo_l1, &fmt->gcr_g64) == -1) return (0);
+	if (gcr_write_fill(ffo_l1, fmt->gcr_g64.rd.pad_value1, fmt->gcr_g64.rd.pad_length1) == -1) goto done;
+	if (fmt->gcr_g64.rd.flags & FLAG_STRIP_TRACK) if (gcr_g64_strip_track(&ffo_l1_tmp, &fmt->gcr_g64, ffo_l1, limit) == -1) goto done;
+	if (fmt->gcr_g64.rd.flags & FLAG_ALIGN_TRACK) if (gcr_g64_align_track(ffo_l1, &fmt->gcr_g64) == -1) goto done;
 
 	/*
 	 * if pad_length2 is zero, we try to fill up the track to a standard
@@ -388,10 +383,13 @@ gcr_g64_read_track(
 	 */
 
 	if (pad_length2 == 0) pad_length2 = length[speed] - fifo_get_wr_ofs(ffo_l1);
-	if (pad_length2 > 0) if (gcr_write_fill(ffo_l1, fmt->gcr_g64.rd.pad_value2, pad_length2) == -1) return (0);
+	if (pad_length2 > 0) if (gcr_write_fill(ffo_l1, fmt->gcr_g64.rd.pad_value2, pad_length2) == -1) goto done;
 	fifo_write_flush(ffo_l1);
 	fifo_set_speed(ffo_l1, speed);
-	return (1);
+	r = 1;
+done:
+	scratch_put(data);
+	return (r);
 	}
 
 
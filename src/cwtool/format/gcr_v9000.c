@@ -20,9 +20,11 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
 #include "gcr.h"
 #include "range.h"
+#include "sync.h"
 #include "bitstream.h"
 #include "container.h"
 #include "match_simple.h"
@@ -52,29 +54,9 @@ gcr_read_sync(
 	int				size)
 
 	{
-	int				i, j, reg;
+	int				i = sync_read_ones(ffo_l1, size);
 
-	for (i = 0; ; )
-		{
-		reg = fifo_read_bits(ffo_l1, 16);
-		if (reg == -1) return (-1);
-		i += 16;
-		if (reg == 0xffff) continue;
-		for (i -= 16, j = 16; j > 0; i++, j--, reg <<= 1)
-			{
-			if (reg & 0x8000) continue;
-
-			/*
-			 * the check above with 0xffff guarants that, this
-			 * check is executed at least once
-			 */
-
-			if (i >= size) goto found;
-			i = -1;
-			}
-		}
-found:
-	fifo_set_rd_bitofs(ffo_l1, fifo_get_rd_bitofs(ffo_l1) - j);
+	if (i == -1) return (-1);
 	verbose_message(GENERIC, 2, "got sync at bit offset %d with %d bits", fifo_get_rd_bitofs(ffo_l1) - i, i);
 	range_set_start(rng, fifo_get_rd_bitofs(ffo_l1) - i);
 	return (i);
@@ -122,46 +104,6 @@ gcr_write_fill(
 
 
 
-/****************************************************************************
- * gcr_read_bytes
- ****************************************************************************/
-static int
-gcr_read_bytes(
-	struct fifo			*ffo_l1,
-	struct disk_error		*dsk_err,
-	unsigned char			*data,
-	int				size)
-
-	{
-	const static unsigned char	decode[32] =
-		{
-		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-		0xff, 0x08, 0x00, 0x01, 0xff, 0x0c, 0x04, 0x05,
-		0xff, 0xff, 0x02, 0x03, 0xff, 0x0f, 0x06, 0x07,
-		0xff, 0x09, 0x0a, 0x0b, 0xff, 0x0d, 0x0e, 0xff
-		};
-	int				i, n1, n2;
-	int				bitofs = fifo_get_rd_bitofs(ffo_l1);
-
-	for (i = 0; i < size; i++)
-		{
-		n1 = fifo_read_bits(ffo_l1, 5);
-		if (n1 == -1) return (-1);
-		n2 = fifo_read_bits(ffo_l1, 5);
-		if (n2 == -1) return (-1);
-		if ((decode[n1] == 0xff) || (decode[n2] == 0xff))
-			{
-			verbose_message(GENERIC, 3, "gcr decode error around bit offset %d (byte %d), got nybbles 0x%02x 0x%02x", fifo_get_rd_bitofs(ffo_l1) - 10, i, n1, n2);
-			disk_error_add(dsk_err, DISK_ERROR_FLAG_ENCODING, 1);
-			}
-		data[i] = (decode[n1] << 4) | decode[n2];
-		}
-	verbose_message(GENERIC, 2, "read %d bytes at bit offset %d", i, bitofs);
-	return (0);
-	}
-
-
-
 /****************************************************************************
  * gcr_write_bytes
  ****************************************************************************/
@@ -496,12 +438,13 @@ gcr_v9000_read_track2(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_l1 = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 
 	if (fmt->gcr_v9.rd.flags & FLAG_RD_POSTCOMP_SIMPLE) postcomp_simple_adjust(ffo_l0, fmt->gcr_v9.rw.bnd, 3, fmt->gcr_v9.rd.postcomp_simple_adjust[0], fmt->gcr_v9.rd.postcomp_simple_adjust[1]);
 	bitstream_read(ffo_l0, &ffo_l1, fmt->gcr_v9.rw.bnd, 3);
 	while (gcr_v9000_read_sector(&ffo_l1, &fmt->gcr_v9, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	scratch_put(data);
 	}
 
 
@@ -11,6 +11,7 @@
 
 
 #include <stdio.h>
+#include <string.h>
 
 #include "histogram.h"
 #include "../error.h"
@@ -20,12 +21,33 @@
 #include "../options.h"
 #include "../string.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "bounds.h"
 #include "postcomp_simple.h"
 
 
 
 
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * consecutive pulses often have the same length, incrementing the same
+ * counter again before the previous store is done stalls the cpu. so each
+ * of HISTOGRAM_NR_SUBS pulses in a row goes to its own sub histogram
+ */
+
+#define HISTOGRAM_NR_SUBS		4
+
+
+
+
 /****************************************************************************
  *
  * local functions
@@ -201,21 +223,28 @@ histogram_normal2(
 	cw_raw8_t			*data = fifo_get_data(ffo);
 	cw_size_t			size = fifo_get_wr_ofs(ffo);
 	cw_hist_t			histogram = { };
-	cw_hist2_t			histogram2 = { };
+	cw_hist_t			*histogram2;
 	cw_void_t			(*func)(cw_hist_t, cw_count_t, cw_count_t, cw_count_t, const cw_char_t *, const cw_char_t *);
 	cw_index_t			i;
 
 	func = histogram_short;
 	if (verbose_get_level(VERBOSE_CLASS_CWTOOL_S) >= VERBOSE_LEVEL_1) func = histogram_long;
-	histogram_calculate(data, size, histogram, histogram2);
+	histogram_calculate(data, size, histogram, NULL);
 	func(histogram, cwtool_track, format_track, format_side, info, NULL);
 	if (! options_get_histogram_context()) return;
+
+	/* the context histogram is only calculated if it is printed */
+
+	histogram2 = scratch_get(sizeof (cw_hist2_t));
+	memset(histogram2, 0, sizeof (cw_hist2_t));
+	histogram_calculate(data, size, NULL, histogram2);
 	for (i = 0; i < GLOBAL_NR_PULSE_LENGTHS; i++)
 		{
 		if (histogram[i] < size / 30) continue;
 		string_snprintf(info2, sizeof (info2), "prefix 0x%02x", i);
 		func(histogram2[i], cwtool_track, format_track, format_side, info, info2);
 		}
+	scratch_put(histogram2);
 	}
 
 
@@ -286,16 +315,33 @@ histogram_calculate(
 	cw_hist2_t			histogram2)
 
 	{
+	cw_count_t			sub[HISTOGRAM_NR_SUBS][GLOBAL_NR_PULSE_LENGTHS] = { };
 	cw_index_t			d1, d2, i;
 
-	if ((histogram == NULL) && (histogram2 == NULL)) return;
-	for (i = 1; i < size; i++)
+	/*
+	 * the last value is not counted, because it has no successor in
+	 * histogram2
+	 */
+
+	if (histogram2 != NULL)
+		{
+		for (i = 1; i < size; i++)
+			{
+			d1 = data[i - 1] & GLOBAL_PULSE_LENGTH_MASK;
+			d2 = data[i] & GLOBAL_PULSE_LENGTH_MASK;
+			histogram2[d1][d2]++;
+			}
+		}
+	if (histogram == NULL) return;
+	for (i = 1; i + HISTOGRAM_NR_SUBS - 1 < size; i += HISTOGRAM_NR_SUBS)
 		{
-		d1 = data[i - 1] & GLOBAL_PULSE_LENGTH_MASK;
-		d2 = data[i] & GLOBAL_PULSE_LENGTH_MASK;
-		if (histogram != NULL) histogram[d1]++;
-		if (histogram2 != NULL) histogram2[d1][d2]++;
+		sub[0][data[i - 1] & GLOBAL_PULSE_LENGTH_MASK]++;
+		sub[1][data[i]     & GLOBAL_PULSE_LENGTH_MASK]++;
+		sub[2][data[i + 1] & GLOBAL_PULSE_LENGTH_MASK]++;
+		sub[3][data[i + 2] & GLOBAL_PULSE_LENGTH_MASK]++;
 		}
+	for ( ; i < size; i++) sub[0][data[i - 1] & GLOBAL_PULSE_LENGTH_MASK]++;
+	for (i = 0; i < GLOBAL_NR_PULSE_LENGTHS; i++) histogram[i] += sub[0][i] + sub[1][i] + sub[2][i] + sub[3][i];
 	}
 
 
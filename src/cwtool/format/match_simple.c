@@ -66,6 +66,28 @@
  *      38  37
  *      36  36
  *
+ * searching the start of a window by comparing it against every offset of
+ * the other track copy is slow. a window may have at most
+ * mm = window_size - min_matches pulses without partner and while
+ * comparing both sides never drift apart more than mm pulses. so if n
+ * disjoint anchors of ANCHOR_SIZE pulses are taken from the part of the
+ * window, which is always compared, at least n - mm of them match
+ * completely within a drift of mm pulses. pulse lengths are quantized to
+ * bins of 1 << ANCHOR_BIN_SHIFT and all bin sequences, which could match
+ * an anchor within PULSE_JITTER are put in a hash table. the other track
+ * copy is scanned once with a rolling key, only offsets hit by at least
+ * n - mm anchors are compared pulse by pulse, in ascending order. so the
+ * same (lowest) offset is found as by comparing every offset. if less
+ * than 2 anchors are needed or no such offset matches, every offset is
+ * compared as before
+ *
+ * for merge_all the merged track in container entry 0 is a consensus of
+ * all reads. for each pulse it keeps the error and the number of reads
+ * voting for it. every new read is folded in once, matching pulses add a
+ * vote, otherwise the pulse with less error weighted by the votes wins.
+ * the merged track keeps the position of the first read. merge_two still
+ * merges the current read with every read before, as pairs
+ *
  ****************************************************************************
  ****************************************************************************/
 
@@ -74,6 +96,7 @@
 
 
 #include <stdio.h>
+#include <string.h>
 
 #include "match_simple.h"
 #include "../error.h"
@@ -82,6 +105,8 @@
 #include "../global.h"
 #include "../options.h"
 #include "../fifo.h"
+#include "../scratch.h"
+#include "../stage.h"
 #include "bitstream.h"
 #include "container.h"
 
@@ -101,6 +126,11 @@
 #define WINDOW_SIZE			512
 #define PULSE_JITTER			4
 #define MIN_MATCHES			(WINDOW_SIZE - 3 * (WINDOW_SIZE / 64))
+#define ANCHOR_MAX_COUNT		64
+#define ANCHOR_SIZE			8
+#define ANCHOR_BIN_SHIFT		3
+#define ANCHOR_HASH_BITS		16
+#define ANCHOR_HASH_MASK		((1 << ANCHOR_HASH_BITS) - 1)
 
 struct match_state
 	{
@@ -112,6 +142,23 @@ struct match_state
 	cw_size_t			data2_limit;
 	};
 
+struct match_anchor
+	{
+	cw_index_t			offset;
+	cw_index_t			end;
+	cw_u32_t			bins[ANCHOR_SIZE];
+	};
+
+struct match_index
+	{
+	struct match_anchor		anc[ANCHOR_MAX_COUNT];
+	cw_u64_t			*mask;
+	cw_count_t			anchors;
+	cw_count_t			needed;
+	cw_count_t			drift;
+	cw_size_t			lag;
+	};
+
 
 
 
@@ -260,6 +307,198 @@ match_simple_compare_window(
 
 
 
+/****************************************************************************
+ * match_simple_compare_at
+ ****************************************************************************/
+static cw_count_t
+match_simple_compare_at(
+	struct match_state		*sta,
+	cw_index_t			i,
+	cw_index_t			j,
+	cw_size_t			window_size,
+	cw_count_t			pulse_jitter,
+	cw_count_t			min_matches)
+
+	{
+	sta->data1_offset = i;
+	sta->data2_offset = j;
+	return (match_simple_compare_window(sta, window_size, pulse_jitter, min_matches));
+	}
+
+
+
+/****************************************************************************
+ * match_simple_anchor_hash
+ ****************************************************************************/
+static cw_index_t
+match_simple_anchor_hash(
+	cw_u32_t			key)
+
+	{
+	return (((key * 0x9e3779b1) >> (32 - ANCHOR_HASH_BITS)) & ANCHOR_HASH_MASK);
+	}
+
+
+
+/****************************************************************************
+ * match_simple_anchor_insert
+ ****************************************************************************/
+static cw_void_t
+match_simple_anchor_insert(
+	struct match_index		*idx,
+	cw_index_t			a,
+	cw_index_t			i,
+	cw_u32_t			key)
+
+	{
+	cw_index_t			b;
+
+	/* insert all bin sequences matching this anchor */
+
+	if (i == ANCHOR_SIZE)
+		{
+		idx->mask[match_simple_anchor_hash(key)] |= (cw_u64_t) 1 << a;
+		return;
+		}
+	for (b = 0; b < GLOBAL_NR_PULSE_LENGTHS >> ANCHOR_BIN_SHIFT; b++) if ((idx->anc[a].bins[i] >> b) & 1) match_simple_anchor_insert(
+		idx,
+		a,
+		i + 1,
+		(key << 4) | b);
+	}
+
+
+
+/****************************************************************************
+ * match_simple_anchor_check
+ ****************************************************************************/
+static cw_bool_t
+match_simple_anchor_check(
+	struct match_anchor		*anc,
+	cw_raw8_t			*data)
+
+	{
+	cw_index_t			i;
+	cw_raw8_t			d;
+
+	for (i = 0; i < ANCHOR_SIZE; i++)
+		{
+		d = data[i] & GLOBAL_PULSE_LENGTH_MASK;
+		if (! ((anc->bins[i] >> (d >> ANCHOR_BIN_SHIFT)) & 1)) return (0);
+		}
+	return (1);
+	}
+
+
+
+/****************************************************************************
+ * match_simple_index_build
+ ****************************************************************************/
+static cw_bool_t
+match_simple_index_build(
+	struct match_index		*idx,
+	cw_raw8_t			*data1,
+	cw_size_t			window_size,
+	cw_count_t			pulse_jitter,
+	cw_count_t			min_matches)
+
+	{
+	struct match_anchor		*anc;
+	cw_index_t			a, b, i;
+	cw_count_t			d1, d2, mm;
+
+	debug_error_condition((GLOBAL_NR_PULSE_LENGTHS >> ANCHOR_BIN_SHIFT) > 16);
+
+	/*
+	 * the first window_size - mm pulses of the window are always
+	 * compared, as many disjoint anchors as possible are taken from
+	 * them. at most mm of them may fail, if less than 2 anchors are
+	 * left, the index is not worth it
+	 */
+
+	mm = window_size - min_matches;
+	idx->anchors = (window_size - mm) / ANCHOR_SIZE;
+	if (idx->anchors > ANCHOR_MAX_COUNT) idx->anchors = ANCHOR_MAX_COUNT;
+	idx->needed = idx->anchors - mm;
+	idx->drift  = mm;
+	if (idx->needed < 2) return (CW_BOOL_FALSE);
+
+	/*
+	 * take anchors from the window in data1 and remember for each
+	 * pulse which bins are within pulse_jitter
+	 */
+
+	memset(idx->mask, 0, (1 << ANCHOR_HASH_BITS) * sizeof (cw_u64_t));
+	for (a = 0; a < idx->anchors; a++)
+		{
+		anc = &idx->anc[a];
+		anc->offset = a * ANCHOR_SIZE;
+		anc->end    = -1;
+		for (i = 0; i < ANCHOR_SIZE; i++)
+			{
+			d1 = (data1[anc->offset + i] & GLOBAL_PULSE_LENGTH_MASK) - pulse_jitter;
+			d2 = (data1[anc->offset + i] & GLOBAL_PULSE_LENGTH_MASK) + pulse_jitter;
+			if (d1 < 0) d1 = 0;
+			if (d2 > GLOBAL_MAX_PULSE_LENGTH) d2 = GLOBAL_MAX_PULSE_LENGTH;
+			anc->bins[i] = 0;
+			for (b = d1 >> ANCHOR_BIN_SHIFT; b <= d2 >> ANCHOR_BIN_SHIFT; b++) anc->bins[i] |= 1 << b;
+			}
+		match_simple_anchor_insert(idx, a, 0, 0);
+		}
+	idx->lag = idx->anc[idx->anchors - 1].offset + ANCHOR_SIZE - 1 + idx->drift;
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * match_simple_index_scan
+ ****************************************************************************/
+static cw_void_t
+match_simple_index_scan(
+	struct match_index		*idx,
+	cw_raw8_t			*data2,
+	cw_index_t			k,
+	cw_u32_t			key,
+	cw_s8_t				*hits,
+	cw_size_t			hits_limit)
+
+	{
+	struct match_anchor		*anc;
+	cw_index_t			a, s, e;
+	cw_u64_t			m = idx->mask[match_simple_anchor_hash(key)];
+
+	/*
+	 * key contains the bins of the ANCHOR_SIZE pulses starting at k,
+	 * check which of the anchors hashed to it really match. hits[] is a
+	 * difference array, each anchor counts once for all window starts
+	 * within drift. the starts of one anchor only ascend, so an
+	 * overlapping range just extends the previous one
+	 */
+
+	for (a = 0; m != 0; a++, m >>= 1)
+		{
+		if (! (m & 1)) continue;
+		anc = &idx->anc[a];
+		if (! match_simple_anchor_check(anc, &data2[k])) continue;
+		s = k - anc->offset - idx->drift;
+		e = k - anc->offset + idx->drift;
+		if (s < 0) s = 0;
+		if (e >= hits_limit) e = hits_limit - 1;
+		if (s > e) continue;
+		if (s <= anc->end + 1)
+			{
+			if (e <= anc->end) continue;
+			hits[anc->end + 1]++;
+			}
+		else hits[s]++;
+		hits[e + 1]--;
+		anc->end = e;
+		}
+	}
+
+
+
 /****************************************************************************
  * match_simple_search_start
  ****************************************************************************/
@@ -276,8 +515,12 @@ match_simple_search_start(
 
 	{
 	struct match_state		sta;
-	cw_index_t			j;
-	cw_count_t			m;
+	struct match_index		idx;
+	cw_s8_t				*hits = scratch_get(GLOBAL_MAX_TRACK_SIZE + 1);
+	cw_size_t			hits_limit;
+	cw_u32_t			key;
+	cw_index_t			j, k;
+	cw_count_t			c, m;
 
 	sta = (struct match_state)
 		{
@@ -286,26 +529,84 @@ match_simple_search_start(
 		.data1_limit = data1_limit,
 		.data2_limit = data2_limit
 		};
-	for (j = 0; j < data2_limit; j++)
+
+	/*
+	 * match_simple_compare_window() fails anyway if one of the windows
+	 * exceeds its limit
+	 */
+
+	hits_limit = data2_limit - window_size;
+	if ((i + window_size >= data1_limit) || (hits_limit <= 0)) goto done;
+	memset(hits, 0, hits_limit + 1);
+	idx.mask = scratch_get((1 << ANCHOR_HASH_BITS) * sizeof (cw_u64_t));
+	if (! match_simple_index_build(&idx, &data1[i], window_size, pulse_jitter, min_matches))
 		{
-		sta.data1_offset = i;
-		sta.data2_offset = j;
-		m = match_simple_compare_window(
-			&sta,
-			window_size,
-			pulse_jitter,
-			min_matches);
-		if (m < min_matches) continue;
-		verbose_message(GENERIC, 3, "match_simple: window_size = %d, matches = %d, position %d", window_size, m, j);
-		match_simple_print_window(
-			&data1[i],
-			&data2[j],
-			window_size,
-			pulse_jitter);
-		return (j);
+		scratch_put(idx.mask);
+		goto linear;
+		}
+
+	/*
+	 * data2 is scanned with a rolling key of the last ANCHOR_SIZE bins.
+	 * a window start j is final once the scan is idx.lag pulses ahead,
+	 * so window starts hit by enough anchors are compared in ascending
+	 * order while scanning and the scan stops with the first match.
+	 * hits[j] is replaced by 1 if j was compared
+	 */
+
+	for (j = k = c = 0, key = 0; j < hits_limit; k++)
+		{
+		if (k < data2_limit)
+			{
+			key = (key << 4) | ((data2[k] & GLOBAL_PULSE_LENGTH_MASK) >> ANCHOR_BIN_SHIFT);
+			if (k >= ANCHOR_SIZE - 1) match_simple_index_scan(
+				&idx,
+				data2,
+				k - ANCHOR_SIZE + 1,
+				key,
+				hits,
+				hits_limit);
+			}
+		for ( ; (j <= k - idx.lag) && (j < hits_limit); j++)
+			{
+			c += hits[j];
+			hits[j] = (c >= idx.needed) ? 1 : 0;
+			if (! hits[j]) continue;
+			m = match_simple_compare_at(&sta, i, j, window_size, pulse_jitter, min_matches);
+			if (m >= min_matches)
+				{
+				scratch_put(idx.mask);
+				goto found;
+				}
+			}
+		}
+	scratch_put(idx.mask);
+
+	/*
+	 * compare all offsets not already compared, this should not find
+	 * anything if the anchors are right, but a lost match would cost
+	 * a read
+	 */
+
+linear:
+	for (j = 0; j < hits_limit; j++)
+		{
+		if (hits[j]) continue;
+		m = match_simple_compare_at(&sta, i, j, window_size, pulse_jitter, min_matches);
+		if (m >= min_matches) goto found;
 		}
+done:
+	scratch_put(hits);
 	verbose_message(GENERIC, 3, "match_simple: window_size = %d, no match", window_size);
 	return (-1);
+found:
+	scratch_put(hits);
+	verbose_message(GENERIC, 3, "match_simple: window_size = %d, matches = %d, position %d", window_size, m, j);
+	match_simple_print_window(
+		&data1[i],
+		&data2[j],
+		window_size,
+		pulse_jitter);
+	return (j);
 	}
 
 
@@ -445,6 +746,95 @@ match_simple_merge(
 
 
 
+/****************************************************************************
+ * match_simple_merge_votes
+ ****************************************************************************/
+static cw_size_t
+match_simple_merge_votes(
+	cw_raw8_t			*data_dst,
+	cw_raw8_t			*error_dst,
+	cw_raw8_t			*votes_dst,
+	cw_size_t			data_dst_limit,
+	cw_raw8_t			*data1,
+	cw_raw8_t			*error1,
+	cw_raw8_t			*votes1,
+	cw_size_t			data1_limit,
+	cw_raw8_t			*data2,
+	cw_raw8_t			*error2,
+	cw_size_t			data2_limit,
+	cw_index_t			start,
+	cw_index_t			end,
+	cw_count_t			pulse_jitter)
+
+	{
+	cw_index_t			d, i, j, k;
+	cw_count_t			s1, s2;
+	cw_raw8_t			d1, d2, e1, e2, v1;
+
+	/*
+	 * works like match_simple_merge(), but data1 is the merged track
+	 * and votes1 says how many reads agree on each pulse. if a pulse
+	 * of data2 matches within pulse_jitter, it adds a vote and the one
+	 * with less error is kept, otherwise the pulse with less error
+	 * weighted by the votes wins
+	 */
+
+	verbose_message(GENERIC, 3, "match_simple_merge_votes: start = %d, end = %d", start, end);
+	d = i = k = 0;
+	j = start;
+	s1 = s2 = 0;
+	while ((i < data1_limit) && (j < data2_limit) && (j < end) && (k < data_dst_limit))
+		{
+		d1 = data1[i] & GLOBAL_PULSE_LENGTH_MASK;
+		d2 = data2[j] & GLOBAL_PULSE_LENGTH_MASK;
+		e1 = error1[i];
+		e2 = error2[j];
+		v1 = votes1[i];
+
+		/* check if pulse lengths match */
+
+		if (s1 < s2 - pulse_jitter)
+			{
+			s1 += d1, i++;
+			if (d == 1) error_dst[k] = e1, data_dst[k] = d1, votes_dst[k] = v1, k++;
+			}
+		else if (s2 < s1 - pulse_jitter)
+			{
+			s2 += d2, j++;
+			if (d == 2) error_dst[k] = e2, data_dst[k] = d2, votes_dst[k] = 1, k++;
+			}
+		else
+			{
+			s1 = d1, i++;
+			s2 = d2, j++;
+			if ((d1 >= d2 - pulse_jitter) && (d2 >= d1 - pulse_jitter))
+				{
+				d = 1, error_dst[k] = (e1 < e2) ? e1 : e2, data_dst[k] = (e1 <= e2) ? d1 : d2, votes_dst[k] = (v1 < 0xff) ? v1 + 1 : v1;
+				}
+			else if (e1 <= e2 * v1)
+				{
+				d = 1, error_dst[k] = e1, data_dst[k] = d1, votes_dst[k] = (v1 > 1) ? v1 - 1 : 1;
+				}
+			else
+				{
+				d = 2, error_dst[k] = e2, data_dst[k] = d2, votes_dst[k] = 1;
+				}
+			k++;
+			}
+		}
+	while ((i < data1_limit) && (k < data_dst_limit))
+		{
+		data_dst[k]  = data1[i];
+		error_dst[k] = error1[i];
+		votes_dst[k] = votes1[i];
+		k++, i++;
+		}
+	verbose_message(GENERIC, 3, "match_simple_merge_votes: new size = %d", k);
+	return (k);
+	}
+
+
+
 /****************************************************************************
  * match_simple_store2
  ****************************************************************************/
@@ -485,7 +875,7 @@ match_simple_store(
 	struct match_simple_info	*mat_sim_nfo)
 
 	{
-	struct bitstream_map		bst_map[GLOBAL_MAX_TRACK_SIZE];
+	struct bitstream_map		*bst_map = scratch_get(GLOBAL_MAX_TRACK_SIZE * sizeof (struct bitstream_map));
 	cw_size_t			size;
 	cw_index_t			i;
 
@@ -514,6 +904,8 @@ match_simple_store(
 			NULL,
 			GLOBAL_MAX_TRACK_SIZE);
 		match_simple_store2(mat_sim_nfo, bst_map, size, 0);
+		container_set_limit(mat_sim_nfo->con, 0, size);
+		memset(container_get_votes(mat_sim_nfo->con, 0), 1, size);
 		}
 	i = container_store_data_and_error(
 		mat_sim_nfo->con,
@@ -521,6 +913,7 @@ match_simple_store(
 		NULL,
 		size);
 	match_simple_store2(mat_sim_nfo, bst_map, size, i);
+	scratch_put(bst_map);
 
 	/* return container number */
 
@@ -538,6 +931,10 @@ match_simple_do_callback(
 	struct container		*con)
 
 	{
+
+	/* time spent in the callback belongs to the format */
+
+	stage_enter(DECODE);
 	mat_sim_nfo->callback(
 		mat_sim_nfo->fmt,
 		con,
@@ -547,6 +944,7 @@ match_simple_do_callback(
 		mat_sim_nfo->cwtool_track,
 		mat_sim_nfo->format_track,
 		mat_sim_nfo->format_side);
+	stage_leave();
 	}
 
 
@@ -564,8 +962,8 @@ match_simple_merge2(
 	cw_index_t			index2)
 
 	{
-	cw_raw8_t			data3[GLOBAL_MAX_TRACK_SIZE];
-	cw_raw8_t			error3[GLOBAL_MAX_TRACK_SIZE];
+	cw_raw8_t			*data3  = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	cw_raw8_t			*error3 = scratch_get(GLOBAL_MAX_TRACK_SIZE);
 	cw_raw8_t			*data1, *error1, *data2, *error2;
 	cw_size_t			data1_limit, data2_limit, data3_limit;
 	cw_index_t			i, j;
@@ -587,7 +985,7 @@ match_simple_merge2(
 		PULSE_JITTER,
 		MIN_MATCHES);
 
-	if (i == -1) return (-1);
+	if (i == -1) goto failed;
 
 	j = match_simple_search_end(
 		data1,
@@ -626,7 +1024,7 @@ match_simple_merge2(
 
 	/* if data contains a complete rotation this should not happen */
 
-	if (i == -1) return (-1);
+	if (i == -1) goto failed;
 
 	j = match_simple_search_end(
 		data2,
@@ -652,7 +1050,12 @@ match_simple_merge2(
 		i,
 		j,
 		PULSE_JITTER);
-
+	goto done;
+failed:
+	data_dst_limit = -1;
+done:
+	scratch_put(error3);
+	scratch_put(data3);
 	return (data_dst_limit);
 	}
 
@@ -660,23 +1063,149 @@ match_simple_merge2(
 
 
 /****************************************************************************
- *
- * global functions
- *
+ * match_simple_fold2
  ****************************************************************************/
+static cw_size_t
+match_simple_fold2(
+	struct match_simple_info	*mat_sim_nfo,
+	cw_index_t			offset,
+	cw_raw8_t			*data2,
+	cw_raw8_t			*error2,
+	cw_size_t			data2_limit,
+	cw_index_t			start,
+	cw_index_t			end)
 
+	{
+	cw_raw8_t			*data3  = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	cw_raw8_t			*error3 = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	cw_raw8_t			*votes3 = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	cw_raw8_t			*data1, *error1, *votes1;
+	cw_size_t			data1_limit, data3_limit;
+
+	/* merge data2 into the merged track starting at offset */
+
+	data1       = container_get_data(mat_sim_nfo->con, 0);
+	error1      = container_get_error(mat_sim_nfo->con, 0);
+	votes1      = container_get_votes(mat_sim_nfo->con, 0);
+	data1_limit = container_get_limit(mat_sim_nfo->con, 0);
+	data3_limit = match_simple_merge_votes(
+		data3,
+		error3,
+		votes3,
+		container_get_size(mat_sim_nfo->con, 0) - offset,
+		&data1[offset],
+		&error1[offset],
+		&votes1[offset],
+		data1_limit - offset,
+		data2,
+		error2,
+		data2_limit,
+		start,
+		end,
+		PULSE_JITTER);
+	memcpy(&data1[offset],  data3,  data3_limit);
+	memcpy(&error1[offset], error3, data3_limit);
+	memcpy(&votes1[offset], votes3, data3_limit);
+	scratch_put(votes3);
+	scratch_put(error3);
+	scratch_put(data3);
+	data1_limit = offset + data3_limit;
+	container_set_limit(mat_sim_nfo->con, 0, data1_limit);
+	return (data1_limit);
+	}
 
 
 
 /****************************************************************************
- * match_simple
+ * match_simple_fold
  ****************************************************************************/
-cw_void_t
-match_simple(
+static cw_size_t
+match_simple_fold(
+	struct match_simple_info	*mat_sim_nfo,
+	cw_index_t			index)
+
+	{
+	cw_raw8_t			*data1, *data2, *error2;
+	cw_size_t			data1_limit, data2_limit;
+	cw_index_t			i, j, k, l;
+
+	/*
+	 * fold track index into the merged track stored as container
+	 * entry 0, the merged track keeps the position of the first read.
+	 * the part of track index behind the start of the merged track is
+	 * folded in first. if track index started earlier, its beginning
+	 * is folded in one rotation later
+	 */
+
+	data1       = container_get_data(mat_sim_nfo->con, 0);
+	data1_limit = container_get_limit(mat_sim_nfo->con, 0);
+	data2       = container_get_data(mat_sim_nfo->con, index);
+	error2      = container_get_error(mat_sim_nfo->con, index);
+	data2_limit = container_get_limit(mat_sim_nfo->con, index);
+
+	i = match_simple_search_start(
+		data1,
+		data1_limit,
+		data2,
+		data2_limit,
+		SEARCH_START,
+		WINDOW_SIZE,
+		PULSE_JITTER,
+		MIN_MATCHES);
+
+	if (i == -1) return (-1);
+
+	j = match_simple_search_end(
+		data1,
+		data1_limit,
+		data2,
+		data2_limit,
+		SEARCH_START,
+		i,
+		WINDOW_SIZE,
+		PULSE_JITTER,
+		MIN_MATCHES);
+
+	data1_limit = match_simple_fold2(mat_sim_nfo, SEARCH_START, data2, error2, data2_limit, i, j);
+	if (i < WINDOW_SIZE) return (data1_limit);
+
+	k = match_simple_search_start(
+		data2,
+		data2_limit,
+		data1,
+		data1_limit,
+		SEARCH_START,
+		WINDOW_SIZE,
+		PULSE_JITTER,
+		MIN_MATCHES);
+
+	if (k == -1) return (data1_limit);
+
+	l = match_simple_search_end(
+		data1,
+		data1_limit,
+		data2,
+		data2_limit,
+		k,
+		SEARCH_START,
+		WINDOW_SIZE,
+		PULSE_JITTER,
+		MIN_MATCHES);
+
+	return (match_simple_fold2(mat_sim_nfo, k, data2, error2, data2_limit, SEARCH_START, (l < i) ? l : i));
+	}
+
+
+
+/****************************************************************************
+ * match_simple2
+ ****************************************************************************/
+static cw_void_t
+match_simple2(
 	struct match_simple_info	*mat_sim_nfo)
 
 	{
-	cw_raw8_t			error_dummy[GLOBAL_MAX_TRACK_SIZE];
+	cw_raw8_t			*error_dummy;
 	cw_index_t			i, j;
 	cw_size_t			limit;
 
@@ -688,40 +1217,38 @@ match_simple(
 
 	match_simple_do_callback(mat_sim_nfo, mat_sim_nfo->con);
 
-	/* merge the current track with another track read earlier */
+	/* merge the current track with each track read earlier */
 
-	if (mat_sim_nfo->merge_two) for (j = 1; j < i; j++)
+	if (mat_sim_nfo->merge_two)
 		{
-		limit = match_simple_merge2(
-			mat_sim_nfo,
-			fifo_get_data(mat_sim_nfo->ffo_l0),
-			error_dummy,
-			fifo_get_size(mat_sim_nfo->ffo_l0),
-			j,
-			i);
-		if (limit == -1) continue;
-		fifo_reset(mat_sim_nfo->ffo_l0);
-		if (mat_sim_nfo->fixup) limit = match_simple_fixup_long_pulses(
-			fifo_get_data(mat_sim_nfo->ffo_l0),
-			error_dummy,
-			limit);
-		fifo_set_wr_ofs(mat_sim_nfo->ffo_l0, limit);
-		match_simple_do_callback(mat_sim_nfo, NULL);
+		error_dummy = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+		for (j = 1; j < i; j++)
+			{
+			limit = match_simple_merge2(
+				mat_sim_nfo,
+				fifo_get_data(mat_sim_nfo->ffo_l0),
+				error_dummy,
+				fifo_get_size(mat_sim_nfo->ffo_l0),
+				j,
+				i);
+			if (limit == -1) continue;
+			fifo_reset(mat_sim_nfo->ffo_l0);
+			if (mat_sim_nfo->fixup) limit = match_simple_fixup_long_pulses(
+				fifo_get_data(mat_sim_nfo->ffo_l0),
+				error_dummy,
+				limit);
+			fifo_set_wr_ofs(mat_sim_nfo->ffo_l0, limit);
+			match_simple_do_callback(mat_sim_nfo, NULL);
+			}
+		scratch_put(error_dummy);
 		}
 
-	/* mix the current track to the mixed versions of all other tracks */
+	/* fold the current track into the merged track of all reads */
 
-	if (mat_sim_nfo->merge_all) while (i > 1)
+	if ((mat_sim_nfo->merge_all) && (i > 1))
 		{
-		limit = match_simple_merge2(
-			mat_sim_nfo,
-			container_get_data(mat_sim_nfo->con, 0),
-			container_get_error(mat_sim_nfo->con, 0),
-			container_get_size(mat_sim_nfo->con, 0),
-			0,
-			i);
-		if (limit == -1) break;
-		container_set_limit(mat_sim_nfo->con, 0, limit);
+		limit = match_simple_fold(mat_sim_nfo, i);
+		if (limit == -1) return;
 		fifo_reset(mat_sim_nfo->ffo_l0);
 		fifo_write_block(
 			mat_sim_nfo->ffo_l0,
@@ -729,11 +1256,36 @@ match_simple(
 			limit);
 		if (mat_sim_nfo->fixup) limit = match_simple_fixup_long_pulses(
 			fifo_get_data(mat_sim_nfo->ffo_l0),
-			error_dummy,
+			container_get_error(mat_sim_nfo->con, 0),
 			limit);
 		fifo_set_wr_ofs(mat_sim_nfo->ffo_l0, limit);
 		match_simple_do_callback(mat_sim_nfo, NULL);
-		break;
 		}
 	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * match_simple
+ ****************************************************************************/
+cw_void_t
+match_simple(
+	struct match_simple_info	*mat_sim_nfo)
+
+	{
+	stage_enter(MATCH);
+	stage_count(MATCH, 0, fifo_get_wr_ofs(mat_sim_nfo->ffo_l0));
+	match_simple2(mat_sim_nfo);
+	stage_leave();
+	}
 /******************************************************** Karsten Scheibler */
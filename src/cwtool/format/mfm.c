@@ -12,6 +12,8 @@
 
 #include <stdio.h>
 
+#include "types.h"
+
 #include "mfm.h"
 #include "../error.h"
 #include "../debug.h"
@@ -20,6 +22,157 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * mfm_read_bytes() decodes MFM_BULK_BYTES data bytes (64 bits of mfm
+ * data) at once, the mask selects the data bits of such a word
+ */
+
+#define MFM_BULK_BYTES			4
+#define MFM_DATA_BITS			0x5555555555555555ULL
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * mfm_gather_data_bits
+ ****************************************************************************/
+static cw_u32_t
+mfm_gather_data_bits(
+	cw_u64_t			val)
+
+	{
+
+	/* move the 32 data bits of val together, keeping their order */
+
+	val &= MFM_DATA_BITS;
+	val = (val | (val >> 1))  & 0x3333333333333333ULL;
+	val = (val | (val >> 2))  & 0x0f0f0f0f0f0f0f0fULL;
+	val = (val | (val >> 4))  & 0x00ff00ff00ff00ffULL;
+	val = (val | (val >> 8))  & 0x0000ffff0000ffffULL;
+	val = (val | (val >> 16)) & 0x00000000ffffffffULL;
+	return (val);
+	}
+
+
+
+/****************************************************************************
+ * mfm_check_clock_bits
+ ****************************************************************************/
+static cw_u64_t
+mfm_check_clock_bits(
+	cw_u64_t			val,
+	int				last)
+
+	{
+	cw_u64_t			prev = (val >> 2) | ((cw_u64_t) last << 62);
+
+	/*
+	 * a clock bit has to be set if neither the data bit before nor the
+	 * data bit after it is set. returns the wrong clock bits moved to the
+	 * position of the following data bit
+	 */
+
+	return (~((val >> 1) ^ ((val | prev) & MFM_DATA_BITS)) & MFM_DATA_BITS);
+	}
+
+
+
+
+/****************************************************************************
+ * mfm_read_chunks
+ ****************************************************************************/
+static int
+mfm_read_chunks(
+	struct fifo			*ffo_l1,
+	struct disk_error		*dsk_err,
+	unsigned char			*data,
+	cw_u32_t			*raw,
+	int				size)
+
+	{
+	int				bitofs = fifo_get_rd_bitofs(ffo_l1);
+	int				last = fifo_last_bit_read(ffo_l1);
+	cw_u64_t			val, bad;
+	cw_u32_t			d;
+	int				b, i, j;
+
+	/*
+	 * decode MFM_BULK_BYTES at once, if the last chunk is shorter, only
+	 * its upper bits are checked and stored. errors are reported per
+	 * byte like mfm_read_8data_bits() does. the data bits are either
+	 * stored as bytes in data or as they are, one 32 bit mfm word for
+	 * two bytes, in raw. the caller has to check, that enough data is
+	 * available
+	 */
+
+	for (i = 0; i < size; i += MFM_BULK_BYTES)
+		{
+		b   = (size - i < MFM_BULK_BYTES) ? size - i : MFM_BULK_BYTES;
+		val = fifo_peek_bits64(ffo_l1, bitofs + 16 * i);
+		bad = mfm_check_clock_bits(val, last);
+		if (b < MFM_BULK_BYTES) bad &= ~0ULL << (64 - 16 * b);
+		last = (val >> (64 - 16 * b)) & 1;
+		if (data != NULL)
+			{
+			d = mfm_gather_data_bits(val);
+			for (j = 0; j < b; j++, d <<= 8) data[i + j] = d >> 24;
+			}
+		else
+			{
+			val &= MFM_DATA_BITS;
+			for (j = 0; j < b; j += 2, val <<= 32) raw[(i + j) / 2] = val >> 32;
+			}
+		if (bad == 0) continue;
+		for (j = 0; j < b; j++)
+			{
+			if (((bad >> (48 - 16 * j)) & 0xffff) == 0) continue;
+			verbose_message(GENERIC, 3, "wrong mfm clock bit around bit offset %d (byte %d)", bitofs + 16 * (i + j + 1), i + j);
+			disk_error_add(dsk_err, DISK_ERROR_FLAG_ENCODING, 1);
+			}
+		}
+
+	/*
+	 * read the last 16 bits again through the fifo, this leaves it in
+	 * exactly the same state as the byte wise reads would do
+	 */
+
+	fifo_set_rd_bitofs(ffo_l1, bitofs + 16 * (size - 1));
+	fifo_read_bits(ffo_l1, 16);
+	verbose_message(GENERIC, 2, "read %d bytes at bit offset %d with", size, bitofs);
+	return (0);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
 
 
 
@@ -50,6 +203,67 @@ mfm_read_8data_bits(
 
 
 
+/****************************************************************************
+ * mfm_read_bytes
+ ****************************************************************************/
+int
+mfm_read_bytes(
+	struct fifo			*ffo_l1,
+	struct disk_error		*dsk_err,
+	unsigned char			*data,
+	int				size)
+
+	{
+
+	/*
+	 * near the end of data the byte wise reads decide how much can
+	 * be read and where the fifo stops
+	 */
+
+	if ((size <= 0) || (fifo_get_rd_bitofs(ffo_l1) + 16 * size >= fifo_get_wr_bitofs(ffo_l1))) return (mfmfm_read_bytes(ffo_l1, dsk_err, data, size, mfm_read_8data_bits));
+	return (mfm_read_chunks(ffo_l1, dsk_err, data, NULL, size));
+	}
+
+
+
+/****************************************************************************
+ * mfm_read_raw
+ ****************************************************************************/
+int
+mfm_read_raw(
+	struct fifo			*ffo_l1,
+	struct disk_error		*dsk_err,
+	cw_u32_t			*raw,
+	int				size)
+
+	{
+	unsigned char			*data;
+	int				i, result;
+
+	/*
+	 * like mfm_read_bytes(), but the data bits are not moved together,
+	 * each 32 bit word in raw holds 2 bytes with the data bits at the
+	 * positions of mask 0x55555555. near the end of data the bytes are
+	 * read byte wise and encoded again
+	 */
+
+	debug_error_condition((size % 2) != 0);
+	if ((size > 0) && (fifo_get_rd_bitofs(ffo_l1) + 16 * size < fifo_get_wr_bitofs(ffo_l1))) return (mfm_read_chunks(ffo_l1, dsk_err, NULL, raw, size));
+	data   = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	result = mfmfm_read_bytes(ffo_l1, dsk_err, data, size, mfm_read_8data_bits);
+	for (i = 0; (result == 0) && (i < size); i += 2)
+		{
+		raw[i / 2] = (mfm_encode_table[data[i] >> 4] << 24) |
+			(mfm_encode_table[data[i] & 0x0f] << 16) |
+			(mfm_encode_table[data[i + 1] >> 4] << 8) |
+			mfm_encode_table[data[i + 1] & 0x0f];
+		}
+	scratch_put(data);
+	return (result);
+	}
+
+
+
 /****************************************************************************
  * mfm_write_8data_bits
  ****************************************************************************/
@@ -13,6 +13,7 @@
 #ifndef CWTOOL_FORMAT_MFM_H
 #define CWTOOL_FORMAT_MFM_H
 
+#include "types.h"
 #include "mfmfm.h"
 
 struct fifo;
@@ -20,6 +21,8 @@ struct disk_error;
 
 extern int				mfm_read_8data_bits(struct fifo *, struct disk_error *, int);
 extern int				mfm_write_8data_bits(struct fifo *, int);
+extern int				mfm_read_bytes(struct fifo *, struct disk_error *, unsigned char *, int);
+extern int				mfm_read_raw(struct fifo *, struct disk_error *, cw_u32_t *, int);
 
 #define mfm_decode_table					mfmfm_decode_table
 #define mfm_encode_table					mfmfm_encode_table
@@ -30,7 +33,6 @@ extern int				mfm_write_8data_bits(struct fifo *, int);
 #define mfm_read_sync(ffo, range, val, size)			mfmfm_read_sync(ffo, range, val, size)
 #define mfm_write_sync(ffo, val, size)				mfmfm_write_sync(ffo, val, size)
 #define mfm_write_fill(ffo, val, size)				mfmfm_write_fill(ffo, val, size, mfm_write_8data_bits)
-#define mfm_read_bytes(ffo, err, data, size)			mfmfm_read_bytes(ffo, err, data, size, mfm_read_8data_bits)
 #define mfm_write_bytes(ffo, data, size)			mfmfm_write_bytes(ffo, data, size, mfm_write_8data_bits)
 #define mfm_crc16(init, data, size)				mfmfm_crc16(init, data, size)
 #define mfm_get_sector_shift(pshift, sector, sectors)		mfmfm_get_sector_shift(pshift, sector, sectors)
@@ -20,6 +20,7 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
 #include "mfm.h"
 #include "range.h"
@@ -79,25 +80,37 @@ mfm_amiga_shuffle(
 
 
 /****************************************************************************
- * mfm_amiga_unshuffle
+ * mfm_amiga_decode
  ****************************************************************************/
-static void
-mfm_amiga_unshuffle(
+static unsigned long
+mfm_amiga_decode(
+	cw_u32_t			*raw,
 	unsigned char			*data,
 	int				len)
 
 	{
-	unsigned char			tmp[DATA_SIZE];
-	int				i, j, k;
+	cw_u32_t			sum, val;
+	int				i, j;
 
-	debug_error_condition((len % 2) != 0);
-	debug_error_condition(len > sizeof (tmp));
-	for (i = k = 0, j = len / 2; k < len; i++, j++)
+	/*
+	 * raw contains the mfm words with the odd bits of len bytes followed
+	 * by the ones with the even bits, only the data bits are set. the
+	 * odd bits just need to be shifted to merge them with the even bits.
+	 * returns the xor of all mfm words, which is the checksum in the
+	 * byte order mfm_amiga_checksum() uses
+	 */
+
+	debug_error_condition((len % 4) != 0);
+	for (sum = i = 0, j = len / 4; i < len / 4; i++, j++, data += 4)
 		{
-		tmp[k++] = (mfm_encode_table[data[i] >>   4] << 1) | mfm_encode_table[data[j] >>   4];
-		tmp[k++] = (mfm_encode_table[data[i] & 0x0f] << 1) | mfm_encode_table[data[j] & 0x0f];
+		sum    ^= raw[i] ^ raw[j];
+		val     = (raw[i] << 1) | raw[j];
+		data[0] = val >> 24;
+		data[1] = val >> 16;
+		data[2] = val >> 8;
+		data[3] = val;
 		}
-	for (i = 0; i < len; i++) data[i] = tmp[i];
+	return (((sum & 0xff) << 24) | ((sum & 0xff00) << 8) | ((sum >> 8) & 0xff00) | (sum >> 24));
 	}
 
 
@@ -148,21 +161,25 @@ mfm_amiga_read_sector2(
 	struct mfm_amiga		*mfm_amg,
 	struct disk_error		*dsk_err,
 	struct range_sector		*rng_sec,
-	unsigned char			*data)
+	unsigned char			*data,
+	unsigned long			*checksum)
 
 	{
+	cw_u32_t			raw[DATA_SIZE / 2];
 	int				bitofs;
 
 	*dsk_err = (struct disk_error) { };
 	if (mfm_read_sync(ffo_l1, range_sector_data(rng_sec), mfm_amg->rw.sync_value, mfm_amg->rw.sync_length) == -1) return (-1);
 	bitofs = fifo_get_rd_bitofs(ffo_l1);
-	if (mfm_read_bytes(ffo_l1, dsk_err, data, DATA_SIZE) == -1) return (-1);
+	if (mfm_read_raw(ffo_l1, dsk_err, raw, DATA_SIZE) == -1) return (-1);
 	range_set_end(range_sector_data(rng_sec), fifo_get_rd_bitofs(ffo_l1));
-	mfm_amiga_unshuffle(data, 4);
-	mfm_amiga_unshuffle(&data[4], 16);
-	mfm_amiga_unshuffle(&data[20], 4);
-	mfm_amiga_unshuffle(&data[24], 4);
-	mfm_amiga_unshuffle(&data[28], 512);
+
+	/* decode all parts and calculate both checksums in the same pass */
+
+	checksum[0] = mfm_amiga_decode(raw, data, 4) ^ mfm_amiga_decode(&raw[2], &data[4], 16);
+	mfm_amiga_decode(&raw[10], &data[20], 4);
+	mfm_amiga_decode(&raw[12], &data[24], 4);
+	checksum[1] = mfm_amiga_decode(&raw[14], &data[28], 512);
 	verbose_message(GENERIC, 2, "rewinding to bit offset %d", bitofs);
 	fifo_set_rd_bitofs(ffo_l1, bitofs);
 	return (1);
@@ -210,9 +227,10 @@ mfm_amiga_read_sector(
 	struct disk_error		dsk_err;
 	struct range_sector		rng_sec = RANGE_SECTOR_INIT;
 	unsigned char			data[DATA_SIZE];
+	unsigned long			checksum[2];
 	int				result, track, sector;
 
-	if (mfm_amiga_read_sector2(ffo_l1, mfm_amg, &dsk_err, &rng_sec, data) == -1) return (-1);
+	if (mfm_amiga_read_sector2(ffo_l1, mfm_amg, &dsk_err, &rng_sec, data, checksum) == -1) return (-1);
 
 	/* accept only valid sector numbers */
 
@@ -227,8 +245,8 @@ mfm_amiga_read_sector(
 
 	/* check sector quality */
 
-	result = format_compare2("header xor checksum: got 0x%08x, expected: 0x%08x", mfm_read_u32_le(&data[20]), mfm_amiga_checksum(data, 20));
-	result += format_compare2("data xor checksum: got 0x%08x, expected: 0x%08x", mfm_read_u32_le(&data[24]), mfm_amiga_checksum(&data[28], 512));
+	result = format_compare2("header xor checksum: got 0x%08x, expected: 0x%08x", mfm_read_u32_le(&data[20]), checksum[0]);
+	result += format_compare2("data xor checksum: got 0x%08x, expected: 0x%08x", mfm_read_u32_le(&data[24]), checksum[1]);
 	if (result > 0) verbose_message(GENERIC, 2, "checksum error on sector %d", sector);
 	if (mfm_amg->rd.flags & FLAG_IGNORE_CHECKSUMS) disk_warning_add(&dsk_err, result);
 	else disk_error_add(&dsk_err, DISK_ERROR_FLAG_CHECKSUM, result);
@@ -331,12 +349,13 @@ mfm_amiga_read_track2(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_l1 = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 
 	if (fmt->mfm_amg.rd.flags & FLAG_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->mfm_amg.rw.bnd, 3);
 	bitstream_read(ffo_l0, &ffo_l1, fmt->mfm_amg.rw.bnd, 3);
 	while (mfm_amiga_read_sector(&ffo_l1, &fmt->mfm_amg, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	scratch_put(data);
 	}
 
 
@@ -20,6 +20,7 @@
 #include "../options.h"
 #include "../disk.h"
 #include "../fifo.h"
+#include "../scratch.h"
 #include "../format.h"
 #include "mfm.h"
 #include "range.h"
@@ -332,12 +333,13 @@ mfm_nec765_read_track2(
 	cw_count_t			format_side)
 
 	{
-	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
-	struct fifo			ffo_l1 = FIFO_INIT(data, sizeof (data));
+	unsigned char			*data = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	struct fifo			ffo_l1 = FIFO_INIT(data, GLOBAL_MAX_TRACK_SIZE);
 
 	if (fmt->mfm_nec.rd.flags & FLAG_RD_POSTCOMP_SIMPLE) postcomp_simple(ffo_l0, fmt->mfm_nec.rw.bnd, 3);
 	bitstream_read(ffo_l0, &ffo_l1, fmt->mfm_nec.rw.bnd, 3);
 	while (mfm_nec765_read_sector(&ffo_l1, &fmt->mfm_nec, con, dsk_sct, cwtool_track, format_track, format_side) != -1) ;
+	scratch_put(data);
 	}
 
 
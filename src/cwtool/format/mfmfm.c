@@ -20,6 +20,7 @@
 #include "../disk.h"
 #include "../fifo.h"
 #include "range.h"
+#include "sync.h"
 
 
 
@@ -65,15 +66,31 @@ mfmfm_read_sync(
 	int				size)
 
 	{
-	int				i, j, bits;
-	int				reg = fifo_read_bits(ffo_l1, 15);
-
-	if (reg == -1) return (-1);
+	struct sync			syn = SYNC_INIT(16, 16, val, val);
+	int				i, j, bits, reg = 0;
+
+	/*
+	 * search for the first sync with sync_read(), further syncs have to
+	 * follow directly. if not, the next sync is searched in the last 16
+	 * bits read combined with the 15 bits in reg. reg is not updated
+	 * when rewinding the fifo, this is not exact, but it is how the
+	 * sync search always worked, so keep it this way
+	 */
+
+	if ((size < 1) && (fifo_read_bits(ffo_l1, 15) == -1)) return (-1);
 	for (j = 0; j < size; )
 		{
+		if (j == 0)
+			{
+			if (sync_read(ffo_l1, &syn) == -1) return (-1);
+			verbose_message(GENERIC, 3, "first sync found at bit offset %d with value 0x%04x", fifo_get_rd_bitofs(ffo_l1) - 16, val);
+			reg = syn.reg;
+			j = 1;
+			continue;
+			}
 		bits = fifo_read_bits(ffo_l1, 16);
 		if (bits == -1) return (-1);
-		if ((j > 0) && (bits == val))
+		if (bits == val)
 			{
 			j++;
 			continue;
@@ -87,6 +104,7 @@ mfmfm_read_sync(
 			j = 1;
 			break;
 			}
+		if (j == 0) fifo_set_rd_bitofs(ffo_l1, fifo_get_rd_bitofs(ffo_l1) - 15);
 		}
 	verbose_message(GENERIC, 2, "got %d sync(s) at bit offset %d with value 0x%04x", size, fifo_get_rd_bitofs(ffo_l1) - 16 * size, val);
 	range_set_start(rng, fifo_get_rd_bitofs(ffo_l1) - 16 * size);
@@ -106,26 +124,13 @@ mfmfm_read_sync2(
 	int				val2)
 
 	{
-	int				i, bits, val;
-	int				reg = fifo_read_bits(ffo_l1, 15);
+	struct sync			syn = SYNC_INIT(16, 16, val1, val2);
+	int				i = sync_read(ffo_l1, &syn);
 
-	if (reg == -1) return (-1);
-	while (1)
-		{
-		bits = fifo_read_bits(ffo_l1, 16);
-		if (bits == -1) return (-1);
-		bits = reg = (reg << 16) | bits;
-		for (i = 0; i < 16; i++, bits >>= 1) 
-			{
-			val = bits & 0xffff;
-			if ((val == val1) || (val == val2)) goto found;
-			}
-		}
-found:
-	fifo_set_rd_bitofs(ffo_l1, fifo_get_rd_bitofs(ffo_l1) - i);
-	verbose_message(GENERIC, 2, "got sync at bit offset %d with value 0x%04x", fifo_get_rd_bitofs(ffo_l1) - 16, val);
+	if (i == -1) return (-1);
+	verbose_message(GENERIC, 2, "got sync at bit offset %d with value 0x%04x", fifo_get_rd_bitofs(ffo_l1) - 16, syn.val[i]);
 	range_set_start(rng, fifo_get_rd_bitofs(ffo_l1) - 16);
-	return ((val == val1) ? 0 : 1);
+	return (i);
 	}
 
 
@@ -11,6 +11,7 @@
 
 
 #include <stdio.h>
+#include <string.h>
 
 #include "postcomp_simple.h"
 #include "../error.h"
@@ -19,11 +20,35 @@
 #include "../global.h"
 #include "../options.h"
 #include "../fifo.h"
+#include "../scratch.h"
+#include "../stage.h"
 #include "bounds.h"
 
 
 
 
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * areas from POSTCOMP_SIMPLE_AREA_MIN to POSTCOMP_SIMPLE_AREA_MAX are done
+ * one after another. more areas or repeating them produces sometimes very
+ * nice histograms, but will not improve readability of a disk
+ */
+
+#define POSTCOMP_SIMPLE_AREA_MIN	2
+#define POSTCOMP_SIMPLE_AREA_MAX	15
+#define POSTCOMP_SIMPLE_NR_AREAS	(POSTCOMP_SIMPLE_AREA_MAX - POSTCOMP_SIMPLE_AREA_MIN + 1)
+
+
+
+
 /****************************************************************************
  *
  * local functions
@@ -129,41 +154,41 @@ postcomp_simple_lookup(
  ****************************************************************************/
 static int
 postcomp_simple_calculate(
-	struct bounds			*bnd,
-	int				bnd_size,
+	int				*lookup,
+	int				*value,
 	unsigned char			*data,
 	char				*error,
-	char				*done,
-	int				len,
-	int				stage,
-	int				area,
-	int				adjust0,
-	int				adjust1)
+	int				*pending,
+	int				size)
 
 	{
-	int				lookup[GLOBAL_NR_PULSE_LENGTHS];
-	int				d, e, i, j, p;
-
-	/* create lookup table */
-
-	postcomp_simple_lookup(bnd, bnd_size, lookup, area, adjust0, adjust1);
+	int				d, e, i, j, k, l, n;
 
-	/* iterate over data */
+	/*
+	 * only positions not compensated by a previous area are in
+	 * pending[], the others would not change anything. the error of
+	 * position k is taken before position k - 1 modifies it, as if all
+	 * positions were iterated. the still pending positions are moved
+	 * to the front of pending[] for the next area
+	 */
 
-	for (i = 1, e = error[i] / 2, p = 0; i < len - 1; i++)
+	for (i = l = 0, n = -1, e = 0; i < size; i++)
 		{
-		d = (data[i] + e) & GLOBAL_PULSE_LENGTH_MASK;
-		e = error[i + 1] / 2;
+		k = pending[i];
+		if (k != n) e = error[k] / 2;
+		d = (data[k] + e) & GLOBAL_PULSE_LENGTH_MASK;
+		e = error[k + 1] / 2;
+		n = k + 1;
 		j = lookup[d];
-		if ((done[i] >= stage) || (j == -1)) continue;
-		d -= raw_val(bnd, j, adjust0, adjust1);
-		error[i - 1] += d / 2;
-		error[i]     -= d;
-		error[i + 1] += d - (d / 2);
-		done[i] = stage;
-		p++;
+		pending[l] = k;
+		l += (j == -1);
+		if (j == -1) continue;
+		d -= value[j];
+		error[k - 1] += d / 2;
+		error[k]     -= d;
+		error[k + 1] += d - (d / 2);
 		}
-	return (p);
+	return (l);
 	}
 
 
@@ -229,16 +254,13 @@ postcomp_simple_adjust(
 	int				adjust1)
 
 	{
+	int				lookup[POSTCOMP_SIMPLE_NR_AREAS][GLOBAL_NR_PULSE_LENGTHS];
+	int				value[GLOBAL_NR_BOUNDS];
 	unsigned char			*data = fifo_get_data(ffo);
 	int				len   = fifo_get_wr_ofs(ffo);
-	char				error[GLOBAL_MAX_TRACK_SIZE] = { };
-	char				done[GLOBAL_MAX_TRACK_SIZE] = { };
-	int				stage, area;
-
-	/*
-	 * increasing number of stages produces sometimes very nice
-	 * histograms, but will not improve readability of a disk
-	 */
+	char				*error;
+	int				*pending;
+	int				a, i, p, size;
 
 	if (bnd_size < 2) return (0);
 	verbose_message(GENERIC, 1, "doing simple postcompensation with adjust { %s0x%04x %s0x%04x }",
@@ -246,10 +268,27 @@ postcomp_simple_adjust(
 		postcomp_simple_value(adjust0),
 		postcomp_simple_sign(adjust1),
 		postcomp_simple_value(adjust1));
-	for (stage = 1; stage < 2; stage++) for (area = 2; area < 16; area++)
-		{
-		postcomp_simple_calculate(bnd, bnd_size, data, error, done, len, stage, area, adjust0, adjust1);
-		}
-	return (postcomp_simple_apply(data, error, len));
+
+	/*
+	 * the lookup tables only depend on the bounds, so they are created
+	 * once for all areas. only the used part of error needs to be
+	 * cleared
+	 */
+
+	stage_enter(POSTCOMP);
+	debug_error_condition(bnd_size > GLOBAL_NR_BOUNDS);
+	for (i = 0; i < bnd_size; i++) value[i] = raw_val(bnd, i, adjust0, adjust1);
+	for (a = 0; a < POSTCOMP_SIMPLE_NR_AREAS; a++) postcomp_simple_lookup(bnd, bnd_size, lookup[a], POSTCOMP_SIMPLE_AREA_MIN + a, adjust0, adjust1);
+	error   = scratch_get(GLOBAL_MAX_TRACK_SIZE);
+	pending = scratch_get(GLOBAL_MAX_TRACK_SIZE * sizeof (int));
+	memset(error, 0, len);
+	for (i = 1, size = 0; i < len - 1; i++) pending[size++] = i;
+	for (a = 0; (a < POSTCOMP_SIMPLE_NR_AREAS) && (size > 0); a++) size = postcomp_simple_calculate(lookup[a], value, data, error, pending, size);
+	p = postcomp_simple_apply(data, error, len);
+	scratch_put(pending);
+	scratch_put(error);
+	stage_count(POSTCOMP, 0, len);
+	stage_leave();
+	return (p);
 	}
 /******************************************************** Karsten Scheibler */
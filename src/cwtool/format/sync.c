@@ -0,0 +1,349 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * format/sync.c
+ *
+ ****************************************************************************
+ *
+ * shared sync search for the mfm, fm and gcr decoders. instead of reading
+ * the bitstream with fifo_read_bits() and testing every bit shift, the
+ * bitstream is scanned byte wise. any occurrence of a sync value with at
+ * least 15 bits fully contains one byte aligned byte, which can only have
+ * 8 different values per sync value. so a 256 bit filter on this byte
+ * rejects nearly all positions, only the remaining ones are compared
+ * bit exact
+ *
+ * sync_read() and sync_read_ones() behave exactly like the old bit serial
+ * loops did, including which sync is taken if more than one matches
+ * inside the same chunk and the fifo state on errors
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+
+#include "sync.h"
+#include "../error.h"
+#include "../debug.h"
+#include "../verbose.h"
+#include "../global.h"
+#include "../fifo.h"
+#include "../stage.h"
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * sync_get_bits
+ ****************************************************************************/
+static int
+sync_get_bits(
+	unsigned char			*data,
+	int				size,
+	int				bitofs,
+	int				bits)
+
+	{
+	cw_u32_t			val;
+	int				i, ofs = bitofs / 8;
+
+	for (i = val = 0; i < 4; i++, ofs++)
+		{
+		val <<= 8;
+		if (ofs < size) val |= data[ofs];
+		}
+	return ((val << (bitofs & 7)) >> (32 - bits));
+	}
+
+
+
+/****************************************************************************
+ * sync_match
+ ****************************************************************************/
+static int
+sync_match(
+	struct sync			*syn,
+	unsigned char			*data,
+	int				size,
+	int				bitofs)
+
+	{
+	int				i, val = sync_get_bits(data, size, bitofs, syn->bits);
+
+	for (i = 0; i < SYNC_NR_VALUES; i++) if (val == syn->val[i]) return (i);
+	return (-1);
+	}
+
+
+
+/****************************************************************************
+ * sync_filter
+ ****************************************************************************/
+static void
+sync_filter(
+	struct sync			*syn)
+
+	{
+	int				b, i, j;
+
+	debug_error_condition((syn->bits < 15) || (syn->bits > 24));
+	debug_error_condition((syn->step < 1) || (syn->step > 16));
+	for (i = 0; i < 4; i++) syn->filter[i] = 0;
+	for (i = 0; i < SYNC_NR_VALUES; i++)
+		{
+		for (j = 0; j < 8; j++)
+			{
+			b = (syn->val[i] >> (syn->bits - 8 - j)) & 0xff;
+			syn->filter[b >> 6] |= (cw_u64_t) 1 << (b & 63);
+			}
+		}
+	syn->filter_valid = 1;
+	}
+
+
+
+/****************************************************************************
+ * sync_read_failed
+ ****************************************************************************/
+static int
+sync_read_failed(
+	struct fifo			*ffo,
+	int				bitofs,
+	int				step)
+
+	{
+	int				wr_bitofs = fifo_get_wr_bitofs(ffo);
+
+	/*
+	 * repeat the first read of the bit serial loop which would have
+	 * failed, so the fifo is left in the same state
+	 */
+
+	while (bitofs + step < wr_bitofs) bitofs += step;
+	fifo_set_rd_bitofs(ffo, bitofs);
+	fifo_read_bits(ffo, step);
+	return (-1);
+	}
+
+
+
+/****************************************************************************
+ * sync_read2
+ ****************************************************************************/
+static int
+sync_read2(
+	struct fifo			*ffo,
+	struct sync			*syn)
+
+	{
+	unsigned char			*data;
+	int				wr_bitofs = fifo_get_wr_bitofs(ffo);
+	int				bitofs, end, i, j, k, size;
+
+	/*
+	 * the bit serial loop read bits - 1 bits first and then chunks of
+	 * step bits, after each chunk all step possible sync positions
+	 * ending inside the chunk were checked, the last one first. the
+	 * fifo is left behind the sync, syn->end is set to the end of the
+	 * chunk and syn->reg to the value of the chunk
+	 */
+
+	if (fifo_read_bits(ffo, 15) == -1) return (-1);
+	if ((syn->bits > 16) && (fifo_read_bits(ffo, syn->bits - 16) == -1)) return (-1);
+	bitofs = fifo_get_rd_bitofs(ffo);
+	i = sync_find(ffo, syn, bitofs - syn->bits + 1, &j);
+	if (i == -1) return (sync_read_failed(ffo, bitofs, syn->step));
+	end = i + syn->bits;
+	end = bitofs + syn->step * ((end - bitofs + syn->step - 1) / syn->step);
+	if (end >= wr_bitofs) return (sync_read_failed(ffo, bitofs, syn->step));
+	data = fifo_get_data(ffo);
+	size = fifo_get_wr_ofs(ffo);
+	for (bitofs = end; bitofs > i + syn->bits; bitofs--)
+		{
+		k = sync_match(syn, data, size, bitofs - syn->bits);
+		if (k == -1) continue;
+		j = k;
+		break;
+		}
+	fifo_set_rd_bitofs(ffo, end - syn->step);
+	syn->end = end;
+	syn->reg = fifo_read_bits(ffo, syn->step);
+	fifo_set_rd_bitofs(ffo, bitofs);
+	return (j);
+	}
+
+
+
+/****************************************************************************
+ * sync_read_ones2
+ ****************************************************************************/
+static int
+sync_read_ones2(
+	struct fifo			*ffo,
+	int				size)
+
+	{
+	unsigned char			*data = fifo_get_data(ffo);
+	int				start = fifo_get_rd_bitofs(ffo);
+	int				wr_bitofs = fifo_get_wr_bitofs(ffo);
+	int				b, bitofs, end, i, l, t;
+
+	/*
+	 * search for the first zero bit preceded by at least size one bits,
+	 * counting starts at the current read position. the bit serial loop
+	 * did this in chunks of 16 bits, so the chunk containing the zero
+	 * bit has to be readable. the fifo is left at the zero bit and the
+	 * number of preceding one bits is returned
+	 */
+
+	for (bitofs = start, i = 0; bitofs < wr_bitofs; )
+		{
+		if (((bitofs & 7) == 0) && (bitofs + 8 <= wr_bitofs))
+			{
+			b = data[bitofs / 8];
+			if (b == 0xff)
+				{
+				i += 8, bitofs += 8;
+				continue;
+				}
+
+			/*
+			 * only the first zero bit of this byte may end a sync,
+			 * if size > 7. the following zero bits are preceded by
+			 * less than 7 one bits
+			 */
+
+			if (size > 7)
+				{
+				for (l = 0; (b << l) & 0x80; l++) ;
+				if (i + l >= size)
+					{
+					i += l, bitofs += l;
+					goto found;
+					}
+				for (t = 0; (b >> t) & 1; t++) ;
+				i = t, bitofs += 8;
+				continue;
+				}
+			}
+		if ((data[bitofs / 8] << (bitofs & 7)) & 0x80) i++;
+		else if (i >= size) goto found;
+		else i = 0;
+		bitofs++;
+		}
+	return (sync_read_failed(ffo, start, 16));
+found:
+	end = start + 16 * ((bitofs - start) / 16 + 1);
+	if (end >= wr_bitofs) return (sync_read_failed(ffo, start, 16));
+	fifo_set_rd_bitofs(ffo, end - 16);
+	fifo_read_bits(ffo, 16);
+	fifo_set_rd_bitofs(ffo, bitofs);
+	return (i);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * sync_find
+ ****************************************************************************/
+int
+sync_find(
+	struct fifo			*ffo,
+	struct sync			*syn,
+	int				bitofs,
+	int				*index)
+
+	{
+	unsigned char			*data = fifo_get_data(ffo);
+	int				size  = fifo_get_wr_ofs(ffo);
+	int				limit = fifo_get_wr_bitofs(ffo) - syn->bits;
+	int				b, d, i, ofs, p;
+
+	/*
+	 * returns the bit offset of the first sync value starting at or
+	 * after bitofs and ending inside the written data
+	 */
+
+	if (! syn->filter_valid) sync_filter(syn);
+	for (ofs = (bitofs + 7) / 8; 8 * ofs - 7 <= limit; ofs++)
+		{
+		b = data[ofs];
+		if (! ((syn->filter[b >> 6] >> (b & 63)) & 1)) continue;
+		for (d = 7; d >= 0; d--)
+			{
+			p = 8 * ofs - d;
+			if ((p < bitofs) || (p > limit)) continue;
+			i = sync_match(syn, data, size, p);
+			if (i == -1) continue;
+			if (index != NULL) *index = i;
+			return (p);
+			}
+		}
+	return (-1);
+	}
+
+
+
+/****************************************************************************
+ * sync_read
+ ****************************************************************************/
+int
+sync_read(
+	struct fifo			*ffo,
+	struct sync			*syn)
+
+	{
+	int				rd_bitofs = fifo_get_rd_bitofs(ffo);
+	int				i;
+
+	stage_enter(SYNC);
+	i = sync_read2(ffo, syn);
+	stage_count(SYNC, (fifo_get_rd_bitofs(ffo) - rd_bitofs) / 8, 0);
+	stage_leave();
+	return (i);
+	}
+
+
+
+/****************************************************************************
+ * sync_read_ones
+ ****************************************************************************/
+int
+sync_read_ones(
+	struct fifo			*ffo,
+	int				size)
+
+	{
+	int				rd_bitofs = fifo_get_rd_bitofs(ffo);
+	int				i;
+
+	stage_enter(SYNC);
+	i = sync_read_ones2(ffo, size);
+	stage_count(SYNC, (fifo_get_rd_bitofs(ffo) - rd_bitofs) / 8, 0);
+	stage_leave();
+	return (i);
+	}
+/******************************************************** Karsten Scheibler */
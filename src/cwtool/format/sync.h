@@ -0,0 +1,65 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * format/sync.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_FORMAT_SYNC_H
+#define CWTOOL_FORMAT_SYNC_H
+
+#include "types.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+struct fifo;
+
+#define SYNC_NR_VALUES			2
+#define SYNC_INIT(b, s, v1, v2)		(struct sync) { .bits = b, .step = s, .val = { v1, v2 } }
+
+struct sync
+	{
+	int				bits;
+	int				step;
+	int				val[SYNC_NR_VALUES];
+	int				end;
+	int				reg;
+	int				filter_valid;
+	cw_u64_t			filter[4];
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern int				sync_find(struct fifo *, struct sync *, int, int *);
+extern int				sync_read(struct fifo *, struct sync *);
+extern int				sync_read_ones(struct fifo *, int);
+
+
+
+#endif /* !CWTOOL_FORMAT_SYNC_H */
+/******************************************************** Karsten Scheibler */
@@ -45,6 +45,7 @@
 #define GLOBAL_NR_DRIVES		CW_NR_FLOPPIES
 #define GLOBAL_NR_IMAGES		64
 #define GLOBAL_NR_RETRIES		10
+#define GLOBAL_NR_JOBS			64
 #define GLOBAL_MAX_CONFIG_SIZE		0x10000
 
 #define GLOBAL_NR_BOUNDS		8
@@ -73,6 +73,13 @@ image_open(
 
 	*img = (union image) { };
 	file_open(fil, path, mode, FILE_FLAG_NONE);
+
+	/*
+	 * regular files are mapped into memory if possible, so reading
+	 * tracks needs no syscalls
+	 */
+
+	if (mode == FILE_MODE_READ) file_map(fil);
 	return (1);
 	}
 
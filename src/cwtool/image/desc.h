@@ -33,6 +33,9 @@ struct image_desc
 	int				(*track_read)(union image *, struct image_track *, struct fifo *, struct disk_sector *, int, int);
 	int				(*track_write)(union image *, struct image_track *, struct fifo *, struct disk_sector *, int, int);
 	int				(*track_done)(union image *, struct image_track *, int);
+	int				(*offline)(union image *);
+	int				(*streamed)(union image *);
+	int				(*track_next)(union image *, struct image_track **, struct fifo *, int *);
 	};
 
 
@@ -90,6 +90,7 @@ image_g64_read_fill(
 	int				l, s = size;
 
 	debug_error_condition(size < 0);
+	if ((size > 0) && (file_read_map(&img_g64->fil, size) != NULL)) return (size);
 	while (s > 0)
 		{
 		l = size;
@@ -140,7 +141,7 @@ image_g64_read_data(
 	int				offset)
 
 	{
-	unsigned char			buffer[4];
+	unsigned char			buffer[4], *data;
 	unsigned int			track_offsets[IMAGE_G64_MAX_TRACK];
 	unsigned int			speed_offsets[IMAGE_G64_MAX_TRACK];
 	int				i, s, t;
@@ -192,8 +193,22 @@ image_g64_read_data(
 		file_read_strict(&img_g64->fil, buffer, 2);
 		s = import_u16_le(buffer);
 		if (s > max_track_size) error_message("track %d in file '%s' too large", t, file_get_path(&img_g64->fil));
-		img_g64->trk[t] = image_g64_allocate_track(s, speed_offsets[t], 0);
-		file_read_strict(&img_g64->fil, img_g64->trk[t].data, s);
+
+		/* if the file is mapped, track data is not copied */
+
+		data = file_read_map(&img_g64->fil, s);
+		if (data != NULL) img_g64->trk[t] = (struct image_g64_track)
+			{
+			.data   = data,
+			.size   = s,
+			.speed  = speed_offsets[t],
+			.mapped = 1
+			};
+		else
+			{
+			img_g64->trk[t] = image_g64_allocate_track(s, speed_offsets[t], 0);
+			file_read_strict(&img_g64->fil, img_g64->trk[t].data, s);
+			}
 		offset += s + 2;
 		track_offsets[t] = 0;
 		verbose_message(GENERIC, 2, "got %d bytes", s);
@@ -345,7 +360,7 @@ image_g64_close(
 			error_warning("track %d from file '%s' was not used", t, file_get_path(&img->g64.fil));
 			}
 		}
-	for (t = 0; t < IMAGE_G64_MAX_TRACK; t++) if (img->g64.trk[t].data != NULL) free(img->g64.trk[t].data);
+	for (t = 0; t < IMAGE_G64_MAX_TRACK; t++) if ((img->g64.trk[t].data != NULL) && (! img->g64.trk[t].mapped)) free(img->g64.trk[t].data);
 	return (image_close(img, &img->g64.fil));
 	}
 
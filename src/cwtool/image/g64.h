@@ -25,6 +25,7 @@ struct image_g64_track
 	int				size;
 	int				speed;
 	int				used;
+	int				mapped;
 	};
 
 struct image_g64
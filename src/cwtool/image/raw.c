@@ -27,6 +27,9 @@
 #include "../export.h"
 #include "../parse.h"
 #include "../string.h"
+#include "../stage.h"
+#include "../scratch.h"
+#include "../pack.h"
 
 
 
@@ -41,27 +44,14 @@
 #define SUBTYPE_NONE			0
 #define SUBTYPE_DATA			1
 #define SUBTYPE_TEXT			2
+#define SUBTYPE_PACK			3
 
 #define FLAG_SEARCH_HINTS		(1 << 0)
+#define FLAG_INDEXED			(1 << 1)
 
-#define TRACK_MAGIC			0xca
 #define TRACK_FLAG_DONE			(1 << 0)
 #define TRACK_FLAG_FOUND		(1 << 1)
 
-#define HEADER_FLAG_WRITABLE		(1 << 0)
-#define HEADER_FLAG_INDEX_STORED	(1 << 1)
-#define HEADER_FLAG_INDEX_ALIGNED	(1 << 2)
-#define HEADER_FLAG_NO_CORRECTION	(1 << 3)
-
-struct track_header
-	{
-	unsigned char			magic;
-	unsigned char			track;
-	unsigned char			clock;
-	unsigned char			flags;
-	unsigned char			size[4];
-	};
-
 
 
 
@@ -75,10 +65,10 @@ struct track_header
 
 
 /****************************************************************************
- * image_raw_track_translate
+ * image_raw_track_translate2
  ****************************************************************************/
 static int
-image_raw_track_translate(
+image_raw_track_translate2(
 	struct image_track		*img_trk,
 	int				track)
 
@@ -96,6 +86,22 @@ image_raw_track_translate(
 		}
 	if (img_trk->flags & IMAGE_TRACK_FLAG_FLIP_SIDE) xlated_track ^= 1;
 	debug_error_condition((xlated_track < 0) || (xlated_track >= GLOBAL_NR_TRACKS));
+	return (xlated_track);
+	}
+
+
+
+/****************************************************************************
+ * image_raw_track_translate
+ ****************************************************************************/
+static int
+image_raw_track_translate(
+	struct image_track		*img_trk,
+	int				track)
+
+	{
+	int				xlated_track = image_raw_track_translate2(img_trk, track);
+
 	if (track != xlated_track) verbose_message(GENERIC, 1, "translating track from %d to %d", track, xlated_track);
 	return (xlated_track);
 	}
@@ -197,7 +203,10 @@ image_raw_read_correction(
 	cw_index_t			i;
 
 	verbose_message(GENERIC, 1, "doing '0x80 -> 0x7f' correction on raw track %d", track);
+	stage_enter(CLOCK);
 	for (i = 0; i < size; i++) if (data[i] > 0) data[i]--;
+	stage_count(CLOCK, size, size);
+	stage_leave();
 	}
 
 
@@ -223,6 +232,7 @@ image_raw_clock_adjust_double(
 	 */
 
 	verbose_message(GENERIC, 1, "doing clock adjustment (doubling values) on raw track %d", track);
+	stage_enter(CLOCK);
 	for (i = 0; i < size; i++)
 		{
 		d1 = data[i];
@@ -233,6 +243,8 @@ image_raw_clock_adjust_double(
 		if ((d1 & GLOBAL_PULSE_INDEX_MASK) != 0) d2 |= GLOBAL_PULSE_INDEX_MASK;
 		data[i] = d2;
 		}
+	stage_count(CLOCK, size, size);
+	stage_leave();
 	}
 
 
@@ -257,6 +269,7 @@ image_raw_clock_adjust_half(
 	 */
 
 	verbose_message(GENERIC, 1, "doing clock adjustment (halving values) on raw track %d", track);
+	stage_enter(CLOCK);
 	for (i = 0; i < size; i++)
 		{
 		d1 = data[i];
@@ -264,6 +277,8 @@ image_raw_clock_adjust_half(
 		if ((d1 & GLOBAL_PULSE_INDEX_MASK) != 0) d2 |= GLOBAL_PULSE_INDEX_MASK;
 		data[i] = d2;
 		}
+	stage_count(CLOCK, size, size);
+	stage_leave();
 	}
 
 
@@ -275,14 +290,14 @@ static cw_size_t
 image_raw_read_track_data(
 	struct image_raw		*img_raw,
 	struct file			*fil,
-	struct track_header		*trk_hdr,
+	struct image_raw_header		*trk_hdr,
 	struct fifo			*ffo)
 
 	{
-	cw_size_t			size = sizeof (struct track_header);
+	cw_size_t			size = sizeof (struct image_raw_header);
 
 	if (file_read(fil, trk_hdr, size) == 0) return (0);
-	if (trk_hdr->magic != TRACK_MAGIC) error_message("wrong header magic in file '%s'", file_get_path(fil));
+	if (trk_hdr->magic != IMAGE_RAW_TRACK_MAGIC) error_message("wrong header magic in file '%s'", file_get_path(fil));
 	size = import_u32_le(trk_hdr->size);
 	if (size > fifo_get_limit(ffo)) error_message("track %d too large in file '%s'", trk_hdr->track, file_get_path(fil));
 	return (file_read_strict(fil, fifo_get_data(ffo), size));
@@ -290,6 +305,35 @@ image_raw_read_track_data(
 
 
 
+/****************************************************************************
+ * image_raw_read_track_pack
+ ****************************************************************************/
+static cw_size_t
+image_raw_read_track_pack(
+	struct image_raw		*img_raw,
+	struct file			*fil,
+	struct image_raw_header		*trk_hdr,
+	struct fifo			*ffo)
+
+	{
+	cw_size_t			size = sizeof (struct image_raw_header);
+
+	/*
+	 * the header contains the size of the packed data, afterwards it
+	 * contains the number of pulses like with SUBTYPE_DATA, so
+	 * image_raw_hint_store() can write it unchanged to the temporary
+	 * file
+	 */
+
+	if (file_read(fil, trk_hdr, size) == 0) return (0);
+	if (trk_hdr->magic != IMAGE_RAW_TRACK_MAGIC) error_message("wrong header magic in file '%s'", file_get_path(fil));
+	size = pack_decode(fil, import_u32_le(trk_hdr->size), fifo_get_data(ffo), fifo_get_limit(ffo));
+	export_u32_le(trk_hdr->size, size);
+	return (size);
+	}
+
+
+
 /****************************************************************************
  * image_raw_read_track_text
  ****************************************************************************/
@@ -297,7 +341,7 @@ static cw_size_t
 image_raw_read_track_text(
 	struct image_raw		*img_raw,
 	struct file			*fil,
-	struct track_header		*trk_hdr,
+	struct image_raw_header		*trk_hdr,
 	struct fifo			*ffo)
 
 	{
@@ -322,9 +366,9 @@ image_raw_read_track_text(
 		if (string_equal(token, "track_data_hex")) hex_only = CW_BOOL_TRUE;
 		else hex_only = CW_BOOL_FALSE;
 		if (! string_equal2(token, "track_data", "track_data_hex")) parse_error_invalid(&img_raw->prs, token);
-		*trk_hdr = (struct track_header)
+		*trk_hdr = (struct image_raw_header)
 			{
-			.magic = TRACK_MAGIC,
+			.magic = IMAGE_RAW_TRACK_MAGIC,
 			.track = parse_number(&img_raw->prs, NULL, 0),
 			.clock = parse_number(&img_raw->prs, NULL, 0),
 			.flags = parse_number(&img_raw->prs, NULL, 0)
@@ -363,34 +407,24 @@ image_raw_read_track_text(
 
 
 /****************************************************************************
- * image_raw_read_track2
+ * image_raw_read_track3
  ****************************************************************************/
 static cw_size_t
-image_raw_read_track2(
+image_raw_read_track3(
 	struct image_raw		*img_raw,
 	struct file			*fil,
 	struct image_track		*img_trk,
-	struct track_header		*trk_hdr,
+	struct image_raw_header		*trk_hdr,
 	struct fifo			*ffo,
-	cw_type_t			subtype)
+	cw_size_t			size)
 
 	{
-	cw_size_t			size;
 	cw_bool_t			do_correction = CW_BOOL_TRUE;
 
-	/* get data */
-
-	fifo_reset(ffo);
-	if (subtype == SUBTYPE_DATA) size = image_raw_read_track_data(img_raw, fil, trk_hdr, ffo);
-	else size = image_raw_read_track_text(img_raw, fil, trk_hdr, ffo);
-	if (size == 0) return (0);
-
-	if (trk_hdr->track >= GLOBAL_NR_TRACKS) error_message("invalid track in file '%s'", file_get_path(fil));
-	if (trk_hdr->clock >= CW_NR_CLOCKS) error_message("invalid clock in file '%s'", file_get_path(fil));
-	if (trk_hdr->flags & HEADER_FLAG_WRITABLE)      fifo_set_flags(ffo, FIFO_FLAG_WRITABLE);
-	if (trk_hdr->flags & HEADER_FLAG_INDEX_STORED)  fifo_set_flags(ffo, FIFO_FLAG_INDEX_STORED);
-	if (trk_hdr->flags & HEADER_FLAG_INDEX_ALIGNED) fifo_set_flags(ffo, FIFO_FLAG_INDEX_ALIGNED);
-	if (trk_hdr->flags & HEADER_FLAG_NO_CORRECTION) do_correction = CW_BOOL_FALSE;
+	if (trk_hdr->flags & IMAGE_RAW_HEADER_FLAG_WRITABLE)      fifo_set_flags(ffo, FIFO_FLAG_WRITABLE);
+	if (trk_hdr->flags & IMAGE_RAW_HEADER_FLAG_INDEX_STORED)  fifo_set_flags(ffo, FIFO_FLAG_INDEX_STORED);
+	if (trk_hdr->flags & IMAGE_RAW_HEADER_FLAG_INDEX_ALIGNED) fifo_set_flags(ffo, FIFO_FLAG_INDEX_ALIGNED);
+	if (trk_hdr->flags & IMAGE_RAW_HEADER_FLAG_NO_CORRECTION) do_correction = CW_BOOL_FALSE;
 
 	/*
 	 * strictly check flags. tracks generated for normal write cannot
@@ -400,7 +434,7 @@ image_raw_read_track2(
 	if (img_trk != NULL)
 		{
 		int			flag1 = (img_trk->flags & IMAGE_TRACK_FLAG_INDEXED_READ) ? 1 : 0;
-		int			flag2 = (trk_hdr->flags & HEADER_FLAG_INDEX_ALIGNED) ? 1 : 0;
+		int			flag2 = (trk_hdr->flags & IMAGE_RAW_HEADER_FLAG_INDEX_ALIGNED) ? 1 : 0;
 
 		if (flag1 != flag2) fifo_clear_flags(ffo, FIFO_FLAG_WRITABLE);
 		}
@@ -410,7 +444,7 @@ image_raw_read_track2(
 	 * versions of cwtool
 	 */
 
-	if ((trk_hdr->flags & HEADER_FLAG_WRITABLE) && (do_correction)) image_raw_read_correction(fifo_get_data(ffo), size, trk_hdr->track);
+	if ((trk_hdr->flags & IMAGE_RAW_HEADER_FLAG_WRITABLE) && (do_correction)) image_raw_read_correction(fifo_get_data(ffo), size, trk_hdr->track);
 
 	/*
 	 * if we have 14(28) MHz data but need 28(56) MHz just double values
@@ -434,6 +468,55 @@ image_raw_read_track2(
 
 
 
+/****************************************************************************
+ * image_raw_read_track1
+ ****************************************************************************/
+static cw_size_t
+image_raw_read_track1(
+	struct image_raw		*img_raw,
+	struct file			*fil,
+	struct image_raw_header		*trk_hdr,
+	struct fifo			*ffo,
+	cw_type_t			subtype)
+
+	{
+	cw_size_t			size;
+
+	/* get data */
+
+	fifo_reset(ffo);
+	if (subtype == SUBTYPE_DATA) size = image_raw_read_track_data(img_raw, fil, trk_hdr, ffo);
+	else if (subtype == SUBTYPE_PACK) size = image_raw_read_track_pack(img_raw, fil, trk_hdr, ffo);
+	else size = image_raw_read_track_text(img_raw, fil, trk_hdr, ffo);
+	if (size == 0) return (0);
+	if (trk_hdr->track >= GLOBAL_NR_TRACKS) error_message("invalid track in file '%s'", file_get_path(fil));
+	if (trk_hdr->clock >= CW_NR_CLOCKS) error_message("invalid clock in file '%s'", file_get_path(fil));
+	return (size);
+	}
+
+
+
+/****************************************************************************
+ * image_raw_read_track2
+ ****************************************************************************/
+static cw_size_t
+image_raw_read_track2(
+	struct image_raw		*img_raw,
+	struct file			*fil,
+	struct image_track		*img_trk,
+	struct image_raw_header		*trk_hdr,
+	struct fifo			*ffo,
+	cw_type_t			subtype)
+
+	{
+	cw_size_t			size = image_raw_read_track1(img_raw, fil, trk_hdr, ffo, subtype);
+
+	if (size == 0) return (0);
+	return (image_raw_read_track3(img_raw, fil, img_trk, trk_hdr, ffo, size));
+	}
+
+
+
 /****************************************************************************
  * image_raw_found
  ****************************************************************************/
@@ -441,12 +524,12 @@ static int
 image_raw_found(
 	struct image_raw		*img_raw,
 	struct image_track		*img_trk,
-	struct track_header		*trk_hdr,
+	struct image_raw_header		*trk_hdr,
 	int				track)
 
 	{
 	int				flag1 = (img_trk->flags & IMAGE_TRACK_FLAG_INDEXED_READ) ? 1 : 0;
-	int				flag2 = (trk_hdr->flags & HEADER_FLAG_INDEX_ALIGNED) ? 1 : 0;
+	int				flag2 = (trk_hdr->flags & IMAGE_RAW_HEADER_FLAG_INDEX_ALIGNED) ? 1 : 0;
 	cw_bool_t			clock_ok = CW_BOOL_FALSE;
 
 	/*
@@ -483,7 +566,7 @@ image_raw_found(
 static void
 image_raw_hint_store(
 	struct image_raw		*img_raw,
-	struct track_header		*trk_hdr,
+	struct image_raw_header		*trk_hdr,
 	struct fifo			*ffo,
 	int				size,
 	int				offset)
@@ -498,7 +581,7 @@ image_raw_hint_store(
 		verbose_message(GENERIC, 1, "appending track to '%s'", file_get_path(&img_raw->fil[1]));
 		file   = 2;
 		offset = file_seek(&img_raw->fil[1], -1, FILE_FLAG_NONE);
-		file_write(&img_raw->fil[1], trk_hdr, sizeof (struct track_header));
+		file_write(&img_raw->fil[1], trk_hdr, sizeof (struct image_raw_header));
 		file_write(&img_raw->fil[1], fifo_get_data(ffo), size);
 		}
 	debug_message(GENERIC, 2, "appending hint, hints = %d file = %d, track = %d, offset = %d", img_raw->hints, file, trk_hdr->track, offset);
@@ -525,7 +608,7 @@ image_raw_hint_search(
 	int				track)
 
 	{
-	struct track_header		trk_hdr;
+	struct image_raw_header		trk_hdr;
 	int				file, h;
 	cw_type_t			subtype;
 
@@ -535,10 +618,10 @@ image_raw_hint_search(
 		/*
 		 * UGLY: not very clean, better give needed parameters
 		 *       directly to image_raw_found instead using
-		 *       struct track_header
+		 *       struct image_raw_header
 		 */
 
-		trk_hdr = (struct track_header)
+		trk_hdr = (struct image_raw_header)
 			{
 			.track = img_raw->hnt[h].track,
 			.clock = img_raw->hnt[h].clock,
@@ -599,6 +682,183 @@ image_raw_hint_invalidate(
 
 
 
+/****************************************************************************
+ * image_raw_index_build
+ ****************************************************************************/
+static void
+image_raw_index_build(
+	struct image_raw		*img_raw)
+
+	{
+	struct file			*fil = &img_raw->fil[0];
+	struct image_raw_index		*idx;
+	struct image_raw_header		trk_hdr;
+	cw_raw8_t			byte;
+	int				last[GLOBAL_NR_TRACKS];
+	int				i, offset, size;
+
+	/*
+	 * read only the track headers of the whole file. if a header is
+	 * broken or the data is truncated, the index stops there and
+	 * image_raw_index_search() lets the sequential code report the
+	 * error, when it would have reached this position
+	 */
+
+	for (i = 0; i < GLOBAL_NR_TRACKS; i++) img_raw->index_first[i] = last[i] = -1;
+	img_raw->index_end = -1;
+	for (offset = MAGIC_SIZE; ; offset += sizeof (struct image_raw_header) + size)
+		{
+		size = file_pread(fil, &trk_hdr, sizeof (struct image_raw_header), offset);
+		if (size == 0) break;
+		img_raw->index_end = offset;
+		if (size != sizeof (struct image_raw_header)) break;
+		size = import_u32_le(trk_hdr.size);
+		if ((trk_hdr.magic != IMAGE_RAW_TRACK_MAGIC) || (trk_hdr.track >= GLOBAL_NR_TRACKS) ||
+			(trk_hdr.clock >= CW_NR_CLOCKS) || (size < 0) || (size > GLOBAL_MAX_TRACK_SIZE)) break;
+		if ((size > 0) && (file_pread(fil, &byte, 1, offset + sizeof (struct image_raw_header) + size - 1) != 1)) break;
+		img_raw->index_end = -1;
+
+		/* a track without data is taken as end of file while reading */
+
+		if (size == 0) break;
+		if (img_raw->indices >= img_raw->index_limit)
+			{
+			img_raw->index_limit = 2 * img_raw->index_limit + IMAGE_RAW_NR_HINTS;
+			img_raw->idx = realloc(img_raw->idx, img_raw->index_limit * sizeof (struct image_raw_index));
+			if (img_raw->idx == NULL) error_oom();
+			}
+		i = img_raw->indices++;
+		idx = &img_raw->idx[i];
+		*idx = (struct image_raw_index)
+			{
+			.track  = trk_hdr.track,
+			.clock  = trk_hdr.clock,
+			.flags  = trk_hdr.flags,
+			.next   = -1,
+			.offset = offset,
+			.size   = size
+			};
+		if (last[idx->track] == -1) img_raw->index_first[idx->track] = i;
+		else img_raw->idx[last[idx->track]].next = i;
+		last[idx->track] = i;
+		}
+	img_raw->flags |= FLAG_INDEXED;
+	verbose_message(GENERIC, 1, "indexed %d raw tracks in '%s'", img_raw->indices, file_get_path(fil));
+	}
+
+
+
+/****************************************************************************
+ * image_raw_index_read
+ ****************************************************************************/
+static cw_size_t
+image_raw_index_read(
+	struct image_raw		*img_raw,
+	struct image_track		*img_trk,
+	struct image_raw_header		*trk_hdr,
+	struct fifo			*ffo,
+	int				i)
+
+	{
+	struct image_raw_index		*idx = &img_raw->idx[i];
+	struct file			*fil = &img_raw->fil[0];
+	cw_size_t			size = idx->size;
+
+	idx->used = 1;
+	fifo_reset(ffo);
+	verbose_message(GENERIC, 1, "reading raw track %d from '%s'", idx->track, file_get_path(fil));
+
+	/* packed tracks are decoded while reading them */
+
+	if (img_raw->subtype == SUBTYPE_PACK)
+		{
+		file_seek(fil, idx->offset + sizeof (struct image_raw_header), FILE_FLAG_NONE);
+		size = pack_decode(fil, idx->size, fifo_get_data(ffo), fifo_get_limit(ffo));
+		}
+	else
+		{
+		if (size > fifo_get_limit(ffo)) error_message("track %d too large in file '%s'", idx->track, file_get_path(fil));
+		file_pread_strict(fil, fifo_get_data(ffo), size, idx->offset + sizeof (struct image_raw_header));
+		}
+	return (image_raw_read_track3(img_raw, fil, img_trk, trk_hdr, ffo, size));
+	}
+
+
+
+/****************************************************************************
+ * image_raw_index_search
+ ****************************************************************************/
+static int
+image_raw_index_search(
+	struct image_raw		*img_raw,
+	struct image_track		*img_trk,
+	struct fifo			*ffo,
+	int				track)
+
+	{
+	struct image_raw_index		*idx;
+	struct image_raw_header		trk_hdr;
+	int				i;
+
+	/*
+	 * the index emulates the sequential reading of image_raw_read_track().
+	 * index_pos is the position the file would have been read to, all
+	 * unused entries before index_pos would have been stored as hints
+	 */
+
+	for (i = img_raw->index_first[track]; i != -1; i = idx->next)
+		{
+		idx = &img_raw->idx[i];
+		trk_hdr = (struct image_raw_header)
+			{
+			.track = idx->track,
+			.clock = idx->clock,
+			.flags = idx->flags
+			};
+		if ((idx->used) || (i < img_raw->index_pos)) continue;
+		if (! image_raw_found(img_raw, img_trk, &trk_hdr, track)) continue;
+		img_raw->index_pos = i + 1;
+		return (image_raw_index_read(img_raw, img_trk, &trk_hdr, ffo, i));
+		}
+
+	/*
+	 * if the index stopped at a broken track, read it sequentially to
+	 * get the same error message
+	 */
+
+	if (img_raw->index_end != -1)
+		{
+		file_seek(&img_raw->fil[0], img_raw->index_end, FILE_FLAG_NONE);
+		img_raw->flags &= ~FLAG_INDEXED;
+		return (-2);
+		}
+	img_raw->index_pos = img_raw->indices;
+
+	/* hints of tracks already done are invalidated */
+
+	if (! (img_raw->track_flags[track] & TRACK_FLAG_DONE))
+		{
+		for (i = img_raw->index_first[track]; i != -1; i = idx->next)
+			{
+			idx = &img_raw->idx[i];
+			trk_hdr = (struct image_raw_header)
+				{
+				.track = idx->track,
+				.clock = idx->clock,
+				.flags = idx->flags
+				};
+			if (idx->used) continue;
+			if (! image_raw_found(img_raw, img_trk, &trk_hdr, track)) continue;
+			return (image_raw_index_read(img_raw, img_trk, &trk_hdr, ffo, i));
+			}
+		}
+	if ((! (img_trk->flags & IMAGE_TRACK_FLAG_OPTIONAL)) && (! (img_raw->track_flags[track] & TRACK_FLAG_FOUND)))
+		error_warning("track %d not found in file '%s'", track, file_get_path(&img_raw->fil[0]));
+	return (-1);
+	}
+
+
+
 /****************************************************************************
  * image_raw_read_track
  ****************************************************************************/
@@ -610,9 +870,14 @@ image_raw_read_track(
 	int				track)
 
 	{
-	struct track_header		trk_hdr;
+	struct image_raw_header		trk_hdr;
 	int				size, offset = 0;
 
+	if (img_raw->flags & FLAG_INDEXED)
+		{
+		size = image_raw_index_search(img_raw, img_trk, ffo, track);
+		if (size != -2) return (size);
+		}
 	while (1)
 		{
 
@@ -701,7 +966,7 @@ image_raw_write_flags(
 	{
 	int				flags_in1 = fifo_get_flags(ffo);
 	int				flags_in2 = img_trk->flags;
-	int				flags_out = HEADER_FLAG_NO_CORRECTION;
+	int				flags_out = IMAGE_RAW_HEADER_FLAG_NO_CORRECTION;
 
 	/*
 	 * if input data was also raw, we get all needed flags with
@@ -709,10 +974,10 @@ image_raw_write_flags(
 	 * would be written index aligned on a real catweasel device
 	 */
 
-	if (flags_in1 & FIFO_FLAG_WRITABLE)             flags_out |= HEADER_FLAG_WRITABLE;
-	if (flags_in1 & FIFO_FLAG_INDEX_STORED)         flags_out |= HEADER_FLAG_INDEX_STORED;
-	if (flags_in1 & FIFO_FLAG_INDEX_ALIGNED)        flags_out |= HEADER_FLAG_INDEX_ALIGNED;
-	if (flags_in2 & IMAGE_TRACK_FLAG_INDEXED_WRITE) flags_out |= HEADER_FLAG_INDEX_ALIGNED;
+	if (flags_in1 & FIFO_FLAG_WRITABLE)             flags_out |= IMAGE_RAW_HEADER_FLAG_WRITABLE;
+	if (flags_in1 & FIFO_FLAG_INDEX_STORED)         flags_out |= IMAGE_RAW_HEADER_FLAG_INDEX_STORED;
+	if (flags_in1 & FIFO_FLAG_INDEX_ALIGNED)        flags_out |= IMAGE_RAW_HEADER_FLAG_INDEX_ALIGNED;
+	if (flags_in2 & IMAGE_TRACK_FLAG_INDEXED_WRITE) flags_out |= IMAGE_RAW_HEADER_FLAG_INDEX_ALIGNED;
 	return (flags_out);
 	}
 
@@ -743,6 +1008,7 @@ image_raw_open(
 	static const char		magic_data2[MAGIC_SIZE] = "cwtool raw data 2";
 	static const char		magic_data3[MAGIC_SIZE] = "cwtool raw data 3";
 	static const char		magic_text3[MAGIC_SIZE] = "# cwtool raw text 3\n";
+	static const char		magic_pack1[MAGIC_SIZE] = "cwtool raw pack 1";
 	char				buffer[MAGIC_SIZE], *type_name, *subtype_name;
 	int				i;
 
@@ -778,6 +1044,7 @@ image_raw_open(
 			if (buffer[i] == magic_data2[i]) continue;
 			if (buffer[i] == magic_data3[i]) continue;
 			if (buffer[i] == magic_text3[i]) continue;
+			if (buffer[i] == magic_pack1[i]) continue;
 			if (magic_text3[i] == '\0')
 				{
 				img->raw.subtype = SUBTYPE_TEXT;
@@ -785,6 +1052,11 @@ image_raw_open(
 				}
 			error_message("file '%s' has wrong magic", file_get_path(&img->raw.fil[0]));
 			}
+		if (memcmp(buffer, magic_pack1, MAGIC_SIZE) == 0)
+			{
+			subtype_name     = " (packed)";
+			img->raw.subtype = SUBTYPE_PACK;
+			}
 		if (img->raw.subtype == SUBTYPE_TEXT)
 			{
 			subtype_name = " (text)";
@@ -803,6 +1075,19 @@ image_raw_open(
 			if (img->raw.type == TYPE_REGULAR) file_seek(&img->raw.fil[0], 0, FILE_FLAG_NONE);
 			else parse_fill_text_buffer(&img->raw.prs, buffer, MAGIC_SIZE);
 			}
+
+		/*
+		 * regular files with raw data get an index, so tracks can be
+		 * read in any order without reading the file again and again
+		 */
+
+		else if (img->raw.type == TYPE_REGULAR) image_raw_index_build(&img->raw);
+		}
+	else if (options_get_raw_pack())
+		{
+		subtype_name     = " (packed)";
+		img->raw.subtype = SUBTYPE_PACK;
+		file_write(&img->raw.fil[0], magic_pack1, MAGIC_SIZE);
 		}
 	else file_write(&img->raw.fil[0], magic_data3, MAGIC_SIZE);
 done:
@@ -820,7 +1105,7 @@ image_raw_close(
 	union image			*img)
 
 	{
-	struct track_header		trk_hdr;
+	struct image_raw_header		trk_hdr;
 	unsigned char			data[GLOBAL_MAX_TRACK_SIZE];
 	struct fifo			ffo = FIFO_INIT(data, sizeof (data));
 
@@ -831,6 +1116,7 @@ image_raw_close(
 		while (image_raw_read_track2(&img->raw, &img->raw.fil[0], NULL, &trk_hdr, &ffo, img->raw.subtype) > 0) ;
 		file_close(&img->raw.fil[1]);
 		}
+	if (img->raw.idx != NULL) free(img->raw.idx);
 	return (image_close(img, &img->raw.fil[0]));
 	}
 
@@ -868,6 +1154,28 @@ image_raw_offset(
 
 
 
+/****************************************************************************
+ * image_raw_read_limit
+ ****************************************************************************/
+static int
+image_raw_read_limit(
+	struct fifo			*ffo,
+	int				size,
+	int				track)
+
+	{
+	if (size < GLOBAL_MIN_TRACK_SIZE) error_warning("got only %d bytes while reading track %d", size, track);
+	if (size > options_get_track_size_limit())
+		{
+		size = options_get_track_size_limit();
+		verbose_message(GENERIC, 1, "truncating track according to track_size_limit to %d bytes", size);
+		}
+	fifo_set_wr_ofs(ffo, size);
+	return (1);
+	}
+
+
+
 /****************************************************************************
  * image_raw_read
  ****************************************************************************/
@@ -897,14 +1205,50 @@ image_raw_read(
 		}
 	else size = image_raw_read_track(&img->raw, img_trk, ffo, track);
 	if (size == -1) return (0);
-	if (size < GLOBAL_MIN_TRACK_SIZE) error_warning("got only %d bytes while reading track %d", size, track);
-	if (size > options_get_track_size_limit())
+	return (image_raw_read_limit(ffo, size, track));
+	}
+
+
+
+/****************************************************************************
+ * image_raw_read_next
+ ****************************************************************************/
+static int
+image_raw_read_next(
+	union image			*img,
+	struct image_track		**img_trk,
+	struct fifo			*ffo,
+	int				*track)
+
+	{
+	struct image_raw		*img_raw = &img->raw;
+	struct file			*fil = &img_raw->fil[0];
+	struct image_raw_header		trk_hdr;
+	int				size, t;
+
+	/*
+	 * returns the next track of the pipe, which is still wanted. img_trk[]
+	 * is indexed by cwtool track and is NULL for all tracks not wanted
+	 * anymore. unwanted raw tracks are skipped, not stored as hints
+	 */
+
+	debug_error_condition(img_raw->type != TYPE_PIPE);
+	while (1)
 		{
-		size = options_get_track_size_limit();
-		verbose_message(GENERIC, 1, "truncating track according to track_size_limit to %d bytes", size);
+		size = image_raw_read_track1(img_raw, fil, &trk_hdr, ffo, img_raw->subtype);
+		if (size == 0) return (0);
+		verbose_message(GENERIC, 1, "got raw track %d with %d bytes from '%s'", trk_hdr.track, size, file_get_path(fil));
+		for (t = 0; t < GLOBAL_NR_TRACKS; t++)
+			{
+			if (img_trk[t] == NULL) continue;
+			if (image_raw_found(img_raw, img_trk[t], &trk_hdr, image_raw_track_translate2(img_trk[t], t))) break;
+			}
+		if (t < GLOBAL_NR_TRACKS) break;
+		verbose_message(GENERIC, 1, "skipping raw track %d, it is not wanted", trk_hdr.track);
 		}
-	fifo_set_wr_ofs(ffo, size);
-	return (1);
+	*track = t;
+	size = image_raw_read_track3(img_raw, fil, img_trk[t], &trk_hdr, ffo, size);
+	return (image_raw_read_limit(ffo, size, trk_hdr.track));
 	}
 
 
@@ -942,18 +1286,28 @@ image_raw_write(
 		}
 	else 
 		{
-		struct track_header	trk_hdr =
+		struct image_raw_header	trk_hdr =
 			{
-			.magic = TRACK_MAGIC,
+			.magic = IMAGE_RAW_TRACK_MAGIC,
 			.track = track,
 			.clock = img_trk->clock,
 			.flags = image_raw_write_flags(img_trk, ffo)
 			};
 
-		export_u32_le(trk_hdr.size, size);
+		cw_raw8_t		*data = fifo_get_data(ffo);
+		cw_size_t		size_data = size;
+
+		if (img->raw.subtype == SUBTYPE_PACK)
+			{
+			data = scratch_get(PACK_MAX_SIZE(size));
+			size_data = pack_encode(fifo_get_data(ffo), size, data);
+			verbose_message(GENERIC, 1, "packed raw track %d from %d to %d bytes", track, size, size_data);
+			}
+		export_u32_le(trk_hdr.size, size_data);
 		verbose_message(GENERIC, 1, "writing raw track %d with %d bytes to '%s'", track, size, file_get_path(&img->raw.fil[0]));
 		file_write(&img->raw.fil[0], &trk_hdr, sizeof (trk_hdr));
-		file_write(&img->raw.fil[0], fifo_get_data(ffo), size);
+		file_write(&img->raw.fil[0], data, size_data);
+		if (data != fifo_get_data(ffo)) scratch_put(data);
 		}
 	if (size == -1) return (0);
 	if (size < fifo_get_wr_ofs(ffo)) error_warning("could not write full track %d, write timed out", track);
@@ -981,6 +1335,44 @@ image_raw_done(
 
 
 
+/****************************************************************************
+ * image_raw_offline
+ ****************************************************************************/
+static int
+image_raw_offline(
+	union image			*img)
+
+	{
+
+	/*
+	 * tracks from files or pipes may be read ahead of decoding, with a
+	 * catweasel device each read accesses the disk
+	 */
+
+	return ((img->raw.type != TYPE_DEVICE) ? 1 : 0);
+	}
+
+
+
+/****************************************************************************
+ * image_raw_streamed
+ ****************************************************************************/
+static int
+image_raw_streamed(
+	union image			*img)
+
+	{
+
+	/*
+	 * pipes can not seek, their tracks are decoded in the order they
+	 * arrive with image_raw_read_next()
+	 */
+
+	return ((img->raw.type == TYPE_PIPE) ? 1 : 0);
+	}
+
+
+
 
 /****************************************************************************
  *
@@ -991,6 +1383,28 @@ image_raw_done(
 
 
 
+/****************************************************************************
+ * image_raw_read_stored
+ ****************************************************************************/
+int
+image_raw_read_stored(
+	union image			*img,
+	struct image_raw_header		*trk_hdr,
+	struct fifo			*ffo)
+
+	{
+
+	/*
+	 * returns the next track in file order as it is stored, without
+	 * corrections or clock adjustment. used by the catweasel emulation,
+	 * which needs all tracks of an image opened with IMAGE_MODE_READ
+	 */
+
+	return (image_raw_read_track1(&img->raw, &img->raw.fil[0], trk_hdr, ffo, img->raw.subtype));
+	}
+
+
+
 /****************************************************************************
  * image_raw_desc
  ****************************************************************************/
@@ -1004,6 +1418,9 @@ struct image_desc			image_raw_desc =
 	.offset      = image_raw_offset,
 	.track_read  = image_raw_read,
 	.track_write = image_raw_write,
-	.track_done  = image_raw_done
+	.track_done  = image_raw_done,
+	.offline     = image_raw_offline,
+	.streamed    = image_raw_streamed,
+	.track_next  = image_raw_read_next
 	};
 /******************************************************** Karsten Scheibler */
@@ -17,8 +17,29 @@
 #include "../global.h"
 #include "../file.h"
 #include "../parse.h"
+#include "../fifo.h"
 #include "desc.h"
 
+/*
+ * each track in a raw image with data starts with this header, size is
+ * stored little endian. in packed images it is the size of the packed data
+ */
+
+#define IMAGE_RAW_TRACK_MAGIC			0xca
+#define IMAGE_RAW_HEADER_FLAG_WRITABLE		(1 << 0)
+#define IMAGE_RAW_HEADER_FLAG_INDEX_STORED	(1 << 1)
+#define IMAGE_RAW_HEADER_FLAG_INDEX_ALIGNED	(1 << 2)
+#define IMAGE_RAW_HEADER_FLAG_NO_CORRECTION	(1 << 3)
+
+struct image_raw_header
+	{
+	unsigned char			magic;
+	unsigned char			track;
+	unsigned char			clock;
+	unsigned char			flags;
+	unsigned char			size[4];
+	};
+
 /* number of retries + first read == GLOBAL_NR_RETRIES + 1 */
 
 #define IMAGE_RAW_NR_HINTS		((GLOBAL_NR_RETRIES + 1) * GLOBAL_NR_TRACKS)
@@ -32,6 +53,22 @@ struct image_raw_hint
 	int				offset;
 	};
 
+/*
+ * index of all tracks in a regular file with raw data, entries are in file
+ * order and chained per track
+ */
+
+struct image_raw_index
+	{
+	unsigned char			track;
+	unsigned char			clock;
+	unsigned char			flags;
+	unsigned char			used;
+	int				next;
+	int				offset;
+	int				size;
+	};
+
 struct image_raw_text
 	{
 	cw_char_t			*text;
@@ -52,11 +89,18 @@ struct image_raw
 	int				subtype;
 	int				flags;
 	int				track_flags[GLOBAL_NR_TRACKS];
+	struct image_raw_index		*idx;
+	int				indices;
+	int				index_limit;
+	int				index_pos;
+	int				index_end;
+	int				index_first[GLOBAL_NR_TRACKS];
 	struct image_raw_text		txt;
 	struct parse			prs;
 	};
 
 extern struct image_desc		image_raw_desc;
+extern int				image_raw_read_stored(union image *, struct image_raw_header *, struct fifo *);
 
 
 
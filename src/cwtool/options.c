@@ -159,6 +159,33 @@ options_get_clock_adjust(
 
 
 
+/****************************************************************************
+ * options_set_raw_pack
+ ****************************************************************************/
+cw_bool_t
+options_set_raw_pack(
+	cw_bool_t			value)
+
+	{
+	opt.raw_pack = (value != 0) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * options_get_raw_pack
+ ****************************************************************************/
+cw_bool_t
+options_get_raw_pack(
+	cw_void_t)
+
+	{
+	return (opt.raw_pack);
+	}
+
+
+
 /****************************************************************************
  * options_set_output
  ****************************************************************************/
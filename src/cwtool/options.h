@@ -33,6 +33,7 @@ struct options
 	cw_bool_t			histogram_context;
 	cw_bool_t			always_initialize;
 	cw_bool_t			clock_adjust;
+	cw_bool_t			raw_pack;
 	cw_bool_t			output;
 	cw_count_t			disk_track_start;
 	cw_count_t			disk_track_end;
@@ -85,6 +86,14 @@ extern cw_bool_t
 options_get_clock_adjust(
 	cw_void_t);
 
+extern cw_bool_t
+options_set_raw_pack(
+	cw_bool_t			value);
+
+extern cw_bool_t
+options_get_raw_pack(
+	cw_void_t);
+
 extern cw_bool_t
 options_set_output(
 	cw_bool_t			value);
@@ -0,0 +1,522 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * pack.c
+ *
+ ****************************************************************************
+ *
+ * entropy coding of raw tracks. most pulse lengths of a track fall into a
+ * few histogram peaks, so each track gets its own huffman codes built from
+ * its histogram. the context (the peak the previous pulse belongs to)
+ * selects one of PACK_NR_CONTEXTS code tables. pulse values are coded
+ * unchanged including the index bit, so decoding gives back exactly the
+ * same track
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pack.h"
+#include "error.h"
+#include "debug.h"
+#include "verbose.h"
+#include "global.h"
+#include "file.h"
+#include "scratch.h"
+#include "import.h"
+#include "export.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+struct pack_leaf
+	{
+	cw_count_t			count;
+	cw_index_t			symbol;
+	};
+
+struct pack_writer
+	{
+	cw_raw8_t			*dst;
+	cw_size_t			ofs;
+	cw_u64_t			bits;
+	cw_count_t			count;
+	};
+
+struct pack_reader
+	{
+	struct file			*fil;
+	cw_raw8_t			buffer[PACK_BUFFER_SIZE];
+	cw_index_t			ofs;
+	cw_size_t			len;
+	cw_size_t			remain;
+	cw_count_t			pad;
+	cw_u64_t			bits;
+	cw_count_t			count;
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * pack_context_map
+ ****************************************************************************/
+static cw_void_t
+pack_context_map(
+	cw_raw8_t			*bound,
+	cw_count_t			contexts,
+	cw_raw8_t			*map)
+
+	{
+	cw_index_t			c, i;
+
+	for (i = 0; i < PACK_NR_SYMBOLS; i++)
+		{
+		for (c = 0; (c < contexts - 1) && (i > bound[c]); c++) ;
+		map[i] = c;
+		}
+	}
+
+
+
+/****************************************************************************
+ * pack_context_bounds
+ ****************************************************************************/
+static cw_void_t
+pack_context_bounds(
+	cw_raw8_t			*data,
+	cw_size_t			size,
+	cw_raw8_t			*bound)
+
+	{
+	cw_count_t			histogram[PACK_NR_SYMBOLS] = { };
+	cw_count64_t			sum;
+	cw_index_t			c, i;
+
+	/*
+	 * each context gets about the same number of pulses, so the bounds
+	 * end up between the histogram peaks
+	 */
+
+	for (i = 0; i < size; i++) histogram[data[i]]++;
+	for (c = 0; c < PACK_NR_CONTEXTS - 1; c++) bound[c] = PACK_NR_SYMBOLS - 1;
+	for (i = 0, sum = 0; i < PACK_NR_SYMBOLS; sum += histogram[i++])
+		{
+		c = sum * PACK_NR_CONTEXTS / ((size > 0) ? size : 1);
+		if (c >= PACK_NR_CONTEXTS) c = PACK_NR_CONTEXTS - 1;
+		while ((c > 0) && (bound[c - 1] == PACK_NR_SYMBOLS - 1)) bound[--c] = i - 1;
+		}
+	}
+
+
+
+/****************************************************************************
+ * pack_compare
+ ****************************************************************************/
+static int
+pack_compare(
+	const void			*a,
+	const void			*b)
+
+	{
+	const struct pack_leaf		*lef_a = (const struct pack_leaf *) a;
+	const struct pack_leaf		*lef_b = (const struct pack_leaf *) b;
+
+	if (lef_a->count != lef_b->count) return ((lef_a->count < lef_b->count) ? -1 : 1);
+	return (lef_a->symbol - lef_b->symbol);
+	}
+
+
+
+/****************************************************************************
+ * pack_lengths2
+ ****************************************************************************/
+static cw_count_t
+pack_lengths2(
+	cw_count_t			*count,
+	cw_raw8_t			*length)
+
+	{
+	struct pack_leaf		lef[PACK_NR_SYMBOLS];
+	cw_count_t			weight[2 * PACK_NR_SYMBOLS];
+	cw_index_t			parent[2 * PACK_NR_SYMBOLS];
+	cw_count_t			depth[2 * PACK_NR_SYMBOLS];
+	cw_count_t			n, max;
+	cw_index_t			i, l, m, nodes, child[2];
+
+	/*
+	 * huffman with two queues, the sorted leaves and the inner nodes,
+	 * which are created with increasing weights. leaves are nodes
+	 * 0 ... n - 1, inner nodes follow
+	 */
+
+	for (i = n = 0; i < PACK_NR_SYMBOLS; i++)
+		{
+		length[i] = 0;
+		if (count[i] > 0) lef[n++] = (struct pack_leaf) { .count = count[i], .symbol = i };
+		}
+	if (n == 0) return (0);
+	if (n == 1)
+		{
+		length[lef[0].symbol] = 1;
+		return (1);
+		}
+	qsort(lef, n, sizeof (struct pack_leaf), pack_compare);
+	for (i = 0; i < n; i++) weight[i] = lef[i].count;
+	for (l = 0, m = nodes = n; nodes < 2 * n - 1; nodes++)
+		{
+		for (i = 0; i < 2; i++)
+			{
+			if ((l < n) && ((m >= nodes) || (weight[l] <= weight[m]))) child[i] = l++;
+			else child[i] = m++;
+			}
+		weight[nodes] = weight[child[0]] + weight[child[1]];
+		parent[child[0]] = parent[child[1]] = nodes;
+		}
+	depth[nodes - 1] = 0;
+	for (i = nodes - 2, max = 0; i >= 0; i--)
+		{
+		depth[i] = depth[parent[i]] + 1;
+		if ((i < n) && (depth[i] > max)) max = depth[i];
+		}
+	for (i = 0; i < n; i++) length[lef[i].symbol] = depth[i];
+	return (max);
+	}
+
+
+
+/****************************************************************************
+ * pack_lengths
+ ****************************************************************************/
+static cw_void_t
+pack_lengths(
+	cw_count_t			*count,
+	cw_raw8_t			*length)
+
+	{
+	cw_index_t			i;
+
+	/* flatten the distribution until no code is longer than allowed */
+
+	while (pack_lengths2(count, length) > PACK_MAX_BITS)
+		{
+		for (i = 0; i < PACK_NR_SYMBOLS; i++) if (count[i] > 0) count[i] = (count[i] + 1) / 2;
+		}
+	}
+
+
+
+/****************************************************************************
+ * pack_codes
+ ****************************************************************************/
+static cw_bool_t
+pack_codes(
+	cw_raw8_t			*length,
+	cw_u16_t			*code,
+	struct pack_table		*tbl)
+
+	{
+	cw_count_t			codes[PACK_MAX_BITS + 1] = { };
+	cw_u16_t			next[PACK_MAX_BITS + 1];
+	cw_index_t			first[PACK_MAX_BITS + 1];
+	cw_index_t			i, j, l, c;
+
+	/* canonical codes, shorter codes first, same lengths by symbol */
+
+	for (i = 0; i < PACK_NR_SYMBOLS; i++) codes[length[i]]++;
+	codes[0] = 0;
+	for (l = 1, c = 0, j = 0; l <= PACK_MAX_BITS; l++)
+		{
+		c = (c + ((l > 1) ? codes[l - 1] : 0)) << 1;
+		if (c + codes[l] > (1 << l)) return (CW_BOOL_FAIL);
+		next[l]  = c;
+		first[l] = j;
+		j += codes[l];
+		}
+	if (tbl != NULL)
+		{
+		for (l = 1; l <= PACK_MAX_BITS; l++)
+			{
+			tbl->first_code[l]  = next[l];
+			tbl->first_index[l] = first[l];
+			tbl->codes[l]       = codes[l];
+			}
+		for (i = 0; i < (1 << PACK_LOOKUP_BITS); i++) tbl->lookup[i] = 0;
+		}
+	for (i = 0; i < PACK_NR_SYMBOLS; i++)
+		{
+		l = length[i];
+		if (l == 0) continue;
+		c = next[l]++;
+		if (code != NULL) code[i] = c;
+		if (tbl == NULL) continue;
+		tbl->symbol[first[l]++] = i;
+		if (l > PACK_LOOKUP_BITS) continue;
+
+		/* all lookup entries starting with this code */
+
+		for (j = 0; j < (1 << (PACK_LOOKUP_BITS - l)); j++) tbl->lookup[(c << (PACK_LOOKUP_BITS - l)) | j] = (l << 8) | i;
+		}
+	return (CW_BOOL_OK);
+	}
+
+
+
+/****************************************************************************
+ * pack_write_bits
+ ****************************************************************************/
+static cw_void_t
+pack_write_bits(
+	struct pack_writer		*wrt,
+	cw_u32_t			value,
+	cw_count_t			bits)
+
+	{
+	wrt->bits = (wrt->bits << bits) | value;
+	wrt->count += bits;
+	while (wrt->count >= 8)
+		{
+		wrt->count -= 8;
+		wrt->dst[wrt->ofs++] = wrt->bits >> wrt->count;
+		}
+	}
+
+
+
+/****************************************************************************
+ * pack_read_byte
+ ****************************************************************************/
+static cw_raw8_t
+pack_read_byte(
+	struct pack_reader		*rdr)
+
+	{
+
+	/*
+	 * the packed data is read in blocks, but never more than belongs
+	 * to this track. beyond the end zeros are returned, so the bit
+	 * buffer may be filled ahead
+	 */
+
+	if (rdr->ofs >= rdr->len)
+		{
+		if (rdr->remain == 0)
+			{
+			rdr->pad++;
+			return (0);
+			}
+		rdr->len = (rdr->remain < PACK_BUFFER_SIZE) ? rdr->remain : PACK_BUFFER_SIZE;
+		rdr->ofs = 0;
+		file_read_strict(rdr->fil, rdr->buffer, rdr->len);
+		rdr->remain -= rdr->len;
+		}
+	return (rdr->buffer[rdr->ofs++]);
+	}
+
+
+
+/****************************************************************************
+ * pack_read_fill
+ ****************************************************************************/
+static cw_void_t
+pack_read_fill(
+	struct pack_reader		*rdr)
+
+	{
+	while (rdr->count <= 56)
+		{
+		rdr->bits |= (cw_u64_t) pack_read_byte(rdr) << (56 - rdr->count);
+		rdr->count += 8;
+		}
+	}
+
+
+
+/****************************************************************************
+ * pack_read_symbol
+ ****************************************************************************/
+static cw_index_t
+pack_read_symbol(
+	struct pack_reader		*rdr,
+	struct pack_table		*tbl)
+
+	{
+	cw_u16_t			e;
+	cw_u32_t			c;
+	cw_index_t			l;
+
+	if (rdr->count < PACK_MAX_BITS) pack_read_fill(rdr);
+	e = tbl->lookup[rdr->bits >> (64 - PACK_LOOKUP_BITS)];
+	if (e != 0)
+		{
+		l = e >> 8;
+		rdr->bits <<= l;
+		rdr->count -= l;
+		return (e & 0xff);
+		}
+
+	/* codes longer than the lookup table, slow but rare */
+
+	for (l = PACK_LOOKUP_BITS + 1; l <= PACK_MAX_BITS; l++)
+		{
+		c = rdr->bits >> (64 - l);
+		if (c - tbl->first_code[l] >= tbl->codes[l]) continue;
+		rdr->bits <<= l;
+		rdr->count -= l;
+		return (tbl->symbol[tbl->first_index[l] + c - tbl->first_code[l]]);
+		}
+	return (-1);
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * pack_encode
+ ****************************************************************************/
+cw_size_t
+pack_encode(
+	cw_raw8_t			*data,
+	cw_size_t			size,
+	cw_raw8_t			*dst)
+
+	{
+	struct pack_writer		wrt = { .dst = dst };
+	cw_count_t			count[PACK_NR_CONTEXTS][PACK_NR_SYMBOLS] = { };
+	cw_raw8_t			length[PACK_NR_CONTEXTS][PACK_NR_SYMBOLS];
+	cw_u16_t			code[PACK_NR_CONTEXTS][PACK_NR_SYMBOLS];
+	cw_raw8_t			bound[PACK_NR_CONTEXTS - 1];
+	cw_raw8_t			map[PACK_NR_SYMBOLS];
+	cw_index_t			c, i, p;
+
+	/* model of this track */
+
+	pack_context_bounds(data, size, bound);
+	pack_context_map(bound, PACK_NR_CONTEXTS, map);
+	for (i = 0, p = 0; i < size; p = data[i++]) count[map[p]][data[i]]++;
+	for (c = 0; c < PACK_NR_CONTEXTS; c++)
+		{
+		pack_lengths(count[c], length[c]);
+		if (! pack_codes(length[c], code[c], NULL)) debug_error();
+		}
+
+	/* header */
+
+	export_u32_le(&dst[wrt.ofs], size);
+	wrt.ofs += 4;
+	dst[wrt.ofs++] = PACK_NR_CONTEXTS;
+	for (c = 0; c < PACK_NR_CONTEXTS - 1; c++) dst[wrt.ofs++] = bound[c];
+	for (c = 0; c < PACK_NR_CONTEXTS; c++) for (i = 0; i < PACK_NR_SYMBOLS; i += 2) dst[wrt.ofs++] = length[c][i] | (length[c][i + 1] << 4);
+	debug_error_condition(wrt.ofs != PACK_HEADER_SIZE);
+
+	/* pulses */
+
+	for (i = 0, p = 0; i < size; p = data[i++]) pack_write_bits(&wrt, code[map[p]][data[i]], length[map[p]][data[i]]);
+	if (wrt.count > 0) pack_write_bits(&wrt, 0, 8 - wrt.count);
+	return (wrt.ofs);
+	}
+
+
+
+/****************************************************************************
+ * pack_decode
+ ****************************************************************************/
+cw_size_t
+pack_decode(
+	struct file			*fil,
+	cw_size_t			size,
+	cw_raw8_t			*data,
+	cw_size_t			limit)
+
+	{
+	struct pack_reader		*rdr;
+	struct pack_table		*tbl;
+	cw_raw8_t			length[PACK_NR_SYMBOLS];
+	cw_raw8_t			bound[PACK_NR_CONTEXTS - 1];
+	cw_raw8_t			map[PACK_NR_SYMBOLS];
+	cw_raw8_t			header[4];
+	cw_count_t			contexts, pulses;
+	cw_index_t			c, i, p, s;
+
+	/* reader and tables are too large for the stack of the threads */
+
+	rdr = scratch_get(sizeof (struct pack_reader));
+	tbl = scratch_get(PACK_NR_CONTEXTS * sizeof (struct pack_table));
+	*rdr = (struct pack_reader) { .fil = fil, .remain = size };
+
+	/* header */
+
+	for (i = 0; i < 4; i++) header[i] = pack_read_byte(rdr);
+	pulses   = import_u32_le(header);
+	contexts = pack_read_byte(rdr);
+	if ((contexts < 1) || (contexts > PACK_NR_CONTEXTS)) error_message("wrong number of contexts in packed track in file '%s'", file_get_path(fil));
+	if ((pulses < 0) || (pulses > limit)) error_message("packed track too large in file '%s'", file_get_path(fil));
+	for (c = 0; c < contexts - 1; c++) bound[c] = pack_read_byte(rdr);
+	pack_context_map(bound, contexts, map);
+	for (c = 0; c < contexts; c++)
+		{
+		for (i = 0; i < PACK_NR_SYMBOLS; i += 2)
+			{
+			length[i]     = pack_read_byte(rdr);
+			length[i + 1] = length[i] >> 4;
+			length[i]    &= 0x0f;
+			}
+		if (! pack_codes(length, NULL, &tbl[c])) error_message("invalid codes in packed track in file '%s'", file_get_path(fil));
+		}
+	if (rdr->pad > 0) error_message("broken packed track in file '%s'", file_get_path(fil));
+
+	/* pulses */
+
+	for (i = 0, p = 0; i < pulses; p = data[i++])
+		{
+		s = pack_read_symbol(rdr, &tbl[map[p]]);
+		if (s == -1) break;
+		data[i] = s;
+		}
+	if ((i < pulses) || (8 * rdr->pad > rdr->count)) error_message("broken packed track in file '%s'", file_get_path(fil));
+
+	/* skip what is left of this track, normally nothing */
+
+	while (rdr->remain > 0)
+		{
+		rdr->ofs = rdr->len;
+		pack_read_byte(rdr);
+		}
+	scratch_put(tbl);
+	scratch_put(rdr);
+	return (pulses);
+	}
+/******************************************************** Karsten Scheibler */
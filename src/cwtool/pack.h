@@ -0,0 +1,85 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * pack.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_PACK_H
+#define CWTOOL_PACK_H
+
+#include "types.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+/*
+ * a packed track starts with the number of pulses (u32 little endian), the
+ * number of contexts, the upper bounds of all contexts except the last and
+ * for each context the code lengths of all 256 pulse values (4 bits each).
+ * the huffman codes follow msb first, the code of each pulse is taken from
+ * the context the previous pulse falls into
+ */
+
+#define PACK_NR_SYMBOLS			256
+#define PACK_NR_CONTEXTS		4
+#define PACK_MAX_BITS			15
+#define PACK_LOOKUP_BITS		10
+#define PACK_BUFFER_SIZE		0x1000
+#define PACK_HEADER_SIZE		(4 + PACK_NR_CONTEXTS + PACK_NR_CONTEXTS * PACK_NR_SYMBOLS / 2)
+#define PACK_MAX_SIZE(size)		(PACK_HEADER_SIZE + ((size) * PACK_MAX_BITS + 7) / 8)
+
+struct pack_table
+	{
+	cw_u16_t			lookup[1 << PACK_LOOKUP_BITS];
+	cw_u16_t			first_code[PACK_MAX_BITS + 1];
+	cw_u16_t			first_index[PACK_MAX_BITS + 1];
+	cw_u16_t			codes[PACK_MAX_BITS + 1];
+	cw_raw8_t			symbol[PACK_NR_SYMBOLS];
+	};
+
+struct file;
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_size_t
+pack_encode(
+	cw_raw8_t			*data,
+	cw_size_t			size,
+	cw_raw8_t			*dst);
+
+extern cw_size_t
+pack_decode(
+	struct file			*fil,
+	cw_size_t			size,
+	cw_raw8_t			*data,
+	cw_size_t			limit);
+
+
+
+#endif /* !CWTOOL_PACK_H */
+/******************************************************** Karsten Scheibler */
@@ -0,0 +1,115 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * scratch.c
+ *
+ ****************************************************************************
+ *
+ * per thread scratch buffers for the decode pipeline. formerly each track
+ * decode put several arrays of GLOBAL_MAX_TRACK_SIZE onto the stack and
+ * most of them were cleared on every call. now scratch_get() hands out a
+ * buffer of the calling thread, which is kept allocated for the next
+ * caller. buffers are not cleared and have to be given back with
+ * scratch_put() in reverse order
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "scratch.h"
+#include "error.h"
+#include "debug.h"
+#include "global.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+static __thread struct scratch		scratch_local;
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * scratch_get
+ ****************************************************************************/
+cw_void_t *
+scratch_get(
+	cw_size_t			size)
+
+	{
+	struct scratch			*scr = &scratch_local;
+	struct scratch_slot		*slt;
+
+	error_condition(scr->depth >= SCRATCH_NR_SLOTS);
+	slt = &scr->slt[scr->depth++];
+	if (slt->size < size)
+		{
+		free(slt->data);
+		slt->data = malloc(size);
+		if (slt->data == NULL) error_oom();
+		slt->size = size;
+		}
+	return (slt->data);
+	}
+
+
+
+/****************************************************************************
+ * scratch_put
+ ****************************************************************************/
+cw_void_t
+scratch_put(
+	cw_void_t			*data)
+
+	{
+	struct scratch			*scr = &scratch_local;
+
+	error_condition(scr->depth <= 0);
+	debug_error_condition(data != scr->slt[scr->depth - 1].data);
+	scr->depth--;
+	}
+
+
+
+/****************************************************************************
+ * scratch_free
+ ****************************************************************************/
+cw_void_t
+scratch_free(
+	cw_void_t)
+
+	{
+	struct scratch			*scr = &scratch_local;
+	cw_index_t			i;
+
+	/* should be called by each thread before it exits */
+
+	error_condition(scr->depth != 0);
+	for (i = 0; i < SCRATCH_NR_SLOTS; i++) free(scr->slt[i].data);
+	*scr = (struct scratch) { };
+	}
+/******************************************************** Karsten Scheibler */
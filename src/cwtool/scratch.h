@@ -0,0 +1,63 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * scratch.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_SCRATCH_H
+#define CWTOOL_SCRATCH_H
+
+#include "types.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define SCRATCH_NR_SLOTS		16
+
+struct scratch_slot
+	{
+	cw_void_t			*data;
+	cw_size_t			size;
+	};
+
+struct scratch
+	{
+	struct scratch_slot		slt[SCRATCH_NR_SLOTS];
+	cw_count_t			depth;
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_void_t			*scratch_get(cw_size_t);
+extern cw_void_t			scratch_put(cw_void_t *);
+extern cw_void_t			scratch_free(cw_void_t);
+
+
+
+#endif /* !CWTOOL_SCRATCH_H */
+/******************************************************** Karsten Scheibler */
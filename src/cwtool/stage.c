@@ -0,0 +1,451 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * stage.c
+ *
+ ****************************************************************************
+ *
+ * timing of the decode stages. the shared helpers like postcomp_simple(),
+ * bitstream_read() or sync_read() mark their start and end, the time in
+ * between is summed up per stage for the calling thread. as long as
+ * timing is not enabled, each mark costs only one function call
+ *
+ * stage_open() additionally sums up the counters per track and
+ * stage_close() writes them out as JSON or, if the file name ends with
+ * ".csv", as CSV
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "stage.h"
+#include "error.h"
+#include "debug.h"
+#include "global.h"
+#include "string.h"
+#include "file.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define STAGE_NSECS			1000000000LL
+#define STAGE_SUFFIX_CSV		".csv"
+
+static cw_bool_t			stage_active;
+static cw_bool_t			stage_csv;
+static struct file			stage_file;
+static __thread struct stage		stage_local;
+
+
+
+
+/****************************************************************************
+ *
+ * local functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * stage_time
+ ****************************************************************************/
+static cw_count64_t
+stage_time(
+	cw_void_t)
+
+	{
+	struct timespec			ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) error_perror_message("error while clock_gettime()");
+	return ((cw_count64_t) ts.tv_sec * STAGE_NSECS + ts.tv_nsec);
+	}
+
+
+
+/****************************************************************************
+ * stage_add
+ ****************************************************************************/
+static cw_void_t
+stage_add(
+	struct stage			*stg,
+	cw_index_t			stage,
+	cw_count64_t			calls,
+	cw_count64_t			nsecs,
+	cw_count64_t			bytes,
+	cw_count64_t			pulses)
+
+	{
+	struct stage_counter		*cnt[2] = { &stg->cnt[stage], NULL };
+	cw_index_t			i;
+
+	if ((stg->trk != NULL) && (stg->track != STAGE_NO_TRACK)) cnt[1] = &stg->trk[stg->track * STAGE_NR_STAGES + stage];
+	for (i = 0; (i < 2) && (cnt[i] != NULL); i++)
+		{
+		cnt[i]->calls  += calls;
+		cnt[i]->nsecs  += nsecs;
+		cnt[i]->bytes  += bytes;
+		cnt[i]->pulses += pulses;
+		}
+	}
+
+
+
+/****************************************************************************
+ * stage_account
+ ****************************************************************************/
+static cw_void_t
+stage_account(
+	struct stage			*stg)
+
+	{
+	cw_count64_t			now = stage_time();
+
+	if (stg->depth > 0) stage_add(stg, stg->stack[stg->depth - 1], 0, now - stg->last, 0, 0);
+	stg->last = now;
+	}
+
+
+
+/****************************************************************************
+ * stage_active_already
+ ****************************************************************************/
+static cw_bool_t
+stage_active_already(
+	struct stage			*stg,
+	cw_index_t			stage)
+
+	{
+	cw_index_t			i;
+
+	for (i = 0; i < stg->depth; i++) if (stg->stack[i] == stage) return (CW_BOOL_TRUE);
+	return (CW_BOOL_FALSE);
+	}
+
+
+
+/****************************************************************************
+ * stage_empty
+ ****************************************************************************/
+static cw_bool_t
+stage_empty(
+	struct stage_counter		*cnt)
+
+	{
+	cw_index_t			i;
+
+	for (i = 0; i < STAGE_NR_STAGES; i++) if (cnt[i].calls > 0) return (CW_BOOL_FALSE);
+	return (CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * stage_write_csv
+ ****************************************************************************/
+static cw_void_t
+stage_write_csv(
+	struct file			*fil,
+	struct stage_counter		*cnt,
+	const cw_char_t			*track)
+
+	{
+	cw_index_t			i;
+
+	for (i = 0; i < STAGE_NR_STAGES; i++) file_write_sprintf(fil, "%s,%s,%lld,%lld,%lld,%lld\n",
+		track, stage_get_name(i), cnt[i].calls, cnt[i].nsecs, cnt[i].bytes, cnt[i].pulses);
+	}
+
+
+
+/****************************************************************************
+ * stage_write_json
+ ****************************************************************************/
+static cw_void_t
+stage_write_json(
+	struct file			*fil,
+	struct stage_counter		*cnt,
+	const cw_char_t			*indent)
+
+	{
+	cw_index_t			i;
+
+	file_write_string(fil, "{\n");
+	for (i = 0; i < STAGE_NR_STAGES; i++) file_write_sprintf(fil,
+		"%s\t\"%s\": { \"calls\": %lld, \"nsecs\": %lld, \"bytes\": %lld, \"pulses\": %lld }%s\n",
+		indent, stage_get_name(i), cnt[i].calls, cnt[i].nsecs, cnt[i].bytes, cnt[i].pulses,
+		(i + 1 < STAGE_NR_STAGES) ? "," : "");
+	file_write_sprintf(fil, "%s}", indent);
+	}
+
+
+
+/****************************************************************************
+ * stage_write
+ ****************************************************************************/
+static cw_void_t
+stage_write(
+	struct file			*fil,
+	struct stage			*stg)
+
+	{
+	cw_char_t			track[16];
+	cw_count_t			tracks = 0;
+	cw_index_t			i;
+
+	/* tracks which were not touched at all are left out */
+
+	if (stage_csv) file_write_string(fil, "track,stage,calls,nsecs,bytes,pulses\n");
+	else file_write_string(fil, "{\n\t\"tracks\": [");
+	for (i = 0; i < GLOBAL_NR_TRACKS; i++)
+		{
+		if (stage_empty(&stg->trk[i * STAGE_NR_STAGES])) continue;
+		if (stage_csv)
+			{
+			string_snprintf(track, sizeof (track), "%d", i);
+			stage_write_csv(fil, &stg->trk[i * STAGE_NR_STAGES], track);
+			continue;
+			}
+		file_write_sprintf(fil, "%s\n\t\t{ \"track\": %d, \"stages\": ", (tracks++ > 0) ? "," : "", i);
+		stage_write_json(fil, &stg->trk[i * STAGE_NR_STAGES], "\t\t");
+		file_write_string(fil, " }");
+		}
+	if (stage_csv)
+		{
+		stage_write_csv(fil, stg->cnt, "total");
+		return;
+		}
+	file_write_string(fil, "\n\t],\n\t\"total\": ");
+	stage_write_json(fil, stg->cnt, "\t");
+	file_write_string(fil, "\n}\n");
+	}
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+/****************************************************************************
+ * stage_enable
+ ****************************************************************************/
+cw_void_t
+stage_enable(
+	cw_bool_t			enable)
+
+	{
+
+	/* has to be called before any threads are started */
+
+	stage_active = enable;
+	}
+
+
+
+/****************************************************************************
+ * stage_enabled
+ ****************************************************************************/
+cw_bool_t
+stage_enabled(
+	cw_void_t)
+
+	{
+	return (stage_active);
+	}
+
+
+
+/****************************************************************************
+ * stage_enter2
+ ****************************************************************************/
+cw_void_t
+stage_enter2(
+	cw_index_t			stage)
+
+	{
+	struct stage			*stg = &stage_local;
+
+	debug_error_condition((stage < 0) || (stage >= STAGE_NR_STAGES));
+	if (stg->depth >= STAGE_MAX_DEPTH) error_message("stages nested too deep");
+	stage_account(stg);
+
+	/*
+	 * entering a stage which is already active (like the decode
+	 * callback of match_simple() during a decode) is no new call
+	 */
+
+	if (! stage_active_already(stg, stage)) stage_add(stg, stage, 1, 0, 0, 0);
+	stg->stack[stg->depth++] = stage;
+	}
+
+
+
+/****************************************************************************
+ * stage_leave2
+ ****************************************************************************/
+cw_void_t
+stage_leave2(
+	cw_void_t)
+
+	{
+	struct stage			*stg = &stage_local;
+
+	debug_error_condition(stg->depth <= 0);
+	stage_account(stg);
+	stg->depth--;
+	}
+
+
+
+/****************************************************************************
+ * stage_count2
+ ****************************************************************************/
+cw_void_t
+stage_count2(
+	cw_index_t			stage,
+	cw_count64_t			bytes,
+	cw_count64_t			pulses)
+
+	{
+	debug_error_condition((stage < 0) || (stage >= STAGE_NR_STAGES));
+	stage_add(&stage_local, stage, 0, 0, bytes, pulses);
+	}
+
+
+
+/****************************************************************************
+ * stage_track2
+ ****************************************************************************/
+cw_void_t
+stage_track2(
+	cw_index_t			track)
+
+	{
+	debug_error_condition((track != STAGE_NO_TRACK) && ((track < 0) || (track >= GLOBAL_NR_TRACKS)));
+
+	/* time spent so far belongs to the previous track */
+
+	stage_account(&stage_local);
+	stage_local.track = track;
+	}
+
+
+
+/****************************************************************************
+ * stage_open
+ ****************************************************************************/
+cw_void_t
+stage_open(
+	const cw_char_t			*path)
+
+	{
+	struct stage			*stg = &stage_local;
+	cw_size_t			len = string_length(path);
+	cw_size_t			len_csv = string_length(STAGE_SUFFIX_CSV);
+
+	/*
+	 * has to be called from the thread doing all the work, counters
+	 * of other threads are not collected
+	 */
+
+	debug_error_condition(stg->trk != NULL);
+	file_open(&stage_file, path, FILE_MODE_CREATE, FILE_FLAG_NONE);
+	stage_csv = ((len > len_csv) && (string_equal(&path[len - len_csv], STAGE_SUFFIX_CSV))) ? CW_BOOL_TRUE : CW_BOOL_FALSE;
+	stage_reset();
+	stg->trk = (struct stage_counter *) calloc(GLOBAL_NR_TRACKS * STAGE_NR_STAGES, sizeof (struct stage_counter));
+	if (stg->trk == NULL) error_oom();
+	stage_enable(CW_BOOL_TRUE);
+	}
+
+
+
+/****************************************************************************
+ * stage_close
+ ****************************************************************************/
+cw_void_t
+stage_close(
+	cw_void_t)
+
+	{
+	struct stage			*stg = &stage_local;
+
+	debug_error_condition((stg->trk == NULL) || (stg->depth != 0));
+	stage_enable(CW_BOOL_FALSE);
+	stage_write(&stage_file, stg);
+	file_close(&stage_file);
+	free(stg->trk);
+	stg->trk = NULL;
+	}
+
+
+
+/****************************************************************************
+ * stage_get_counters
+ ****************************************************************************/
+cw_void_t
+stage_get_counters(
+	struct stage_counter		*cnt)
+
+	{
+	cw_index_t			i;
+
+	for (i = 0; i < STAGE_NR_STAGES; i++) cnt[i] = stage_local.cnt[i];
+	}
+
+
+
+/****************************************************************************
+ * stage_reset
+ ****************************************************************************/
+cw_void_t
+stage_reset(
+	cw_void_t)
+
+	{
+	debug_error_condition((stage_local.depth != 0) || (stage_local.trk != NULL));
+	stage_local = (struct stage) { .track = STAGE_NO_TRACK };
+	}
+
+
+
+/****************************************************************************
+ * stage_get_name
+ ****************************************************************************/
+const cw_char_t *
+stage_get_name(
+	cw_index_t			stage)
+
+	{
+	const static cw_char_t		*name[STAGE_NR_STAGES] =
+		{
+		"image_read", "clock", "postcomp", "bitstream", "sync",
+		"decode", "encode", "match", "image_write"
+		};
+
+	debug_error_condition((stage < 0) || (stage >= STAGE_NR_STAGES));
+	return (name[stage]);
+	}
+/******************************************************** Karsten Scheibler */
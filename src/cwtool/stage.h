@@ -0,0 +1,167 @@
+/****************************************************************************
+ ****************************************************************************
+ *
+ * stage.h
+ *
+ ****************************************************************************
+ ****************************************************************************/
+
+
+
+
+
+#ifndef CWTOOL_STAGE_H
+#define CWTOOL_STAGE_H
+
+#include "types.h"
+
+
+
+
+/****************************************************************************
+ *
+ * data structures and defines
+ *
+ ****************************************************************************/
+
+
+
+
+#define STAGE_IMAGE_READ		0
+#define STAGE_CLOCK			1
+#define STAGE_POSTCOMP			2
+#define STAGE_BITSTREAM			3
+#define STAGE_SYNC			4
+#define STAGE_DECODE			5
+#define STAGE_ENCODE			6
+#define STAGE_MATCH			7
+#define STAGE_IMAGE_WRITE		8
+#define STAGE_NR_STAGES			9
+#define STAGE_MAX_DEPTH			16
+#define STAGE_NO_TRACK			-1
+
+struct stage_counter
+	{
+	cw_count64_t			calls;
+	cw_count64_t			nsecs;
+	cw_count64_t			bytes;
+	cw_count64_t			pulses;
+	};
+
+struct stage
+	{
+	struct stage_counter		cnt[STAGE_NR_STAGES];
+	struct stage_counter		*trk;
+	cw_index_t			track;
+	cw_index_t			stack[STAGE_MAX_DEPTH];
+	cw_count_t			depth;
+	cw_count64_t			last;
+	};
+
+
+
+
+/****************************************************************************
+ *
+ * global functions
+ *
+ ****************************************************************************/
+
+
+
+
+extern cw_void_t
+stage_enable(
+	cw_bool_t			enable);
+
+extern cw_bool_t
+stage_enabled(
+	cw_void_t);
+
+extern cw_void_t
+stage_enter2(
+	cw_index_t			stage);
+
+extern cw_void_t
+stage_leave2(
+	cw_void_t);
+
+extern cw_void_t
+stage_count2(
+	cw_index_t			stage,
+	cw_count64_t			bytes,
+	cw_count64_t			pulses);
+
+extern cw_void_t
+stage_track2(
+	cw_index_t			track);
+
+extern cw_void_t
+stage_open(
+	const cw_char_t			*path);
+
+extern cw_void_t
+stage_close(
+	cw_void_t);
+
+extern cw_void_t
+stage_get_counters(
+	struct stage_counter		*cnt);
+
+extern cw_void_t
+stage_reset(
+	cw_void_t);
+
+extern const cw_char_t *
+stage_get_name(
+	cw_index_t			stage);
+
+
+
+/*
+ * the time between stage_enter() and stage_leave() is accounted to the
+ * given stage, without the time spent in stages entered in between
+ */
+
+#define stage_enter(stage)						\
+	do								\
+		{							\
+		if (stage_enabled()) stage_enter2(STAGE_ ##stage);	\
+		}							\
+	while (0)
+
+#define stage_leave()							\
+	do								\
+		{							\
+		if (stage_enabled()) stage_leave2();			\
+		}							\
+	while (0)
+
+/*
+ * bytes and pulses are only evaluated if timing is enabled, pulses are
+ * raw counter values, bytes the data a stage produced or consumed
+ */
+
+#define stage_count(stage, bytes, pulses)				\
+	do								\
+		{							\
+		if (stage_enabled())					\
+			{						\
+			stage_count2(STAGE_ ##stage, bytes, pulses);	\
+			}						\
+		}							\
+	while (0)
+
+/* counters are also summed up for the given track until STAGE_NO_TRACK */
+
+#define stage_track(track)						\
+	do								\
+		{							\
+		if (stage_enabled()) stage_track2(track);		\
+		}							\
+	while (0)
+
+
+
+#endif /* !CWTOOL_STAGE_H */
+/******************************************************** Karsten Scheibler */